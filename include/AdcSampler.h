@@ -0,0 +1,34 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+
+// Continuous ADC1 sampling through the ESP32's DMA (I2S) path.
+//
+// The hardware converts all channels round-robin at ADC_SAMPLE_RATE_HZ. A
+// background task averages the raw conversions down to one sample per
+// channel every ADC_DECIMATE_MS and keeps the last ADC_RING_SAMPLES of them,
+// so readers always see fresh, already-smoothed data without blocking.
+
+enum AdcChannel : uint8_t {
+    ADC_CH_MOISTURE_1,   // GPIO32
+    ADC_CH_MOISTURE_2,   // GPIO33
+    ADC_CH_WATER_LEVEL,  // GPIO34
+    ADC_CH_TDS,          // GPIO35
+    ADC_CH_COUNT
+};
+
+bool startAdcSampler();  // false if DMA mode could not be set up
+bool adcSamplerRunning();
+
+// Mean of the newest n samples (n clamped to what is available); -1 if none yet.
+int adcSamplerMean(AdcChannel ch, uint8_t n);
+
+// Rolling median of the newest ADC_MEDIAN_WINDOW samples, updated as each
+// sample lands (no sorting on read); -1 if none yet.
+int adcSamplerMedian(AdcChannel ch);
+
+// Copies up to max of the newest samples, oldest first. Returns the count.
+size_t adcSamplerCopy(AdcChannel ch, int *out, size_t max);
+
+#endif
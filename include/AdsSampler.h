@@ -0,0 +1,24 @@
+#ifndef ADS_SAMPLER_H
+#define ADS_SAMPLER_H
+
+#include <Arduino.h>
+
+// ADS1115 on A0 (pH probe) in continuous-conversion mode.
+//
+// The chip's ALERT/RDY pin (ADS_ALERT_PIN) pulses at the end of every
+// conversion; its interrupt wakes a small task that fetches the result over
+// I2C into a ring buffer. Data rate and PGA gain come from Config.h. If the
+// RDY line is not wired the task still reads once per two conversion
+// periods, since the conversion register always holds the latest result.
+
+bool startAdsSampler();  // false if no ADS1115 answered on I2C
+bool adsSamplerRunning();
+
+// Mean voltage of the newest n samples (n clamped to what is available);
+// NAN if nothing has been sampled yet.
+float adsSamplerMeanVolts(uint8_t n);
+
+uint16_t adsSamplerRateSps();      // configured conversions per second
+uint32_t adsSamplerMissedReady();  // reads done without a RDY interrupt
+
+#endif
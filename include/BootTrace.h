@@ -0,0 +1,43 @@
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+#include "JsonWriter.h"
+
+// Boot timeline: the first time each stage is reached, in ms since the app
+// started. Stages may be marked from any task and in any order; later marks
+// of the same stage are ignored. Read it with bootTracePrint() (serial, done
+// once from loop()) or GET /boot.
+
+enum BootStage : uint8_t {
+    BOOT_SETUP,            // setup() entered
+    BOOT_PUMP_READY,       // relay forced to a known state
+    BOOT_SENSORS_READY,    // sensor drivers up, acquisition task running
+    BOOT_NETWORK_STARTED,  // WiFi manager and HTTP server started (not joined)
+    BOOT_FIREBASE_STARTED, // Firebase app configured (not authenticated)
+    BOOT_SETUP_DONE,       // setup() returned
+    BOOT_STORAGE_READY,    // LittleFS mounted, record queue and history log loaded
+    BOOT_FIRST_READING,    // first complete SensorData published
+    BOOT_WIFI_CONNECTED,   // first station link with an IP
+    BOOT_TIME_SYNCED,      // first valid wall-clock time (NTP)
+    BOOT_FIREBASE_READY,   // Firebase authenticated
+    BOOT_FIRST_UPLOAD,     // first history record acknowledged by RTDB
+    BOOT_STAGE_COUNT
+};
+
+void     bootMark(BootStage stage);
+bool     bootReached(BootStage stage);
+uint32_t bootStageMs(BootStage stage);  // 0 if not reached yet
+
+void bootTracePrint();                  // one line per stage on the log
+void bootTraceJson(JsonWriter &w);      // {"<stage>": ms | null, ...}
+
+// Prints the timeline once, when the first upload lands or after
+// BOOT_TRACE_REPORT_MS, whichever comes first. Call from loop().
+void bootTraceReportOnce();
+
+#endif
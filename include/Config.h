@@ -14,11 +14,143 @@
 #define PASSWORD "099996985858"
 
 // Other Settings
-#define UPLOAD_INTERVAL 30000 // ms
+#define UPLOAD_INTERVAL 60000 // ms between history uploads (default for ControlDoc.h)
+#define UPLOAD_INTERVAL_MOVING 15000 // ms between uploads while a sampled channel is moving
 #define PUMP_DURATION 10000 // ms
 #define PUMP_COOLDOWN 30000 // ms
 #define DEBUG_MODE true
+#define TEMP_RESOLUTION 12 // DS18B20 bits (9..12), lower = faster conversion
+#define LOOP_PROFILER false // true: per-phase cycle histograms (GET /profile, 'p' on serial)
 
+// Sensor acquisition task (loop() runs on core 1, so acquisition gets core 0)
+#define SENSOR_READ_INTERVAL 5000 // ms between acquisition cycles (ADAPTIVE_SAMPLING false)
+#define SENSOR_POLL_MS       2    // ms between steps while a cycle runs
+#define SENSOR_IDLE_MAX_MS   1000 // longest sleep between cycles (pump starts are seen this soon)
+#define SENSOR_TASK_CORE     0
+#define SENSOR_TASK_PRIORITY 1
+#define SENSOR_TASK_STACK    4096
+
+// Adaptive sampling per acquisition channel (include/SampleScheduler.h): a
+// channel is read between FAST_MS and SLOW_MS apart, faster while one reading
+// moves it by DELTA or more and while the pump runs (analog, ultrasonic).
+// false: every channel every SENSOR_READ_INTERVAL, as before.
+#define ADAPTIVE_SAMPLING          true
+#define SAMPLE_TEMP_FAST_MS        5000
+#define SAMPLE_TEMP_SLOW_MS        60000
+#define SAMPLE_TEMP_DELTA          0.25f  // °C
+#define SAMPLE_ANALOG_FAST_MS      2000   // moisture 1/2 and water level
+#define SAMPLE_ANALOG_SLOW_MS      30000
+#define SAMPLE_ANALOG_DELTA        2.0f   // % points
+#define SAMPLE_ULTRASONIC_FAST_MS  5000   // vermi tea tank
+#define SAMPLE_ULTRASONIC_SLOW_MS  60000
+#define SAMPLE_ULTRASONIC_DELTA    2.0f   // % points
+#define SAMPLE_TDS_FAST_MS         10000
+#define SAMPLE_TDS_SLOW_MS         120000
+#define SAMPLE_TDS_DELTA           10.0f  // ppm
+#define SAMPLE_PH_FAST_MS          10000
+#define SAMPLE_PH_SLOW_MS          120000
+#define SAMPLE_PH_DELTA            0.05f  // pH units
+
+// Continuous DMA sampling of the analog pins (moisture, water level, TDS)
+#define ADC_SAMPLE_RATE_HZ   20000 // conversions/s over all channels (ESP32 minimum)
+#define ADC_DECIMATE_MS      40    // one averaged sample per channel every N ms
+#define ADC_RING_SAMPLES     32    // averaged samples kept per channel
+#define ADC_MEAN_SAMPLES     8     // samples averaged for moisture / water level
+#define ADC_MEDIAN_WINDOW    30    // samples in each channel's rolling median
+#define ADC_SAMPLER_PRIORITY 2
+
+// ADS1115 pH channel (continuous conversion, ALERT/RDY interrupt)
+#define ADS_ALERT_PIN        19                  // ADS1115 ALERT/RDY → GPIO19
+#define PH_ADS_DATA_RATE     RATE_ADS1115_64SPS  // RATE_ADS1115_8SPS .. RATE_ADS1115_860SPS
+#define PH_ADS_GAIN          GAIN_TWOTHIRDS      // PGA: ±6.144 V (GAIN_ONE = ±4.096 V, ...)
+#define PH_RING_SAMPLES      64                  // samples kept
+#define PH_AVG_SAMPLES       32                  // samples averaged per reading (0.5 s at 64 SPS)
+
+// Offline store-and-forward for history records
+#define RECORD_QUEUE_RAM       256    // records held in RAM (PSRAM when available)
+#define RECORD_QUEUE_FLUSH_AT  5      // spill RAM to LittleFS every N records
+#define RECORD_QUEUE_SPOOL_MAX 131072 // bytes of LittleFS spool (~2900 records)
+#define RECORD_QUEUE_BATCH     20     // records per catch-up write
+#define RECORD_QUEUE_DRAIN_MS  3000   // min ms between catch-up writes
+
+// Report by exception: a history upload only carries fields that moved by
+// more than their deadband (the larger of the absolute and percent-of-last
+// thresholds), plus any field silent for REPORT_HEARTBEAT_MS
+#define REPORT_HEARTBEAT_MS    900000 // max ms a field goes without being uploaded
+#define DEADBAND_TEMP_C        0.25   // °C
+#define DEADBAND_MOISTURE      2      // % points
+#define DEADBAND_WATER_LEVEL   2.0    // % points
+#define DEADBAND_TDS_PCT       3.0    // % of the last uploaded value
+#define DEADBAND_TDS_ABS       5.0    // ppm (floor near zero)
+#define DEADBAND_PH            0.05   // pH units
+#define DEADBAND_ULTRA_LEVEL   2      // % points
+
+// On-flash history log (lib/TsLog format)
+#define HISTORY_LOG_INTERVAL   60000  // ms between logged records
+#define HISTORY_BLOCK_RECORDS  16     // records per block (flushed together)
+#define HISTORY_SEGMENT_BYTES  16384  // max bytes per segment file
+#define HISTORY_SEGMENTS       24     // segments kept (oldest deleted first)
+// On-device trend store behind GET /history (include/TrendStore.h), PSRAM
+#define TREND_RAW_SAMPLES      720    // every reading: 1..6 h with adaptive sampling
+#define TREND_MINUTE_ROWS      1440   // 1-minute min/mean/max: 24 h
+#define TREND_HOUR_ROWS        720    // 1-hour rollups: 30 days
+#define TREND_DAY_ROWS         730    // 1-day rollups (UTC days): 2 years
+#define TREND_QUERY_SPAN       3600   // s of history when /history has no from=
+// Control trace for tools/control_replay (include/ControlTrace.h): every
+// reading and relay change, ~10 bytes per record in the TsLog format
+#define CONTROL_TRACE_ENABLED        true
+#define CONTROL_TRACE_BLOCK_RECORDS  32     // records per block (flushed together)
+#define CONTROL_TRACE_SEGMENT_BYTES  16384  // max bytes per segment file
+#define CONTROL_TRACE_SEGMENTS       32     // segments kept: ~3 days at 5 s readings
+
+// Logging (include/Log.h). Calls above LOG_LEVEL are compiled out; production
+// builds can pass -DLOG_LEVEL=LOG_LEVEL_WARN (or NONE) in build_flags.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL          (DEBUG_MODE ? 4 : 2) // 4 = DEBUG, 2 = WARN
+#endif
+#define LOG_RING_BYTES     4096   // power of two; one line takes len + 8 bytes
+#define LOG_LINE_MAX       160    // longest formatted line, prefix included
+#define LOG_MAX_SINKS      3
+#define LOG_DRAIN_MS       20     // drain task wake-up period
+#define LOG_TASK_PRIORITY  0      // below everything else (idle level)
+#define LOG_TASK_STACK     3072
+
+// HTTPS wire capture for the Firebase clients (include/WireCapture.h),
+// toggled at runtime through GET /wire_capture?enable=1
+#define WIRE_CAPTURE_ENABLED   true   // false: hooks not compiled in at all
+#define WIRE_CAPTURE_SLOTS     32     // requests/responses kept
+#define WIRE_CAPTURE_SNIP      192    // payload bytes kept per slot
+#define WIRE_CAPTURE_GAP_MS    250    // chunks further apart start a new slot
+
+// Power management (include/PowerPlan.h). 0: always on. 1: light sleep
+// between acquisitions, radio up only in windows every upload interval.
+// 2: deep sleep between readings, batched in RTC memory and uploaded from
+// the wakes that bring the radio up. Nothing sleeps while the pump runs.
+#define POWER_MODE             0
+#define POWER_SLEEP_MIN_MS     200     // shorter idle gaps are not slept
+#define POWER_WARMUP_MS        1300    // awake before a due reading (ADC/ADS rings refill)
+#define POWER_RADIO_MIN_MS     15000   // radio window length (uploads, control stream)
+#define POWER_RADIO_MAX_MS     45000   // window extended up to this while uploads are pending
+#define POWER_WAKE_GPIO        -1      // service button (active low, RTC GPIO), -1 = none
+#define POWER_SERVICE_MS       300000  // radio kept up after a button wake (local HTTP)
+#define POWER_DEEP_PERIOD_MS   60000   // deep sleep: one reading per wake, this far apart
+#define POWER_BATCH_RECORDS    15      // deep sleep: readings held in RTC memory per upload
+#define POWER_BATCH_MAX_AGE_MS 1800000 // deep sleep: oldest held reading uploaded by then
+
+// Boot
+#define BOOT_TRACE_REPORT_MS   120000 // print the boot timeline by now even without an upload
+#define STORAGE_TASK_STACK     4096   // one-shot task mounting LittleFS at boot
+
+// WiFi connection manager and local HTTP API jobs
+#define WIFI_CONNECT_TIMEOUT_MS 10000  // one join attempt gives up after this
+#define WIFI_BACKOFF_MIN_MS     1000   // first retry after a failed attempt / drop
+#define WIFI_BACKOFF_MAX_MS     60000  // retry interval cap (doubles up to this)
+#define WIFI_RESET_DELAY_MS     1000   // /reset_wifi restarts after the reply is sent
+
+// Live telemetry over SSE at /events (include/LiveEvents.h); the per-client
+// queue cap is SSE_MAX_QUEUED_MESSAGES in platformio.ini
+#define LIVE_MAX_CLIENTS        4      // concurrent /events subscribers
+#define LIVE_RETRY_MS           2000   // reconnect delay suggested to clients
 
 // WiFi Credentials will only be used for debug mode
 #define USE_PREDEFINED_WIFI true
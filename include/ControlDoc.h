@@ -0,0 +1,44 @@
+#ifndef CONTROL_DOC_H
+#define CONTROL_DOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Remote settings carried by the /Control/<DEVICE_ID> RTDB document, read
+// through a single stream subscription (FirebaseHandler.cpp):
+//
+//   { "isPump": false,
+//     "intervals":   { "sensorMs": 5000, "uploadMs": 60000, "historyMs": 60000 },
+//     "sampling":    { "temp": { "fastMs": 5000, "slowMs": 60000 }, "analog": ...,
+//                      "ultrasonic": ..., "tds": ..., "ph": ... },
+//     "calibration": { "valAir1": 3018, "valWater1": 1710,
+//                      "valAir2": 3018, "valWater2": 1710,
+//                      "ultraEmptyCm": 14.0, "ultraFullCm": 4.0 },
+//     "tempResolution": 12 }
+//
+// Any subset may be sent; a put or patch at any path applies only the leaves
+// it carries, and out-of-range values are ignored. So is a calibration that
+// leaves valAirN not above valWaterN or ultraFullCm not below ultraEmptyCm:
+// that pair keeps its previous values. Calibration is stored in
+// Preferences like GET /calibrate does. Intervals and resolution are not:
+// they fall back to Config.h until the stream delivers the document again.
+//
+// sampling/<channel> sets the adaptive bounds of one acquisition channel
+// (SampleScheduler.h); intervals/sensorMs pins every channel to one fixed
+// interval instead.
+
+// Bits returned by controlDocApply()
+#define CONTROL_APPLIED_PUMP         0x01
+#define CONTROL_APPLIED_INTERVALS    0x02
+#define CONTROL_APPLIED_CALIBRATION  0x04
+#define CONTROL_APPLIED_TEMP         0x08
+
+// Applies one stream event: its data path ("/", "/isPump", ...) and JSON
+// payload, parsed in place. Returns the CONTROL_APPLIED_* groups changed.
+uint8_t controlDocApply(const char *dataPath, const char *json, size_t len);
+
+// Current intervals (Config.h defaults until the document sets them)
+uint32_t controlUploadIntervalMs();
+uint32_t controlHistoryIntervalMs();
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef CONTROL_TRACE_H
+#define CONTROL_TRACE_H
+
+#include <Arduino.h>
+#include <TsLogControl.h>
+#include "Config.h"
+
+// Flash recording of what the pump rules saw and did, for replaying them on
+// a PC with changed thresholds (tools/control_replay).
+//
+// Same segment layout as HistoryLog.h, under /ctrace and with the
+// TSLOG_CONTROL_FIELDS table. Built in when CONTROL_TRACE_ENABLED is true
+// (Config.h). GET /trace streams every segment back to back, oldest first.
+
+#if CONTROL_TRACE_ENABLED
+
+bool initControlTrace();
+
+void controlTraceAppend(const ControlTraceEntry &e);
+void controlTraceFlush();  // write the partially filled block now
+
+// Reads the segments as one byte stream. controlTraceBegin() flushes and
+// points the cursor at the oldest segment; controlTraceRead() returns 0 once
+// everything has been read. Safe to call from another task.
+struct ControlTraceCursor {
+    uint32_t seq;
+    uint32_t offset;
+};
+void   controlTraceBegin(ControlTraceCursor &c);
+size_t controlTraceRead(ControlTraceCursor &c, uint8_t *out, size_t max);
+
+uint32_t controlTraceBytes();  // flash used by all segments
+
+#endif
+
+#endif
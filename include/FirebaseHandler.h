@@ -1,20 +1,18 @@
 #ifndef FIREBASE_HANDLER_H
 #define FIREBASE_HANDLER_H
 
-#define ENABLE_USER_AUTH
-#define ENABLE_DATABASE
-
-#define FIREBASE_DEBUG_ENABLE 1
-#define FIREBASE_DEBUG_LEVEL 4
-
-#include <WiFiClientSecure.h>
-#include <FirebaseClient.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
 #include "SensorsData.h"
 
-// ===== Firebase globals =====
-extern FirebaseApp app;
-extern RealtimeDatabase Database;
-extern bool firebaseBusy;
+// Uploads and the control stream over the Realtime Database calls in Hal.h
+// (FirebaseClient on the board, the fake RTDB in [env:native]).
+
+extern bool firebaseBusy;  // a write is in flight on the write client
 
 // ===== Firebase core functions =====
 void initFirebase(const char* apiKey,
@@ -25,7 +23,22 @@ void initFirebase(const char* apiKey,
 void firebaseLoop();
 
 void uploadDataToFirebase(const SensorData &data);
-void uploadRecordDataToFirebase(const String &date, const SensorData &data);
+// Records that cannot be sent right now are queued (see RecordQueue.h) and
+// uploaded in batches from firebaseLoop() once the connection is back.
+// Only the fields in `fields` (SENSOR_FIELDS mask, see ReportFilter.h) are
+// written under the record's key.
+void uploadRecordDataToFirebase(uint32_t timestamp, const SensorData &data, uint16_t fields);
+
+// Power management: whether records are queued or a write is in flight, and
+// the cleanup before the radio goes off (ends the control stream, requeues
+// writes in flight)
+bool firebaseUploadPending();
+void firebaseRadioDown();
+
+// Results from the RTDB HAL, called from inside halRtdbLoop() (loop task)
+void firebaseOnWriteDone(uint8_t task, bool ok);  // task: MetricFirebaseTask
+void firebaseOnStreamEvent(const char *event, const char *dataPath, const char *payload);
+void firebaseOnStreamError();                      // the control stream failed
 
 // ===== Pump control functions =====
 void startPumpListener();
@@ -0,0 +1,71 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Thin hardware layer under the acquisition and pump-control code.
+//
+// src/hal/HalEsp32.cpp implements it on the board (DMA ADC sampler, echo
+// interrupt, OneWire/DallasTemperature, ADS1115 sampler, relay pin);
+// src/sim/HalSim.cpp implements it on the host for [env:native] with
+// simulated sensors and a simulated clock. Code written against this header
+// (Acquisition.cpp, PumpControl.cpp, SensorFields.cpp, ReportFilter.cpp,
+// FirebaseHandler.cpp) builds for both.
+//
+// All calls return at once; anything that takes time on real hardware is
+// split into a start call and a poll.
+
+// Pins, interrupts and samplers for everything below except the relay
+void halSensorsBegin();
+
+// ===== Clock =====
+uint32_t halMillis();
+uint32_t halMicros();
+
+// ===== Analog inputs (12-bit raw) =====
+enum HalAnalog : uint8_t {
+    HAL_AIN_MOISTURE_1,
+    HAL_AIN_MOISTURE_2,
+    HAL_AIN_WATER_LEVEL,
+    HAL_AIN_TDS,
+    HAL_AIN_COUNT
+};
+
+int halAnalogMean(HalAnalog ch, uint8_t n);  // mean of the newest n samples
+int halAnalogMedian(HalAnalog ch);           // rolling median (ADC_MEDIAN_WINDOW)
+
+// ===== Ultrasonic ranger (HC-SR04) =====
+void halUltraTrigger();                      // starts one measurement
+bool halUltraEcho(uint32_t *widthUs);        // true once the echo has ended
+
+// ===== DS18B20 probes on OneWire =====
+// Scans the bus, applies the resolution and returns how many probes answered
+// (at most max). *convMs is the conversion time at that resolution.
+uint8_t halTempScan(uint8_t max, uint8_t resolution, uint16_t *convMs);
+void    halTempRequest();                    // starts a conversion on all probes
+float   halTempRead(uint8_t probe);          // NAN if the probe stopped answering
+
+// ===== ADS1115 (pH) =====
+float halPhVolts(uint8_t n);                 // mean of the newest n samples, NAN if none
+
+// ===== Pump relay =====
+void halPumpInit();                          // relay output, forced OFF
+void halPumpWrite(bool on);
+void halPumpHoldOff();                       // OFF and latched through deep sleep (until halPumpInit)
+
+// ===== Realtime Database (Firebase) =====
+// src/hal/HalRtdbEsp32.cpp runs these on FirebaseClient (one client for
+// writes, one for the control stream); src/sim/FakeRtdb.cpp keeps the
+// documents in memory. Results come back from inside halRtdbLoop() through
+// the firebaseOn*() hooks in FirebaseHandler.h. task is a MetricFirebaseTask
+// (Metrics.h) and is handed back with the result. One write at a time.
+void halRtdbBegin(const char *apiKey, const char *email, const char *password, const char *dbUrl);
+void halRtdbLoop();                          // services the clients; nothing while offline
+bool halRtdbReady();                         // online and signed in
+void halRtdbSet(uint8_t task, const char *path, const char *json);     // replaces the node
+void halRtdbUpdate(uint8_t task, const char *path, const char *json);  // merges the children
+void halRtdbStream(const char *path);        // opens the control stream
+void halRtdbStop();                          // drops the requests in flight and the stream
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <Arduino.h>
+#include "SensorsData.h"
+
+// On-flash SensorData history in the TsLog format (lib/TsLog).
+//
+// Records are packed into blocks of HISTORY_BLOCK_RECORDS and appended to
+// rotating segment files under /tslog. Once HISTORY_SEGMENTS segments exist
+// the oldest one is deleted, so writes move across the whole budget instead
+// of rewriting the same pages. tools/tslog_decode reads the same files on a PC.
+//
+// Records still in the open block (not yet flushed) are lost on power cut.
+
+bool initHistoryLog();
+
+void historyLogAppend(uint32_t timestamp, const SensorData &data);
+void historyLogFlush();  // write the partially filled block now
+
+typedef void (*HistoryRecordCallback)(uint32_t timestamp, const SensorData &data, void *ctx);
+
+// Calls cb for every flushed record with from <= timestamp <= to, oldest
+// first, and returns how many matched. Safe to call from another task.
+size_t historyLogScan(uint32_t from, uint32_t to, HistoryRecordCallback cb, void *ctx);
+
+uint32_t historyLogBytes();  // flash used by all segments
+
+#endif
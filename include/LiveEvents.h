@@ -0,0 +1,21 @@
+#ifndef LIVE_EVENTS_H
+#define LIVE_EVENTS_H
+
+#include <ESPAsyncWebServer.h>
+
+// Push telemetry over Server-Sent Events at GET /events.
+//
+//   event: data   every newly published SensorData (SENSOR_OUT_HTTP fields,
+//                 "v" = sensorDataVersion(), "pump" = relay state)
+//   event: pump   {"on":true|false} as soon as the relay switches
+//
+// A new subscriber gets one "data" frame at once. Frames are only built when
+// somebody is listening. Each subscriber has its own queue, capped at
+// SSE_MAX_QUEUED_MESSAGES (platformio.ini): a client that falls behind loses
+// frames instead of holding memory or stalling the others. At most
+// LIVE_MAX_CLIENTS subscribers are accepted; further requests get a 404.
+
+void initLiveEvents(AsyncWebServer &server);
+void liveEventsLoop();  // from loopWiFiAndServer(): sends what changed
+
+#endif
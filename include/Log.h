@@ -0,0 +1,76 @@
+#ifndef LOG_H
+#define LOG_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+#include "Config.h"
+
+// Leveled, tagged logging through a lock-free ring buffer.
+//
+// LOGx() formats the line on the caller's stack, reserves space in the ring
+// with a single compare-and-swap and returns; a low-priority task drains the
+// ring to every registered sink (Serial, telnet). Nothing allocates and no
+// caller ever waits on a UART or socket. When the ring is full the line is
+// dropped and counted instead of blocking.
+//
+// Calls above LOG_LEVEL (Config.h) compile to nothing, format string and
+// arguments included. Not for use from ISRs.
+//
+//   LOGI("WIFI", "connected to %s", ssid);
+//   -> [   5123][I][WIFI] connected to sensor-net
+
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARN    2
+#define LOG_LEVEL_INFO    3
+#define LOG_LEVEL_DEBUG   4
+#define LOG_LEVEL_VERBOSE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+typedef void (*LogSink)(const char *line, size_t len);
+
+void     logBegin();                    // starts the drain task
+bool     logAddSink(LogSink sink);      // false if LOG_MAX_SINKS are registered
+void     logWrite(uint8_t level, const char *tag, const char *fmt, ...)
+             __attribute__((format(printf, 3, 4)));
+void     logFlush();                    // drain synchronously (e.g. before a restart)
+uint32_t logDropped();                  // lines lost to a full ring
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(tag, fmt, ...) logWrite(LOG_LEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(tag, fmt, ...) logWrite(LOG_LEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(tag, fmt, ...) logWrite(LOG_LEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(tag, fmt, ...) logWrite(LOG_LEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOGV(tag, fmt, ...) logWrite(LOG_LEVEL_VERBOSE, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGV(tag, fmt, ...) do {} while (0)
+#endif
+
+#endif
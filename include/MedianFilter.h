@@ -0,0 +1,119 @@
+#ifndef MEDIAN_FILTER_H
+#define MEDIAN_FILTER_H
+
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+// Sliding-window median over the last N samples, kept up to date as samples
+// arrive instead of sorting the whole window on every read.
+//
+// The filter keeps the window twice: in arrival order (to know which sample
+// drops out) and sorted. push() finds the outgoing and incoming positions by
+// binary search (O(log N)) and closes the gap with a single memmove of the
+// elements in between (O(N) worst case), so reading the median or a trimmed
+// mean is O(1) / O(N - 2*trim).
+//
+// The memmove is deliberate. At the window sizes used here (ADC_MEDIAN_WINDOW,
+// ULTRA_SAMPLES: tens of samples) it moves at most a few hundred contiguous
+// bytes, which is cheaper than the pointer chasing and per-node bookkeeping of
+// an indexable skiplist or a two-heap filter with indexed removal, and the
+// flat sorted array is what makes trimmedMean(), minimum() and maximum() free.
+// Revisit if N grows into the thousands.
+//
+// Fixed storage, no heap, no VLAs: safe to feed from a DMA or sampling task.
+// Float samples must not be NaN (NaN breaks the ordering).
+template <typename T, size_t N>
+class MedianFilter {
+  static_assert(N > 0, "MedianFilter needs a window of at least one sample");
+  static_assert(std::is_trivially_copyable<T>::value, "MedianFilter samples are moved with memmove");
+
+public:
+  void reset() {
+    head_  = 0;
+    count_ = 0;
+  }
+
+  void push(T v) {
+    if (count_ < N) {
+      const size_t pos = upperBound(v, count_);
+      memmove(&sorted_[pos + 1], &sorted_[pos], (count_ - pos) * sizeof(T));
+      sorted_[pos] = v;
+      ring_[(head_ + count_) % N] = v;
+      count_++;
+      return;
+    }
+
+    // Full: the oldest sample leaves, v takes its slot
+    const T old = ring_[head_];
+    ring_[head_] = v;
+    head_ = (head_ + 1) % N;
+
+    const size_t from = lowerBound(old, N);
+    size_t to = upperBound(v, N);
+    if (to > from) {
+      // Shift (from, to) left by one; v lands just before its upper bound
+      to--;
+      memmove(&sorted_[from], &sorted_[from + 1], (to - from) * sizeof(T));
+    } else {
+      // Shift [to, from) right by one
+      memmove(&sorted_[to + 1], &sorted_[to], (from - to) * sizeof(T));
+    }
+    sorted_[to] = v;
+  }
+
+  size_t size() const { return count_; }
+  bool   full() const { return count_ == N; }
+  bool   empty() const { return count_ == 0; }
+
+  // Middle sample; mean of the two middle samples for an even count.
+  // Returns T() while empty.
+  T median() const {
+    if (count_ == 0) return T();
+    const size_t mid = count_ / 2;
+    return (count_ & 1) ? sorted_[mid] : (T)((sorted_[mid - 1] + sorted_[mid]) / 2);
+  }
+
+  // Mean after dropping `trim` samples from each end. Falls back to the
+  // median when trimming would leave nothing.
+  T trimmedMean(size_t trim) const {
+    if (count_ == 0) return T();
+    if (2 * trim >= count_) return median();
+    typename std::conditional<std::is_floating_point<T>::value, double, long long>::type sum = 0;
+    for (size_t i = trim; i < count_ - trim; i++) sum += sorted_[i];
+    return (T)(sum / (long long)(count_ - 2 * trim));
+  }
+
+  T minimum() const { return count_ ? sorted_[0] : T(); }
+  T maximum() const { return count_ ? sorted_[count_ - 1] : T(); }
+
+private:
+  // First index in sorted_[0, n) whose value is not less than v
+  size_t lowerBound(T v, size_t n) const {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+      const size_t mid = (lo + hi) / 2;
+      if (sorted_[mid] < v) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  // First index in sorted_[0, n) whose value is greater than v
+  size_t upperBound(T v, size_t n) const {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+      const size_t mid = (lo + hi) / 2;
+      if (v < sorted_[mid]) hi = mid;
+      else lo = mid + 1;
+    }
+    return lo;
+  }
+
+  T      ring_[N];
+  T      sorted_[N];
+  size_t head_  = 0;  // oldest sample once full
+  size_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+// Runtime counters for GET /metrics (Prometheus text format).
+//
+// Every observation is a few relaxed atomic adds (plus a short critical
+// section for a histogram's 64-bit sum), so they stay on in production and
+// may be recorded from any task. Durations go into fixed histograms
+// (100 us .. 5 s buckets). Counters and histogram bucket/_count values are
+// 32-bit and wrap, which Prometheus' rate() treats as a reset; _sum is 64-bit
+// microseconds and does not wrap. Heap, PSRAM and WiFi gauges are read when
+// the page is rendered.
+
+enum MetricSensorStep : uint8_t {
+    METRIC_STEP_TEMP,
+    METRIC_STEP_ANALOG,
+    METRIC_STEP_ULTRASONIC,
+    METRIC_STEP_TDS,
+    METRIC_STEP_PH,
+    METRIC_STEP_CYCLE,       // whole acquisition cycle
+    METRIC_STEP_COUNT
+};
+
+// Firebase request kinds, by AsyncResult uid
+enum MetricFirebaseTask : uint8_t {
+    METRIC_FB_AUTH,          // "authTask"
+    METRIC_FB_REALTIME,      // "RTDB_RealTime"
+    METRIC_FB_RECORD,        // "RTDB_Record"
+    METRIC_FB_BATCH,         // "RTDB_Batch"
+    METRIC_FB_INT,           // "RTDB_Int"
+    METRIC_FB_STREAM,        // "controlStream" (latency = first event)
+    METRIC_FB_OTHER,
+    METRIC_FB_COUNT
+};
+
+void metricsLoopInterval(uint32_t us);                   // time between loop() entries
+void metricsSensorStep(MetricSensorStep step, uint32_t us);
+
+uint8_t metricsFirebaseTask(const char *uid);            // MetricFirebaseTask for a uid
+void    metricsFirebaseStart(uint8_t task);              // request issued
+void    metricsFirebaseDone(uint8_t task, bool ok);      // result or error received
+void    metricsFirebaseBusySkip();                       // upload skipped: firebaseBusy
+
+// The page is rendered piecewise: call with item = 0, then again with the
+// updated item until it returns 0. Each piece fits METRICS_PIECE_MAX bytes.
+#define METRICS_PIECE_MAX 2048
+size_t metricsRender(uint16_t &item, char *out, size_t max);
+
+#endif
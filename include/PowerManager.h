@@ -0,0 +1,38 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "PumpControl.h"
+
+// Board side of PowerPlan.h, built with POWER_MODE 1 or 2 (Config.h).
+//
+// Light sleep: the radio is up for a window every upload interval (records
+// produced in between wait in RecordQueue); outside the windows loop()
+// light-sleeps until a reading is due, on a timer or the service button.
+//
+// Deep sleep: every wake takes one full reading, runs the pump rules and
+// keeps the reading in RTC memory. Only the wakes that have to upload start
+// WiFi and Firebase (powerNetworkAtBoot()); they move the batch into
+// RecordQueue and stay up until it has drained or POWER_RADIO_MAX_MS. The
+// pump's cooldown is carried across sleeps and the relay pin is held OFF.
+//
+// Either mode stays awake while the pump runs. The HTTP API is only
+// reachable in radio windows; the service button keeps the radio up for
+// POWER_SERVICE_MS.
+
+#if POWER_MODE != 0
+void powerBegin(PumpControl &pump);  // first thing in setup(): wake cause, RTC state
+bool powerNetworkAtBoot();           // false on a deep-sleep wake that only takes a reading
+
+// End of loop(): radio windows and sleep. In deep-sleep mode it does not
+// return once the device goes to sleep. data/dataVersion are the snapshot
+// this loop() ran the pump rules on: deep sleep batches that reading and
+// stays awake until its version is > 0.
+void powerLoop(PumpControl &pump, uint32_t uploadEveryMs,
+               const SensorData &data, uint32_t dataVersion);
+
+uint32_t powerSleptMs();             // total time asleep since boot (light sleep)
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef POWER_PLAN_H
+#define POWER_PLAN_H
+
+#include <stdint.h>
+#include "Config.h"
+#include "SensorsData.h"
+#include "PumpControl.h"
+
+// Sleep, radio and batching decisions for POWER_MODE 1 and 2 (Config.h).
+// Free of hardware, so [env:native] runs them as well (SimMain.cpp --power);
+// PowerManager.cpp carries them out on the board.
+//
+// Pump safety: nothing here sleeps while the pump is on or an acquisition
+// cycle is in flight, so the rules in PumpControl.h keep running on every
+// loop while the relay can be on. Across deep sleep the pump's cooldown is
+// carried over with powerRebasePump().
+
+// ===== Light sleep (POWER_MODE 1) =====
+// Snapshot the caller takes at the end of loop()
+struct PowerState {
+    uint32_t nextReadingMs;  // until the next acquisition channel is due
+    uint32_t sinceRadioMs;   // radio up: how long; down: since it went down
+    uint32_t radioEveryMs;   // one radio window per this (upload interval)
+    bool     radioUp;
+    bool     radioPending;   // records queued or in flight, clock not synced
+    bool     service;        // radio must stay up (button wake, provisioning AP)
+    bool     pumpOn;
+    bool     cycleBusy;      // acquisition cycle in flight
+};
+
+// Whether the radio should be up now
+bool powerRadioWanted(const PowerState &s);
+
+// ms to light-sleep now (0 = stay awake). Wakes POWER_WARMUP_MS before the
+// next reading is due, or when the next radio window opens.
+uint32_t powerLightSleepMs(const PowerState &s);
+
+// ===== Deep sleep (POWER_MODE 2) =====
+// Readings held across deep sleep (RTC memory on the board). monoMs is a
+// clock that keeps running through sleep (PowerManager.cpp).
+struct PowerBatchEntry {
+    uint32_t   monoMs;
+    SensorData data;
+};
+
+struct PowerBatch {
+    uint16_t        count;
+    PowerBatchEntry entry[POWER_BATCH_RECORDS];
+};
+
+void powerBatchReset(PowerBatch &b);
+void powerBatchAdd(PowerBatch &b, uint32_t monoMs, const SensorData &d);  // drops the oldest when full
+
+// Whether the wake at monoMs has to bring the radio up: the reading it is
+// about to take fills the batch, the oldest one is due, or the wall clock
+// was never set (records are keyed by unix time)
+bool powerUploadWake(const PowerBatch &b, uint32_t monoMs, bool clockSet);
+
+// Unix time of entry i, given the unix time at monoNowMs
+uint32_t powerBatchTimestamp(const PowerBatch &b, uint16_t i, uint32_t unixNow, uint32_t monoNowMs);
+
+// Sleep until the next reading, POWER_DEEP_PERIOD_MS after the last wake
+uint32_t powerDeepSleepMs(uint32_t awakeMs);
+
+// Shifts the pump's times into a millis() clock that restarted elapsedMs
+// after the one they were taken on, so cooldowns survive the reboot
+void powerRebasePump(PumpControl &pc, uint32_t elapsedMs);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Per-phase latency profiler on the CPU cycle counter, built in only when
+// LOOP_PROFILER is true (Config.h); otherwise PROFILE_PHASE() compiles to
+// nothing.
+//
+// Each phase keeps count, min, max and a log-linear histogram (4 buckets per
+// power of two, so percentiles are within 25%). A phase must always be timed
+// from the same task; readers may see a sample half-recorded, which only
+// matters for the one line being dumped. Phases are timed with the cycle
+// counter of the core they run on, so they must not span more than one
+// counter wrap (~17 s at 240 MHz).
+//
+//   void loop() {
+//     PROFILE_PHASE(PROF_LOOP);
+//     { PROFILE_PHASE(PROF_WIFI_SERVER); loopWiFiAndServer(); }
+//     ...
+//
+// Dump with GET /profile (?reset=1 clears afterwards), or by sending 'p'
+// on the serial console.
+
+enum ProfPhase : uint8_t {
+    PROF_LOOP,          // whole loop() iteration
+    PROF_WIFI_SERVER,   // loopWiFiAndServer()
+    PROF_FIREBASE,      // firebaseLoop()
+    PROF_HISTORY,       // on-flash history append
+    PROF_TREND,         // trend store add
+    PROF_UPLOAD,        // firebaseSenderHandler()
+    PROF_PUMP,          // pump control block
+    PROF_SENSOR_POLL,   // pollSensors() on the acquisition task
+    PROF_PHASE_COUNT
+};
+
+#if LOOP_PROFILER
+
+void profilerRecord(ProfPhase phase, uint32_t cycles);
+void profilerReset();
+
+// One line per phase: count, min, p50, p90, p99, p99.9, max in microseconds.
+// Returns the length written to out (truncated to max).
+size_t profilerReport(char *out, size_t max);
+void   profilerLog();  // the same report on the log
+
+class ProfScope {
+public:
+    explicit ProfScope(ProfPhase phase) : phase_(phase), start_(ESP.getCycleCount()) {}
+    ~ProfScope() { profilerRecord(phase_, ESP.getCycleCount() - start_); }
+
+private:
+    ProfPhase phase_;
+    uint32_t  start_;
+};
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b)  PROF_CONCAT_(a, b)
+#define PROFILE_PHASE(phase) ProfScope PROF_CONCAT(prof_, __LINE__)(phase)
+
+#else
+
+#define PROFILE_PHASE(phase) do {} while (0)
+
+#endif
+
+#endif
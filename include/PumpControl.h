@@ -0,0 +1,55 @@
+#ifndef PUMP_CONTROL_H
+#define PUMP_CONTROL_H
+
+#include <stdint.h>
+#include "SensorsData.h"
+
+// Automatic pump rules, free of hardware so they run on the host as well
+// (see Hal.h, tools/control_replay). pumpControlStep() is called once per
+// loop() with the latest snapshot; the caller drives the relay whenever
+// `active` changes.
+//
+// In priority order: tank water level empty -> OFF; vermi tea tank at or
+// above teaBlockAt -> OFF and no ON; no ON again until the tea tank is at or
+// below teaResumeAt; ON after cooldownMs when moisture is low or the bed is
+// hot (unless it is already wetter than moistOffAbove); OFF after durationMs
+// or once moisture has recovered.
+
+struct PumpRules {
+    int      moistOnBelow;    // avg moisture % that starts the pump
+    int      moistOffAbove;   // avg moisture % that stops it
+    float    tempOnAbove;     // avg bed temperature (°C) that starts it
+    int      teaBlockAt;      // vermi tea % full: forced OFF, no ON
+    int      teaResumeAt;     // vermi tea % full: ON allowed again (hysteresis)
+    uint32_t durationMs;      // longest single run
+    uint32_t cooldownMs;      // minimum OFF time between runs
+};
+
+extern const PumpRules PUMP_RULES_DEFAULT;
+
+// Why the last transition happened
+enum PumpReason : uint8_t {
+    PUMP_REASON_NONE,
+    PUMP_REASON_WATER_EMPTY,  // OFF: tank water level <= 0
+    PUMP_REASON_TEA_FULL,     // OFF: vermi tea tank at teaBlockAt
+    PUMP_REASON_MOIST_LOW,    // ON
+    PUMP_REASON_TEMP_HIGH,    // ON (moisture was not low)
+    PUMP_REASON_DURATION,     // OFF: ran for durationMs
+    PUMP_REASON_MOIST_OK,     // OFF: moisture above moistOffAbove
+    PUMP_REASON_COUNT
+};
+
+struct PumpControl {
+    bool     active;
+    uint32_t startMs;
+    uint32_t lastOffMs;
+    uint8_t  reason;   // PumpReason of the last transition
+};
+
+// Returns true if `active` changed on this call.
+bool pumpControlStep(PumpControl &pc, const SensorData &data, uint32_t nowMs,
+                     const PumpRules &rules = PUMP_RULES_DEFAULT);
+
+const char *pumpReasonName(uint8_t reason);
+
+#endif
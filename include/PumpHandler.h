@@ -1,7 +1,8 @@
 #pragma once
-#include <Arduino.h>
+#include <stdint.h>
 
 // --- Required API ---
 void initPump();                 // call in setup()
 void setPump(bool isPump);       // ON = true, OFF = false
-
+bool pumpIsOn();                 // last state written to the relay
+uint32_t pumpChangeCount();      // grows on every ON/OFF transition
@@ -0,0 +1,35 @@
+#ifndef RECORD_QUEUE_H
+#define RECORD_QUEUE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+#include "SensorsData.h"
+
+// Store-and-forward buffer for history records that could not be uploaded.
+//
+// New records land in a RAM ring (PSRAM when available). Every
+// RECORD_QUEUE_FLUSH_AT records the ring is spilled to an append-only spool
+// file on LittleFS, so a reboot loses at most that many. Reads always return
+// the oldest records first: spool, then RAM.
+
+struct QueuedRecord {
+    uint32_t   timestamp;  // unix seconds, used as the RTDB key
+    SensorData data;
+    uint16_t   fields;     // SENSOR_FIELDS mask of the values to upload
+};
+
+bool   initRecordQueue();  // mounts LittleFS and allocates the RAM ring
+
+void   recordQueuePush(uint32_t timestamp, const SensorData &data, uint16_t fields);
+size_t recordQueuePeek(QueuedRecord *out, size_t max);  // oldest first, not removed
+void   recordQueuePop(size_t count);                    // drop the oldest count records
+void   recordQueueFlush();                              // spill RAM records to flash
+
+size_t   recordQueueSize();
+uint32_t recordQueueDropped();  // records lost because both stores were full
+
+#endif
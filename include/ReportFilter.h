@@ -0,0 +1,40 @@
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stdint.h>
+#include "SensorsData.h"
+#include "SensorFields.h"
+
+// Report-by-exception for history uploads.
+//
+// Remembers, per SENSOR_FIELDS entry tagged SENSOR_OUT_RECORD, the value and
+// time of its last upload. A field is due again once it has moved by more
+// than its deadband, gained or lost a reading (NaN), or been silent for
+// REPORT_HEARTBEAT_MS. Masks use bit i for SENSOR_FIELDS[i].
+
+// What the filter remembers per field. All zero = nothing uploaded yet.
+struct ReportFieldState {
+  float    value;  // last uploaded value (NaN = uploaded as null)
+  uint32_t atMs;
+  bool     sent;   // uploaded at least once
+};
+
+struct ReportFilterState {
+  ReportFieldState field[SENSOR_FIELD_MAX];
+};
+
+// Fields of d that are due at nowMs (0 = nothing worth uploading).
+uint16_t reportDueFields(const SensorData &d, uint32_t nowMs);
+
+// Records that the fields in mask were handed to the uploader.
+void reportCommit(const SensorData &d, uint16_t mask, uint32_t nowMs);
+
+// Same on state the caller keeps, for uploads that outlive RAM: deep sleep
+// holds it in RTC memory next to the batched readings (PowerManager.cpp),
+// with nowMs on the clock that runs through sleep.
+uint16_t reportDueFields(const ReportFilterState &st, const SensorData &d, uint32_t nowMs);
+void     reportCommit(ReportFilterState &st, const SensorData &d, uint16_t mask, uint32_t nowMs);
+
+uint32_t reportSuppressedFields();  // field values left out of committed uploads
+
+#endif
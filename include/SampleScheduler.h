@@ -0,0 +1,62 @@
+#ifndef SAMPLE_SCHEDULER_H
+#define SAMPLE_SCHEDULER_H
+
+#include <stdint.h>
+#include "SensorsData.h"
+
+// Per-channel acquisition intervals (SAMPLE_* in Config.h).
+//
+// Every channel has its own interval between fastMs and slowMs. After each
+// reading the change since the channel's previous reading is compared with
+// its delta:
+//
+//   change >= 4 x delta (or a probe appearing/vanishing)  -> fastMs
+//   change >= delta                                       -> interval / 2
+//   otherwise                                             -> interval x 2
+//
+// so a channel settles where one reading moves it by about one delta: fast
+// while the signal moves, down to slowMs while it is flat. Delta has to sit
+// above the reading noise, or the channel never backs off. Channels the pump
+// moves (moisture/water level, tea tank) are read at fastMs while it runs.
+// With ADAPTIVE_SAMPLING false every channel uses SENSOR_READ_INTERVAL.
+//
+// Due and observe are called from the sensor task only. Wait is also read by
+// loop() to plan light sleep (PowerManager.cpp); a stale answer only shifts
+// a wake-up. The bounds may be changed from any task (ControlDoc.h) once
+// sampleSchedulerInit() has run.
+
+// One per acquisition step, in step order (lines up with MetricSensorStep)
+enum SampleChannel : uint8_t {
+    SAMPLE_TEMP,        // both DS18B20 probes
+    SAMPLE_ANALOG,      // moisture 1 and 2, water level
+    SAMPLE_ULTRASONIC,  // vermi tea tank level
+    SAMPLE_TDS,
+    SAMPLE_PH,
+    SAMPLE_CHANNEL_COUNT
+};
+
+#define SAMPLE_ALL ((uint8_t)((1u << SAMPLE_CHANNEL_COUNT) - 1))
+
+const char *sampleChannelName(SampleChannel ch);  // "temp", "analog", ...
+
+// Config.h bounds, every channel due at once (initSensors() calls it)
+void sampleSchedulerInit();
+
+// Bounds in ms; false (nothing changed) unless 1000 <= fastMs <= slowMs
+bool sampleSchedulerSetBounds(SampleChannel ch, uint32_t fastMs, uint32_t slowMs);
+void sampleSchedulerBounds(SampleChannel ch, uint32_t *fastMs, uint32_t *slowMs);
+
+// Channels due at nowMs (bit per SampleChannel), and ms until the next one
+uint8_t  sampleSchedulerDue(uint32_t nowMs, bool pumpOn);
+uint32_t sampleSchedulerWaitMs(uint32_t nowMs, bool pumpOn);
+
+// A cycle over `channels` has published d; schedules their next readings
+void sampleSchedulerObserve(uint8_t channels, const SensorData &d, uint32_t nowMs, bool pumpOn);
+
+// Current interval of a channel, readings taken, and the channels whose last
+// reading moved by a delta or more (loop() uploads sooner while any do)
+uint32_t sampleSchedulerIntervalMs(SampleChannel ch);
+uint32_t sampleSchedulerReadings(SampleChannel ch);
+uint8_t  sampleSchedulerMoving();
+
+#endif
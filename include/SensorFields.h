@@ -0,0 +1,60 @@
+#ifndef SENSOR_FIELDS_H
+#define SENSOR_FIELDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SensorsData.h"
+#include "JsonWriter.h"
+
+// Describes every published SensorData field once. The HTTP responses, the
+// Firebase payloads and the serial dump all walk this table, so exposing a
+// new field is one SENSOR_FIELD() line in SensorFields.cpp.
+
+enum SensorFieldType : uint8_t {
+  SENSOR_FIELD_FLOAT,
+  SENSOR_FIELD_INT
+};
+
+// Where a field is emitted (bitmask)
+enum SensorFieldOutput : uint8_t {
+  SENSOR_OUT_HTTP   = 0x01,  // GET /get_data
+  SENSOR_OUT_RECORD = 0x02,  // /VermiBoxes/<ID>/<ts> history records
+  SENSOR_OUT_LIVE   = 0x04,  // /RealTimeData/<ID>
+  SENSOR_OUT_DEBUG  = 0x08   // serial dump after each cycle
+};
+
+struct SensorField {
+  const char *key;        // JSON key
+  const char *liveKey;    // key under /RealTimeData, nullptr = same as key
+  const char *label;      // serial dump label
+  const char *unit;       // serial dump suffix ("" for none)
+  uint16_t    offset;     // offsetof(SensorData, member)
+  uint8_t     type;       // SensorFieldType
+  uint8_t     precision;  // decimals for float fields
+  uint8_t     outputs;    // SensorFieldOutput mask
+  float       deadband;     // change needed before re-uploading (0 = any change)
+  float       deadbandPct;  // ... or this % of the last upload, whichever is larger
+};
+
+#define SENSOR_FIELD_MAX   16      // field masks are uint16_t
+#define SENSOR_FIELDS_ALL  0xFFFF
+
+extern const SensorField SENSOR_FIELDS[];
+extern const size_t      SENSOR_FIELD_COUNT;
+
+// Field value as float (int fields converted); NaN means "no reading".
+float sensorFieldValue(const SensorData &data, const SensorField &field);
+
+// Formats one field the way it appears in JSON ("23.50", "41", "null").
+size_t formatSensorField(char *out, size_t len, const SensorData &data, const SensorField &field);
+
+// Adds every field tagged with `output` (and set in `mask`, bit i =
+// SENSOR_FIELDS[i]) to the object currently open in w.
+void writeSensorFields(JsonWriter &w, const SensorData &data, uint8_t output,
+                       uint16_t mask = SENSOR_FIELDS_ALL);
+
+// Whole object for one output. Returns its length, or 0 if buf is too small.
+size_t sensorDataToJson(char *buf, size_t len, const SensorData &data, uint8_t output,
+                        uint16_t mask = SENSOR_FIELDS_ALL);
+
+#endif
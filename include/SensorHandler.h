@@ -1,10 +1,15 @@
 #ifndef SENSOR_HANDLER_H
 #define SENSOR_HANDLER_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
 #include "SensorsData.h"  // ✅ Include your struct header
+#include "Hal.h"
+#include "SampleScheduler.h"
 
-extern SensorData g_sensorData;  // ✅ Global variable for all sensor values
 extern bool setUpComplete;
 extern int valAir1 ;
 extern int valWater1 ;
@@ -17,14 +22,30 @@ extern float ULTRA_EMPTY_CM;   // distance when TANK is EMPTY (far surface)
 extern float ULTRA_FULL_CM; 
 
 void initSensors();
-void readSensors();
-int getMoistureVal(int pin, int valAir, int valWater);
 
-int getAvgMoisture();
+// Runs acquisition in its own FreeRTOS task (see SENSOR_TASK_* in Config.h).
+// Readers use getSensorData() from SensorsData.h.
+void startSensorTask();
+void sensorTaskWake();  // ends the task's idle wait early (after a light sleep)
+
+// Non-blocking acquisition: requestSensorCycle() starts a new cycle over the
+// given SampleChannel bits and pollSensors() advances it. pollSensors()
+// returns true on the call that publishes the finished snapshot. Driven by
+// the sensor task.
+void requestSensorCycle(uint8_t channels = SAMPLE_ALL);
+bool pollSensors();
+bool sensorCycleBusy();
+
+// DS18B20 resolution in bits (9..12); applied on the next cycle.
+// 9 bit ≈ 94 ms, 10 ≈ 188 ms, 11 ≈ 375 ms, 12 ≈ 750 ms conversion.
+void setTemperatureResolution(uint8_t bits);
+void scanTemperatureProbes();  // re-reads the bus; also run by initSensors()
+
+int getMoistureVal(HalAnalog ch, int valAir, int valWater);
 
 int getWaterLevel();
 float getTDSValue();
-float getPHValue();
-int getMedianNum(int bArray[], int len);
+float voltageToPH(float avgVoltage);
+int distanceToLevelPercent(float cm);
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef SENSORS_DATA_H
 #define SENSORS_DATA_H
 
+#include <stdint.h>
+
 struct SensorData {
     float temp_val_1;
     float temp_val_2;
@@ -14,6 +16,21 @@ struct SensorData {
     int   ultra_level_percent; 
 };
 
-extern SensorData g_sensorData;  // Declare global variable
+// ======================= NEW: Averaged Moisture Helper =======================
+// Returns the average of moist_percent_1 and moist_percent_2 as 0..100 (clamped).
+inline int getAvgMoisture(const SensorData &data) {
+    long sum = (long)data.moist_percent_1 + (long)data.moist_percent_2;
+    int avg  = (int)(sum / 2);
+    if (avg < 0)   avg = 0;
+    if (avg > 100) avg = 100;
+    return avg;
+}
+
+// Latest complete reading published by the acquisition task.
+// Returns a consistent copy; safe to call from any task. If version is given
+// it receives that copy's sensorDataVersion().
+SensorData getSensorData(uint32_t *version = nullptr);
+// Grows every time a new reading is published (0 = nothing yet).
+uint32_t sensorDataVersion();
 
 #endif
@@ -0,0 +1,59 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define SEQLOCK_BACKOFF() vTaskDelay(1)
+#else
+#include <thread>
+#define SEQLOCK_BACKOFF() std::this_thread::yield()
+#endif
+
+// Single-writer / multi-reader sequence lock for small POD values.
+//
+// The writer never waits. Readers copy the value and retry if a write
+// happened meanwhile, so every copy they return is a consistent snapshot.
+// The sequence number doubles as a version: it grows by 2 per store().
+template <typename T>
+class Seqlock {
+public:
+  // Only one task may call store().
+  void store(const T &value) {
+    const uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);   // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    value_ = value;
+    std::atomic_thread_fence(std::memory_order_release);
+    seq_.store(seq + 2, std::memory_order_release);   // even: stable
+  }
+
+  T load(uint32_t *version = nullptr) const {
+    T out;
+    uint32_t spins = 0;
+    for (;;) {
+      const uint32_t before = seq_.load(std::memory_order_acquire);
+      if ((before & 1) == 0) {
+        out = value_;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == before) {
+          if (version) *version = before;
+          return out;
+        }
+      }
+      // A preempted writer on our own core can only finish if we step aside
+      if (++spins % 64 == 0) SEQLOCK_BACKOFF();
+    }
+  }
+
+  uint32_t version() const { return seq_.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<uint32_t> seq_{0};
+  T value_{};
+};
+
+#endif
@@ -3,13 +3,14 @@
 
 #include <Arduino.h>
 #include "Config.h"
+#include "Log.h"
 
+// Serial sink for the logger. Messages go through LOGE/LOGW/LOGI/LOGD/LOGV
+// (Log.h); begin() opens the UART, registers it as a sink and starts the
+// drain task.
 class Debugger {
 public:
     void begin(unsigned long baud);
-    void print(const String &msg);
-    void println(const String &msg);
-    void printf(const char *format, ...);
 };
 
 // Declare global instance
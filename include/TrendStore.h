@@ -0,0 +1,75 @@
+#ifndef TREND_STORE_H
+#define TREND_STORE_H
+
+#include <Arduino.h>
+#include "SensorsData.h"
+#include "SensorFields.h"
+
+// In-RAM (PSRAM when available) time series of every SensorData field for
+// the local GET /history endpoint.
+//
+// Four tiers, each a ring of rows keyed by unix seconds:
+//
+//   raw     every published reading, TREND_RAW_SAMPLES kept
+//   minute  min/mean/max per field over 60 s,    TREND_MINUTE_ROWS kept
+//   hour    min/mean/max per field over 3600 s,  TREND_HOUR_ROWS kept
+//   day     min/mean/max per field over 86400 s, TREND_DAY_ROWS kept
+//
+// Every tier rolls up straight from the samples, so a rollup is exact and is
+// written when the first sample of the next period arrives. At boot the
+// rollup tiers are refilled from the on-flash history log (HistoryLog.h).
+//
+// One task adds samples (loop(), or the storage boot task while seeding);
+// queries may run from any task at the same time.
+
+enum TrendTier : uint8_t {
+    TREND_RAW,
+    TREND_MINUTE,
+    TREND_HOUR,
+    TREND_DAY,
+    TREND_TIER_COUNT
+};
+
+struct TrendStat {
+    float    min;
+    float    mean;
+    float    max;
+    uint16_t count;     // samples with a value (0 = no reading, stats are NaN)
+    uint16_t reserved;
+};
+
+// One output row: every field over [t, t + step)
+struct TrendPoint {
+    uint32_t  t;
+    uint16_t  samples;
+    TrendStat stat[SENSOR_FIELD_MAX];  // indexed like SENSOR_FIELDS
+};
+
+// Query state. Rows come out oldest first, grouped by step.
+struct TrendCursor {
+    uint8_t  tier;
+    uint32_t seq;   // next row to read
+    uint32_t from;
+    uint32_t to;
+    uint32_t step;
+};
+
+bool initTrendStore();  // allocates the rings
+
+// Adds one reading (timestamp in unix seconds). Samples older than the open
+// period of a tier are ignored by that tier.
+void trendStoreAdd(uint32_t timestamp, const SensorData &data);
+
+// Rebuilds the rollup tiers from the flushed on-flash history. Call once,
+// after initHistoryLog() and before the first trendStoreAdd().
+void trendStoreSeedFromHistory();
+
+// Picks the finest tier whose resolution fits step (0 = finest that still
+// covers from) and positions c at its first row. c.step ends up at least the
+// tier's resolution.
+void trendStoreQuery(TrendCursor &c, uint32_t from, uint32_t to, uint32_t step);
+bool trendStoreNext(TrendCursor &c, TrendPoint &out);  // false when done
+
+uint32_t trendTierSeconds(uint8_t tier);  // row period (raw: 0)
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+
+// Station connection state machine, driven by WiFi.onEvent() and stepped
+// from loop() without ever waiting on the radio.
+//
+// Boot order: saved credentials, then the debug SSID (DEBUG_DEFAULT_WIFI),
+// then the provisioning AP. A dropped or unreachable network is retried in
+// the background with exponential backoff (WIFI_BACKOFF_MIN_MS ..
+// WIFI_BACKOFF_MAX_MS), alternating saved and debug credentials when both
+// exist; the AP stays up until a station link exists. An attempt the access
+// point rejects fails at once instead of waiting WIFI_CONNECT_TIMEOUT_MS.
+
+enum WifiJoinResult : uint8_t {
+    WIFI_JOIN_IDLE,
+    WIFI_JOIN_CONNECTING,
+    WIFI_JOIN_SUCCESS,
+    WIFI_JOIN_FAILED
+};
+
+void wifiManagerBegin();  // registers events and starts the first attempt
+void wifiManagerLoop();
+
+bool wifiManagerConnected();
+bool wifiManagerApActive();
+void wifiManagerStopAp();  // loop task only
+
+// Provisioning: try new credentials (saved to NVS once they work). Safe to
+// call from any task. Returns false if a join is already in progress.
+bool           wifiManagerJoin(const char *ssid, const char *password);
+WifiJoinResult wifiManagerJoinResult();
+
+// Power management (PowerManager.cpp): off drops the link and powers the
+// radio down; on starts a fresh attempt with the current credentials.
+// Ignored while only the provisioning AP is up. Loop task only.
+void wifiManagerSetRadio(bool on);
+bool wifiManagerRadioOn();
+
+const char *wifiManagerStateName();
+uint32_t    wifiManagerReconnects();  // station links re-established after a drop
+
+#endif
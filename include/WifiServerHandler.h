@@ -1,9 +1,12 @@
 #pragma once
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <Preferences.h>
 
-extern WebServer server;
+// Local HTTP API on an event-driven server: requests are served from the
+// AsyncTCP task, several at a time, and never block loop(). Slow work
+// (joining a network, resetting) runs as jobs from loopWiFiAndServer().
+extern AsyncWebServer server;
 
 void setupWiFiAndServer();
 void loopWiFiAndServer();
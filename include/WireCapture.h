@@ -0,0 +1,63 @@
+#ifndef WIRE_CAPTURE_H
+#define WIRE_CAPTURE_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// HTTPS wire capture for the Firebase clients, off by default.
+//
+// While enabled, every plaintext chunk a client writes or reads is recorded
+// into a fixed ring of WIRE_CAPTURE_SLOTS slots: time, client, direction,
+// byte count and the first WIRE_CAPTURE_SNIP bytes. Consecutive chunks in
+// the same direction on the same client (less than WIRE_CAPTURE_GAP_MS
+// apart) share a slot, so a slot is roughly one request or one response.
+// The oldest slot is overwritten when the ring is full.
+//
+// Disabled, the hooks in CaptureClient cost one flag test per read/write.
+// With WIRE_CAPTURE_ENABLED false (Config.h) the hooks are not compiled in.
+// Toggle, clear and download with GET /wire_capture (WifiServerManager).
+
+enum WireDir : uint8_t {
+    WIRE_SEND,
+    WIRE_RECV
+};
+
+extern volatile bool g_wireCaptureOn;
+
+void wireCaptureEnable(bool on);
+void wireCaptureClear();
+void wireCaptureRecord(uint8_t client, WireDir dir, const uint8_t *buf, size_t len);
+
+// Slots are numbered by a running sequence; [first, end) are the ones held.
+uint32_t wireCaptureFirst();
+uint32_t wireCaptureEnd();
+
+// One slot as a text line ("<ms> c<client> >|< <bytes>B <snippet>\n"), or 0
+// if the slot has been overwritten since. Truncated to max.
+size_t wireCaptureRender(uint32_t seq, char *out, size_t max);
+
+#if WIRE_CAPTURE_ENABLED
+#include <WiFiClientSecure.h>
+
+// WiFiClientSecure that feeds wireCaptureRecord() while capture is on
+class CaptureClient : public WiFiClientSecure {
+public:
+    explicit CaptureClient(uint8_t id) : id_(id) {}
+
+    size_t write(const uint8_t *buf, size_t size) override {
+        if (g_wireCaptureOn) wireCaptureRecord(id_, WIRE_SEND, buf, size);
+        return WiFiClientSecure::write(buf, size);
+    }
+
+    int read(uint8_t *buf, size_t size) override {
+        const int r = WiFiClientSecure::read(buf, size);
+        if (r > 0 && g_wireCaptureOn) wireCaptureRecord(id_, WIRE_RECV, buf, (size_t)r);
+        return r;
+    }
+
+private:
+    uint8_t id_;
+};
+#endif
+
+#endif
@@ -0,0 +1,235 @@
+#include "JsonStream.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+struct Parser {
+  const char      *p;
+  const char      *end;
+  JsonLeafCallback cb;
+  void            *ctx;
+  uint8_t          depth;
+  size_t           pathLen;
+  char             path[JSON_STREAM_PATH_MAX];
+};
+
+void skipSpace(Parser &ps) {
+  while (ps.p < ps.end && (*ps.p == ' ' || *ps.p == '\t' || *ps.p == '\n' || *ps.p == '\r')) ps.p++;
+}
+
+// Appends "/<seg>" to the path; false if it does not fit
+bool pushSegment(Parser &ps, const char *seg, size_t len) {
+  if (ps.pathLen + 1 + len + 1 > sizeof(ps.path)) return false;
+  ps.path[ps.pathLen++] = '/';
+  memcpy(ps.path + ps.pathLen, seg, len);
+  ps.pathLen += len;
+  ps.path[ps.pathLen] = '\0';
+  return true;
+}
+
+void popTo(Parser &ps, size_t len) {
+  ps.pathLen = len;
+  ps.path[len] = '\0';
+}
+
+// At the opening quote; leaves p after the closing one
+bool scanString(Parser &ps, const char **start, size_t *len) {
+  const char *s = ++ps.p;
+  while (ps.p < ps.end && *ps.p != '"') {
+    if (*ps.p == '\\') ps.p++;  // skip the escaped byte
+    ps.p++;
+  }
+  if (ps.p >= ps.end) return false;
+  *start = s;
+  *len   = (size_t)(ps.p - s);
+  ps.p++;
+  return true;
+}
+
+bool literal(Parser &ps, const char *word, size_t n) {
+  if ((size_t)(ps.end - ps.p) < n || memcmp(ps.p, word, n) != 0) return false;
+  ps.p += n;
+  return true;
+}
+
+void emit(Parser &ps, JsonType type, const char *raw, size_t len) {
+  if (!ps.cb) return;
+  const JsonValue v = { type, raw, len };
+  ps.cb(ps.path, v, ps.ctx);
+}
+
+bool parseValue(Parser &ps);
+
+bool parseObject(Parser &ps) {
+  const size_t base = ps.pathLen;
+  ps.p++;  // '{'
+  skipSpace(ps);
+  if (ps.p < ps.end && *ps.p == '}') {
+    ps.p++;
+    return true;
+  }
+  for (;;) {
+    skipSpace(ps);
+    const char *key;
+    size_t      keyLen;
+    if (ps.p >= ps.end || *ps.p != '"' || !scanString(ps, &key, &keyLen)) return false;
+    skipSpace(ps);
+    if (ps.p >= ps.end || *ps.p != ':') return false;
+    ps.p++;
+    if (!pushSegment(ps, key, keyLen) || !parseValue(ps)) return false;
+    popTo(ps, base);
+
+    skipSpace(ps);
+    if (ps.p >= ps.end) return false;
+    if (*ps.p == '}') {
+      ps.p++;
+      return true;
+    }
+    if (*ps.p++ != ',') return false;
+  }
+}
+
+bool parseArray(Parser &ps) {
+  const size_t base = ps.pathLen;
+  ps.p++;  // '['
+  skipSpace(ps);
+  if (ps.p < ps.end && *ps.p == ']') {
+    ps.p++;
+    return true;
+  }
+  for (uint32_t i = 0;; i++) {
+    char idx[11];
+    size_t n = 0;
+    uint32_t v = i;
+    do {
+      idx[n++] = (char)('0' + v % 10);
+      v /= 10;
+    } while (v);
+    for (size_t a = 0, b = n - 1; a < b; a++, b--) {
+      const char t = idx[a];
+      idx[a] = idx[b];
+      idx[b] = t;
+    }
+    if (!pushSegment(ps, idx, n) || !parseValue(ps)) return false;
+    popTo(ps, base);
+
+    skipSpace(ps);
+    if (ps.p >= ps.end) return false;
+    if (*ps.p == ']') {
+      ps.p++;
+      return true;
+    }
+    if (*ps.p++ != ',') return false;
+  }
+}
+
+bool parseValue(Parser &ps) {
+  skipSpace(ps);
+  if (ps.p >= ps.end) return false;
+
+  const char c = *ps.p;
+  if (c == '{' || c == '[') {
+    if (ps.depth >= JSON_STREAM_DEPTH) return false;
+    ps.depth++;
+    const bool ok = c == '{' ? parseObject(ps) : parseArray(ps);
+    ps.depth--;
+    return ok;
+  }
+  if (c == '"') {
+    const char *s;
+    size_t      len;
+    if (!scanString(ps, &s, &len)) return false;
+    emit(ps, JSON_STRING, s, len);
+    return true;
+  }
+
+  const char *start = ps.p;
+  if (literal(ps, "true", 4) || literal(ps, "false", 5)) {
+    emit(ps, JSON_BOOL, start, (size_t)(ps.p - start));
+    return true;
+  }
+  if (literal(ps, "null", 4)) {
+    emit(ps, JSON_NULL, start, 4);
+    return true;
+  }
+  if (c == '-' || (c >= '0' && c <= '9')) {
+    while (ps.p < ps.end && (strchr("+-.eE", *ps.p) || (*ps.p >= '0' && *ps.p <= '9'))) ps.p++;
+    emit(ps, JSON_NUMBER, start, (size_t)(ps.p - start));
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+bool jsonStreamParse(const char *doc, size_t len, const char *basePath,
+                     JsonLeafCallback cb, void *ctx) {
+  Parser ps;
+  ps.p       = doc;
+  ps.end     = doc + len;
+  ps.cb      = cb;
+  ps.ctx     = ctx;
+  ps.depth   = 0;
+  ps.pathLen = 0;
+  ps.path[0] = '\0';
+
+  if (basePath && strcmp(basePath, "/") != 0) {
+    const size_t n = strlen(basePath);
+    if (n >= sizeof(ps.path)) return false;
+    memcpy(ps.path, basePath, n + 1);
+    ps.pathLen = n;
+  }
+
+  if (!parseValue(ps)) return false;
+  skipSpace(ps);
+  return ps.p == ps.end || *ps.p == '\0';
+}
+
+// ===== Values =====
+bool JsonValue::asBool() const {
+  if (type == JSON_BOOL)   return raw[0] == 't';
+  if (type == JSON_NUMBER) return asFloat(0.0f) != 0.0f;
+  return false;
+}
+
+float JsonValue::asFloat(float fallback) const {
+  if (type != JSON_NUMBER || len == 0 || len > 31) return fallback;
+  char num[32];  // raw is not terminated
+  memcpy(num, raw, len);
+  num[len] = '\0';
+  char *stop = nullptr;
+  const float v = strtof(num, &stop);
+  return stop == num + len && isfinite(v) ? v : fallback;
+}
+
+int32_t JsonValue::asInt(int32_t fallback) const {
+  if (type != JSON_NUMBER || len == 0 || len > 31) return fallback;
+  if (memchr(raw, '.', len) || memchr(raw, 'e', len) || memchr(raw, 'E', len)) {
+    const float v = asFloat(NAN);
+    if (isnan(v) || v >= 2147483647.0f || v <= -2147483648.0f) return fallback;
+    return (int32_t)v;
+  }
+  char num[32];  // exact for integers beyond float precision
+  memcpy(num, raw, len);
+  num[len] = '\0';
+  char *stop = nullptr;
+  const long v = strtol(num, &stop, 10);
+  return stop == num + len && v >= INT32_MIN && v <= INT32_MAX ? (int32_t)v : fallback;
+}
+
+bool JsonValue::equals(const char *s) const {
+  return strlen(s) == len && memcmp(raw, s, len) == 0;
+}
+
+bool jsonRoute(const JsonRoute *routes, size_t count, const char *path,
+               const JsonValue &value, void *ctx) {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(routes[i].path, path) != 0) continue;
+    if (!(routes[i].types & value.type)) return false;
+    routes[i].handler(value, ctx);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,74 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+// In-place JSON tokenizer with path dispatch (no Arduino dependencies, no
+// heap, no copies of the document).
+//
+// jsonStreamParse() walks a document once and reports every scalar leaf
+// with its slash-separated path; values point into the document. Object
+// keys are appended to basePath ("/" counts as empty), array elements get
+// their index:
+//
+//   base "/"      {"isPump":true,"cal":{"air":[1,2]}}
+//     -> "/isPump" true, "/cal/air/0" 1, "/cal/air/1" 2
+//   base "/isPump" true
+//     -> "/isPump" true
+//
+// jsonRoute() hands one leaf to the handler registered for its path:
+//
+//   static const JsonRoute ROUTES[] = {
+//     { "/isPump", JSON_BOOL | JSON_NUMBER, onPump },
+//   };
+//   jsonStreamParse(doc, len, dataPath, [](const char *path, const JsonValue &v, void *) {
+//     jsonRoute(ROUTES, 1, path, v, nullptr);
+//   }, nullptr);
+//
+// Nesting is limited to JSON_STREAM_DEPTH and paths to JSON_STREAM_PATH_MAX
+// bytes. Strings are passed with escapes left as they are.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_STREAM_DEPTH     8
+#define JSON_STREAM_PATH_MAX  96
+
+// Bit values, so a route can accept several
+enum JsonType : uint8_t {
+  JSON_NULL   = 0x01,
+  JSON_BOOL   = 0x02,
+  JSON_NUMBER = 0x04,
+  JSON_STRING = 0x08
+};
+
+struct JsonValue {
+  JsonType    type;
+  const char *raw;  // into the document; strings without their quotes
+  size_t      len;
+
+  bool    asBool() const;                   // true, or a non-zero number
+  int32_t asInt(int32_t fallback) const;    // numbers only (truncated)
+  float   asFloat(float fallback) const;    // numbers only
+  bool    equals(const char *s) const;      // raw text comparison
+};
+
+typedef void (*JsonLeafCallback)(const char *path, const JsonValue &value, void *ctx);
+
+// Calls cb for every leaf, in document order. Returns false if the document
+// is malformed or too deep; leaves before the error have been delivered.
+bool jsonStreamParse(const char *doc, size_t len, const char *basePath,
+                     JsonLeafCallback cb, void *ctx);
+
+typedef void (*JsonRouteHandler)(const JsonValue &value, void *ctx);
+
+struct JsonRoute {
+  const char      *path;
+  uint8_t          types;    // JsonType bits accepted
+  JsonRouteHandler handler;
+};
+
+// Runs the handler of the route for path if it accepts value.type.
+// Returns true if one ran.
+bool jsonRoute(const JsonRoute *routes, size_t count, const char *path,
+               const JsonValue &value, void *ctx);
+
+#endif
@@ -0,0 +1,146 @@
+#include "JsonWriter.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char *buf, size_t cap)
+    : buf_(buf), cap_(cap), len_(0), depth_(0), ok_(cap > 0) {
+  if (cap_) buf_[0] = '\0';
+}
+
+// ===== Low level =====
+// Keeps one byte for the terminator and one per open object for its '}'.
+bool JsonWriter::append(const char *s, size_t n) {
+  if (!ok_) return false;
+  if (len_ + n + depth_ + 1 > cap_) {
+    ok_ = false;
+    return false;
+  }
+  memcpy(buf_ + len_, s, n);
+  len_ += n;
+  buf_[len_] = '\0';
+  return true;
+}
+
+bool JsonWriter::appendEscaped(const char *s) {
+  if (!appendChar('"')) return false;
+  for (; *s; s++) {
+    const unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') {
+      const char esc[2] = { '\\', (char)c };
+      if (!append(esc, 2)) return false;
+    } else if (c < 0x20) {
+      char esc[7];
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      if (!append(esc, 6)) return false;
+    } else if (!appendChar((char)c)) {
+      return false;
+    }
+  }
+  return appendChar('"');
+}
+
+// Separator from the previous member (derived from the last byte written),
+// then "key": when a key is given.
+bool JsonWriter::beginValue(const char *key) {
+  if (!ok_) return false;
+  if (len_ > 0) {
+    const char last = buf_[len_ - 1];
+    if (last != '{' && last != '[' && last != ':' && !appendChar(',')) return false;
+  }
+  if (key && depth_ > 0) {
+    if (!appendEscaped(key) || !appendChar(':')) return false;
+  }
+  return true;
+}
+
+// ===== Structure =====
+void JsonWriter::beginObject(const char *key) {
+  if (!beginValue(key)) return;
+  depth_++;  // the '{' has to fit with the byte for its '}'
+  if (!appendChar('{')) depth_--;
+}
+
+void JsonWriter::endObject() {
+  if (depth_ == 0) return;
+  depth_--;  // releases the byte reserved for this brace
+  if (ok_) {
+    buf_[len_++] = '}';
+    buf_[len_]   = '\0';
+  }
+}
+
+void JsonWriter::rewind(const Mark &m) {
+  if (m.len > len_) return;
+  len_   = m.len;
+  depth_ = m.depth;
+  ok_    = true;
+  buf_[len_] = '\0';
+}
+
+// ===== Values =====
+void JsonWriter::addString(const char *key, const char *value) {
+  if (!beginValue(key)) return;
+  if (value) appendEscaped(value);
+  else append("null", 4);
+}
+
+void JsonWriter::addInt(const char *key, int32_t value) {
+  if (!beginValue(key)) return;
+  char tmp[12];
+  const int n = snprintf(tmp, sizeof(tmp), "%ld", (long)value);
+  append(tmp, (size_t)n);
+}
+
+void JsonWriter::addUInt(const char *key, uint32_t value) {
+  if (!beginValue(key)) return;
+  char tmp[12];
+  const int n = snprintf(tmp, sizeof(tmp), "%lu", (unsigned long)value);
+  append(tmp, (size_t)n);
+}
+
+void JsonWriter::addFloat(const char *key, float value, uint8_t precision) {
+  if (!beginValue(key)) return;
+  char tmp[24];
+  append(tmp, formatFloat(tmp, sizeof(tmp), value, precision));
+}
+
+void JsonWriter::addBool(const char *key, bool value) {
+  if (!beginValue(key)) return;
+  if (value) append("true", 4);
+  else append("false", 5);
+}
+
+void JsonWriter::addNull(const char *key) {
+  if (beginValue(key)) append("null", 4);
+}
+
+// Rounds to an integer count of 10^-precision and prints the two halves;
+// avoids the printf float path (and its scratch allocations) entirely.
+size_t JsonWriter::formatFloat(char *out, size_t len, float value, uint8_t precision) {
+  static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  if (precision > 6) precision = 6;
+
+  if (isnan(value) || isinf(value) || fabsf(value) >= 1e12f) {
+    if (len < 5) return 0;
+    memcpy(out, "null", 5);
+    return 4;
+  }
+
+  const uint32_t scale = POW10[precision];
+  double scaled = (double)value * scale;
+  const bool neg = scaled < 0;
+  if (neg) scaled = -scaled;
+  const uint64_t q = (uint64_t)(scaled + 0.5);
+  const uint64_t whole = q / scale;
+  const uint32_t frac  = (uint32_t)(q % scale);
+
+  int n;
+  if (precision == 0) {
+    n = snprintf(out, len, "%s%llu", neg && q ? "-" : "", (unsigned long long)whole);
+  } else {
+    n = snprintf(out, len, "%s%llu.%0*lu", neg && q ? "-" : "", (unsigned long long)whole,
+                 (int)precision, (unsigned long)frac);
+  }
+  return (n < 0 || (size_t)n >= len) ? 0 : (size_t)n;
+}
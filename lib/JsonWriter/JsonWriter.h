@@ -0,0 +1,67 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+// Minimal JSON writer over a caller-supplied buffer (no Arduino
+// dependencies, no heap).
+//
+// Commas and closing braces are handled by the writer: every beginObject()
+// reserves the byte for its '}', so a truncated document can always be
+// rewound to a mark() and closed cleanly. Once something does not fit,
+// ok() turns false and later appends are ignored until rewind().
+//
+//   char buf[128];
+//   JsonWriter w(buf, sizeof(buf));
+//   w.beginObject();
+//   w.addString("id", "VB-01");
+//   w.addFloat("temp", 23.456f, 2);   // "temp":23.46, NaN -> null
+//   w.endObject();
+//   if (w.ok()) send(buf, w.length());
+
+#include <stddef.h>
+#include <stdint.h>
+
+class JsonWriter {
+public:
+  struct Mark {
+    size_t  len;
+    uint8_t depth;
+  };
+
+  JsonWriter(char *buf, size_t cap);
+
+  // key is ignored at the top level / inside arrays; pass nullptr there
+  void beginObject(const char *key = nullptr);
+  void endObject();
+
+  void addString(const char *key, const char *value);
+  void addInt(const char *key, int32_t value);
+  void addUInt(const char *key, uint32_t value);
+  void addFloat(const char *key, float value, uint8_t precision);  // NaN/inf -> null
+  void addBool(const char *key, bool value);
+  void addNull(const char *key);
+
+  bool        ok() const { return ok_; }
+  size_t      length() const { return len_; }
+  const char *c_str() const { return buf_; }
+
+  Mark mark() const { return Mark{ len_, depth_ }; }
+  void rewind(const Mark &m);
+
+  // Fixed-point formatting used by addFloat(); writes "null" for NaN/inf.
+  // Returns the length written (0 if out is too small).
+  static size_t formatFloat(char *out, size_t len, float value, uint8_t precision);
+
+private:
+  bool append(const char *s, size_t n);
+  bool appendChar(char c) { return append(&c, 1); }
+  bool appendEscaped(const char *s);
+  bool beginValue(const char *key);
+
+  char   *buf_;
+  size_t  cap_;
+  size_t  len_;
+  uint8_t depth_;  // open objects, one reserved byte each
+  bool    ok_;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "LogRing.h"
+#include <string.h>
+
+enum : uint8_t {
+  SLOT_EMPTY = 0,
+  SLOT_READY = 1,
+  SLOT_PAD   = 2
+};
+
+static inline uint32_t align8(uint32_t n) {
+  return (n + 7u) & ~7u;
+}
+
+LogRing::LogRing(uint8_t *buf, uint32_t size)
+    : buf_(buf), size_(size), mask_(size - 1), reserve_(0), tail_(0), dropped_(0) {
+  memset(buf_, 0, size_);
+}
+
+uint32_t LogRing::used() const {
+  return reserve_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+}
+
+bool LogRing::push(const char *line, size_t len, uint8_t level) {
+  if (len > maxLine()) len = maxLine();
+  const uint32_t need = align8(sizeof(Slot) + (uint32_t)len);
+
+  uint32_t head = reserve_.load(std::memory_order_relaxed);
+  uint32_t pos, pad;
+  do {
+    pos = head & mask_;
+    pad = size_ - pos < need ? size_ - pos : 0;  // slot must not wrap
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head + pad + need - tail > size_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!reserve_.compare_exchange_weak(head, head + pad + need,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed));
+
+  if (pad) {
+    Slot *p  = slotAt(head);
+    p->total = (uint16_t)pad;
+    __atomic_store_n(&p->state, SLOT_PAD, __ATOMIC_RELEASE);
+    head += pad;
+  }
+
+  Slot *s   = slotAt(head);
+  s->total  = (uint16_t)need;
+  s->length = (uint16_t)len;
+  s->level  = level;
+  memcpy(s + 1, line, len);
+  __atomic_store_n(&s->state, SLOT_READY, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool LogRing::pop(char *out, size_t max, size_t *len, uint8_t *level) {
+  for (;;) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == reserve_.load(std::memory_order_acquire)) return false;
+
+    Slot *s = slotAt(tail);
+    const uint8_t state = __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);
+    if (state == SLOT_EMPTY) return false;  // reserved, still being written
+
+    const uint16_t total = s->total;
+    bool got = false;
+    if (state == SLOT_READY) {
+      const size_t n = s->length < max ? s->length : max;
+      memcpy(out, s + 1, n);
+      *len   = n;
+      *level = s->level;
+      got    = true;
+    }
+
+    memset(s, 0, total);
+    tail_.store(tail + total, std::memory_order_release);
+    if (got) return true;
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+// Multi-producer, single-consumer byte ring for log lines (no Arduino
+// dependencies, no heap, no locks).
+//
+// Each line is a slot: an 8-byte header followed by the text, padded to 8
+// bytes. A producer reserves its slot with one compare-and-swap on the
+// reservation counter, copies the text and then publishes the slot by
+// setting its state byte (release). The consumer only advances past slots
+// that are published, so lines come out complete and in reservation order
+// even with several producers racing. A slot that would straddle the end of
+// the buffer is preceded by a padding slot instead.
+//
+// The consumer zeroes every slot it releases, so space that is reserved but
+// not yet written always reads as "not ready".
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+class LogRing {
+public:
+  // buf must stay valid, size a power of two between 64 and 32768
+  LogRing(uint8_t *buf, uint32_t size);
+
+  // Copies len bytes (truncated to maxLine()). False if there is no room;
+  // the line is dropped and counted.
+  bool push(const char *line, size_t len, uint8_t level);
+
+  // Oldest published line into out (truncated to max). False if none is
+  // ready. Single consumer only.
+  bool pop(char *out, size_t max, size_t *len, uint8_t *level);
+
+  size_t   maxLine() const { return size_ / 4; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  uint32_t used() const;
+
+private:
+  struct Slot {
+    uint16_t total;   // slot bytes including this header
+    uint16_t length;  // text bytes
+    uint8_t  state;
+    uint8_t  level;
+    uint16_t reserved;
+  };
+
+  Slot *slotAt(uint32_t pos) { return reinterpret_cast<Slot *>(buf_ + (pos & mask_)); }
+
+  uint8_t              *buf_;
+  uint32_t              size_;
+  uint32_t              mask_;
+  std::atomic<uint32_t> reserve_;  // next free byte (monotonic)
+  std::atomic<uint32_t> tail_;     // oldest unreleased byte (monotonic)
+  std::atomic<uint32_t> dropped_;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "TsLog.h"
+#include <string.h>
+
+// ===== Primitives =====
+uint16_t tsLogCrc16(const uint8_t *data, size_t len, uint16_t crc) {
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static size_t putVarint(uint8_t *out, uint64_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+// Returns bytes read, 0 on overrun or an over-long encoding.
+static size_t getVarint(const uint8_t *in, size_t len, uint64_t *v) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < len && i < 10; i++) {
+    result |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+    if ((in[i] & 0x80) == 0) {
+      *v = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+static inline void putU16(uint8_t *out, uint16_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t getU16(const uint8_t *in) {
+  return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+bool tsLogValidHeader(const TsLogSegmentHeader &hdr) {
+  return hdr.magic == TSLOG_MAGIC && hdr.version == TSLOG_VERSION &&
+         hdr.fieldCount > 0 && hdr.fieldCount <= TSLOG_MAX_FIELDS;
+}
+
+// ===== Encoder =====
+TsLogBlockEncoder::TsLogBlockEncoder(uint8_t fieldCount)
+    : fields_(fieldCount > TSLOG_MAX_FIELDS ? TSLOG_MAX_FIELDS : fieldCount) {
+  reset();
+}
+
+void TsLogBlockEncoder::reset() {
+  count_     = 0;
+  len_       = 0;
+  prevTs_    = 0;
+  prevDelta_ = 0;
+  memset(prev_, 0, sizeof(prev_));
+}
+
+bool TsLogBlockEncoder::add(const TsLogRecord &rec) {
+  if (count_ == 0xFF) return false;
+
+  // Worst case: 10 (timestamp) + 3 (mask) + 10 per field
+  uint8_t tmp[10 + 3 + 10 * TSLOG_MAX_FIELDS];
+  size_t n = 0;
+
+  const int64_t delta = count_ ? (int64_t)rec.timestamp - (int64_t)prevTs_ : (int64_t)rec.timestamp;
+  n += putVarint(tmp + n, zigzag(delta - prevDelta_));
+
+  uint32_t mask = 0;
+  for (uint8_t i = 0; i < fields_; i++) {
+    if (rec.values[i] != prev_[i]) mask |= 1UL << i;
+  }
+  n += putVarint(tmp + n, mask);
+  for (uint8_t i = 0; i < fields_; i++) {
+    if (mask & (1UL << i)) n += putVarint(tmp + n, zigzag((int64_t)rec.values[i] - prev_[i]));
+  }
+
+  if (len_ + n > TSLOG_BLOCK_MAX) return false;
+  memcpy(payload_ + len_, tmp, n);
+  len_ += n;
+  count_++;
+
+  prevDelta_ = count_ > 1 ? delta : 0;
+  prevTs_    = rec.timestamp;
+  memcpy(prev_, rec.values, fields_ * sizeof(int32_t));
+  return true;
+}
+
+size_t TsLogBlockEncoder::finish(uint8_t *out, size_t outLen) const {
+  const size_t total = framedSize();
+  if (outLen < total) return 0;
+
+  out[0] = TSLOG_BLOCK_MARKER;
+  out[1] = count_;
+  putU16(out + 2, (uint16_t)len_);
+  memcpy(out + 4, payload_, len_);
+  putU16(out + 4 + len_, tsLogCrc16(out + 1, 3 + len_));
+  return total;
+}
+
+// ===== Decoder =====
+TsLogStatus tsLogDecodeBlock(const uint8_t *buf, size_t len, uint8_t fieldCount,
+                             size_t *consumed, TsLogRecordCallback cb, void *ctx) {
+  if (len < 4) return TSLOG_TRUNCATED;
+  if (buf[0] != TSLOG_BLOCK_MARKER || fieldCount == 0 || fieldCount > TSLOG_MAX_FIELDS) {
+    return TSLOG_CORRUPT;
+  }
+
+  const uint8_t  count = buf[1];
+  const uint16_t plen  = getU16(buf + 2);
+  if (count == 0 || plen == 0 || plen > TSLOG_BLOCK_MAX) return TSLOG_CORRUPT;
+  if (len < (size_t)plen + TSLOG_FRAME_BYTES) return TSLOG_TRUNCATED;
+  if (tsLogCrc16(buf + 1, 3 + plen) != getU16(buf + 4 + plen)) return TSLOG_CORRUPT;
+
+  // CRC is good. Pass 0 only validates the payload, pass 1 emits records,
+  // so a malformed block never hands out half of its records.
+  TsLogRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  const uint8_t *p   = buf + 4;
+  const uint8_t *end = p + plen;
+  uint32_t prevTs    = 0;
+  int64_t  prevDelta = 0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    p         = buf + 4;
+    prevTs    = 0;
+    prevDelta = 0;
+    memset(rec.values, 0, sizeof(rec.values));
+
+    for (uint8_t r = 0; r < count; r++) {
+      uint64_t raw;
+      size_t k = getVarint(p, end - p, &raw);
+      if (!k) return TSLOG_CORRUPT;
+      p += k;
+
+      const int64_t delta = unzigzag(raw) + prevDelta;
+      rec.timestamp = r ? (uint32_t)((int64_t)prevTs + delta) : (uint32_t)delta;
+      prevDelta     = r ? delta : 0;
+      prevTs        = rec.timestamp;
+
+      uint64_t mask;
+      k = getVarint(p, end - p, &mask);
+      if (!k || (mask >> fieldCount) != 0) return TSLOG_CORRUPT;
+      p += k;
+
+      for (uint8_t i = 0; i < fieldCount; i++) {
+        if (!(mask & (1ULL << i))) continue;
+        k = getVarint(p, end - p, &raw);
+        if (!k) return TSLOG_CORRUPT;
+        p += k;
+        rec.values[i] = (int32_t)((int64_t)rec.values[i] + unzigzag(raw));
+      }
+
+      if (pass == 1 && cb) cb(rec, ctx);
+    }
+    if (p != end) return TSLOG_CORRUPT;
+  }
+
+  *consumed = (size_t)plen + TSLOG_FRAME_BYTES;
+  return TSLOG_OK;
+}
+
+size_t tsLogScanBuffer(const uint8_t *buf, size_t len, uint8_t fieldCount, bool atEnd,
+                       TsLogRecordCallback cb, void *ctx, TsLogScanStats *stats) {
+  size_t pos = 0;
+  while (pos < len) {
+    if (buf[pos] != TSLOG_BLOCK_MARKER) {
+      pos++;
+      if (stats) stats->skippedBytes++;
+      continue;
+    }
+
+    size_t used = 0;
+    struct Counter {
+      TsLogRecordCallback cb;
+      void *ctx;
+      uint32_t n;
+      static void fwd(const TsLogRecord &rec, void *c) {
+        Counter *self = (Counter *)c;
+        self->n++;
+        if (self->cb) self->cb(rec, self->ctx);
+      }
+    } counter = { cb, ctx, 0 };
+
+    const TsLogStatus st = tsLogDecodeBlock(buf + pos, len - pos, fieldCount, &used,
+                                            Counter::fwd, &counter);
+    if (st == TSLOG_OK) {
+      pos += used;
+      if (stats) {
+        stats->blocks++;
+        stats->records += counter.n;
+      }
+    } else if (st == TSLOG_TRUNCATED && !atEnd) {
+      break;  // wait for more data
+    } else {
+      // Resync: try the next marker byte
+      pos++;
+      if (stats) {
+        stats->corruptBlocks++;
+        stats->skippedBytes++;
+      }
+    }
+  }
+  return pos;
+}
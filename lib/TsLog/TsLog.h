@@ -0,0 +1,111 @@
+#ifndef TSLOG_H
+#define TSLOG_H
+
+// Compact append-only time-series format (no Arduino dependencies, shared
+// with the host tools under tools/).
+//
+// A log is a set of segment files. Each segment is a TsLogSegmentHeader
+// followed by framed blocks:
+//
+//   u8  TSLOG_BLOCK_MARKER
+//   u8  record count
+//   u16 payload length (little endian)
+//   ... payload ...
+//   u16 CRC-16/CCITT over count, length and payload
+//
+// A block restarts the predictor, so a corrupt block only loses its own
+// records: a reader skips to the next marker whose CRC checks out.
+// Inside a block each record is
+//
+//   zigzag varint  timestamp delta-of-delta (first record: absolute)
+//   varint         bitmask of fields that changed
+//   zigzag varint  value delta, one per changed field
+//
+// so a steady, regularly sampled record costs only a few bytes.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TSLOG_MAGIC        0x4C535456UL  // "VTSL"
+#define TSLOG_VERSION      1
+#define TSLOG_MAX_FIELDS   16
+#define TSLOG_BLOCK_MARKER 0xB7
+#define TSLOG_BLOCK_MAX    512           // max payload bytes per block
+#define TSLOG_FRAME_BYTES  6             // marker + count + length + crc
+#define TSLOG_MISSING      INT32_MIN     // quantized "no value" (NaN)
+
+struct TsLogSegmentHeader {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  fieldCount;
+  uint16_t reserved;
+  uint32_t sequence;        // grows by one per segment
+  uint32_t firstTimestamp;  // timestamp of the first record written to it
+};
+
+struct TsLogRecord {
+  uint32_t timestamp;
+  int32_t  values[TSLOG_MAX_FIELDS];
+};
+
+enum TsLogStatus : uint8_t {
+  TSLOG_OK,
+  TSLOG_TRUNCATED,  // block runs past the end of the buffer
+  TSLOG_CORRUPT     // bad marker, length or CRC
+};
+
+typedef void (*TsLogRecordCallback)(const TsLogRecord &rec, void *ctx);
+
+struct TsLogScanStats {
+  uint32_t blocks;
+  uint32_t records;
+  uint32_t corruptBlocks;
+  uint32_t skippedBytes;
+};
+
+uint16_t tsLogCrc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+bool tsLogValidHeader(const TsLogSegmentHeader &hdr);
+
+// Builds one block in memory.
+class TsLogBlockEncoder {
+public:
+  explicit TsLogBlockEncoder(uint8_t fieldCount);
+
+  void reset();
+
+  // Appends a record. Returns false (and leaves the block unchanged) when it
+  // does not fit; finish() the block and start a new one.
+  bool add(const TsLogRecord &rec);
+
+  uint8_t count() const { return count_; }
+  bool    empty() const { return count_ == 0; }
+  size_t  framedSize() const { return len_ + TSLOG_FRAME_BYTES; }
+
+  // Writes the framed block to out. Returns the number of bytes written,
+  // or 0 if out is too small.
+  size_t finish(uint8_t *out, size_t outLen) const;
+
+private:
+  uint8_t  fields_;
+  uint8_t  count_;
+  size_t   len_;
+  uint32_t prevTs_;
+  int64_t  prevDelta_;
+  int32_t  prev_[TSLOG_MAX_FIELDS];
+  uint8_t  payload_[TSLOG_BLOCK_MAX];
+};
+
+// Decodes the framed block at buf. On TSLOG_OK *consumed is its framed size
+// and every record has been passed to cb.
+TsLogStatus tsLogDecodeBlock(const uint8_t *buf, size_t len, uint8_t fieldCount,
+                             size_t *consumed, TsLogRecordCallback cb, void *ctx);
+
+// Decodes all complete blocks in buf, skipping corrupt bytes up to the next
+// marker. Returns how many bytes were consumed; the rest is an incomplete
+// block to retry once more data has been appended. With atEnd set nothing
+// more is coming, so an incomplete block is skipped like a corrupt one.
+size_t tsLogScanBuffer(const uint8_t *buf, size_t len, uint8_t fieldCount, bool atEnd,
+                       TsLogRecordCallback cb, void *ctx, TsLogScanStats *stats);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef TSLOG_CONTROL_H
+#define TSLOG_CONTROL_H
+
+// Control trace records in the TsLog format: the inputs the pump rules read
+// and the relay state, one record per published reading and one per relay
+// change. Written by ControlTrace.cpp on the device, read back by
+// tools/control_replay.
+//
+// This table is part of the on-flash format: only ever append new fields
+// at the end, and bump TSLOG_VERSION if an existing entry has to change.
+
+#include <string.h>
+#include "TsLogSensor.h"
+
+enum ControlTraceEvent : uint8_t {
+  CTRACE_READING,       // new SensorData published
+  CTRACE_PUMP_AUTO,     // relay changed by the pump rules
+  CTRACE_PUMP_EXTERNAL  // relay changed by someone else (RTDB isPump)
+};
+
+struct ControlTraceEntry {
+  uint32_t   timestamp;  // unix seconds, 0 before the clock was synced
+  uint32_t   uptimeMs;   // millis() on the device; drops back on reboot
+  uint8_t    event;      // ControlTraceEvent
+  bool       pumpOn;     // relay state after the event
+  uint8_t    reason;     // PumpReason for CTRACE_PUMP_AUTO
+  SensorData data;       // control inputs (fields below only)
+};
+
+static const TsLogFieldInfo TSLOG_CONTROL_FIELDS[] = {
+  { "uptime_ms",             1.0f },
+  { "event",                 1.0f },
+  { "pump",                  1.0f },
+  { "reason",                1.0f },
+  { "temp0",                16.0f },  // DS18B20 steps are 1/16 °C: stored exactly
+  { "temp1",                16.0f },
+  { "moisture1",             1.0f },
+  { "moisture2",             1.0f },
+  { "water_level",          10.0f },
+  { "ultra_level_percent",   1.0f },
+};
+
+static const uint8_t TSLOG_CONTROL_FIELD_COUNT =
+    sizeof(TSLOG_CONTROL_FIELDS) / sizeof(TSLOG_CONTROL_FIELDS[0]);
+
+inline void tsLogFromControl(const ControlTraceEntry &e, TsLogRecord &rec) {
+  const SensorData &d = e.data;
+  rec.timestamp = e.timestamp;
+  rec.values[0] = (int32_t)e.uptimeMs;
+  rec.values[1] = e.event;
+  rec.values[2] = e.pumpOn ? 1 : 0;
+  rec.values[3] = e.reason;
+  rec.values[4] = tsLogQuantize(d.temp_val_1, TSLOG_CONTROL_FIELDS[4].scale);
+  rec.values[5] = tsLogQuantize(d.temp_val_2, TSLOG_CONTROL_FIELDS[5].scale);
+  rec.values[6] = d.moist_percent_1;
+  rec.values[7] = d.moist_percent_2;
+  rec.values[8] = tsLogQuantize(d.water_level, TSLOG_CONTROL_FIELDS[8].scale);
+  rec.values[9] = d.ultra_level_percent;
+}
+
+inline void tsLogToControl(const TsLogRecord &rec, ControlTraceEntry &e) {
+  SensorData &d = e.data;
+  memset(&d, 0, sizeof(d));
+  e.timestamp = rec.timestamp;
+  e.uptimeMs  = (uint32_t)rec.values[0];
+  e.event     = (uint8_t)rec.values[1];
+  e.pumpOn    = rec.values[2] != 0;
+  e.reason    = (uint8_t)rec.values[3];
+  d.temp_val_1          = tsLogDequantize(rec.values[4], TSLOG_CONTROL_FIELDS[4].scale);
+  d.temp_val_2          = tsLogDequantize(rec.values[5], TSLOG_CONTROL_FIELDS[5].scale);
+  d.moist_percent_1     = rec.values[6];
+  d.moist_percent_2     = rec.values[7];
+  d.water_level         = tsLogDequantize(rec.values[8], TSLOG_CONTROL_FIELDS[8].scale);
+  d.ultra_level_percent = rec.values[9];
+}
+
+#endif
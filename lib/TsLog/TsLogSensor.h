@@ -0,0 +1,76 @@
+#ifndef TSLOG_SENSOR_H
+#define TSLOG_SENSOR_H
+
+// SensorData <-> TsLogRecord mapping. Values are stored as fixed-point
+// integers (value * scale); NaN is stored as TSLOG_MISSING.
+//
+// This table is part of the on-flash format: only ever append new fields
+// at the end, and bump TSLOG_VERSION if an existing entry has to change.
+
+#include <math.h>
+#include "TsLog.h"
+#include "SensorsData.h"
+
+struct TsLogFieldInfo {
+  const char *name;
+  float       scale;
+};
+
+static const TsLogFieldInfo TSLOG_SENSOR_FIELDS[] = {
+  { "temp0",               100.0f },
+  { "temp1",               100.0f },
+  { "moisture1",             1.0f },
+  { "moisture2",             1.0f },
+  { "avg_moisture",          1.0f },
+  { "water_level",          10.0f },
+  { "tds_val",              10.0f },
+  { "ph_val",              100.0f },
+  { "ultra_distance_cm",    10.0f },
+  { "ultra_level_percent",   1.0f },
+};
+
+static const uint8_t TSLOG_SENSOR_FIELD_COUNT =
+    sizeof(TSLOG_SENSOR_FIELDS) / sizeof(TSLOG_SENSOR_FIELDS[0]);
+
+inline int32_t tsLogQuantize(float v, float scale) {
+  if (isnan(v)) return TSLOG_MISSING;
+  const float q = roundf(v * scale);
+  if (q >= 2147483647.0f || q <= -2147483647.0f) return TSLOG_MISSING;
+  return (int32_t)q;
+}
+
+inline float tsLogDequantize(int32_t q, float scale) {
+  return q == TSLOG_MISSING ? NAN : (float)q / scale;
+}
+
+inline void tsLogFromSensorData(uint32_t timestamp, const SensorData &d, TsLogRecord &rec) {
+  const float v[] = {
+    d.temp_val_1, d.temp_val_2,
+    (float)d.moist_percent_1, (float)d.moist_percent_2, (float)d.avg_moisture,
+    d.water_level, d.tds_val, d.ph_val,
+    d.ultra_distance_cm, (float)d.ultra_level_percent,
+  };
+  rec.timestamp = timestamp;
+  for (uint8_t i = 0; i < TSLOG_SENSOR_FIELD_COUNT; i++) {
+    rec.values[i] = tsLogQuantize(v[i], TSLOG_SENSOR_FIELDS[i].scale);
+  }
+}
+
+inline void tsLogToSensorData(const TsLogRecord &rec, SensorData &d) {
+  float v[TSLOG_SENSOR_FIELD_COUNT];
+  for (uint8_t i = 0; i < TSLOG_SENSOR_FIELD_COUNT; i++) {
+    v[i] = tsLogDequantize(rec.values[i], TSLOG_SENSOR_FIELDS[i].scale);
+  }
+  d.temp_val_1          = v[0];
+  d.temp_val_2          = v[1];
+  d.moist_percent_1     = isnan(v[2]) ? 0 : (int)v[2];
+  d.moist_percent_2     = isnan(v[3]) ? 0 : (int)v[3];
+  d.avg_moisture        = isnan(v[4]) ? 0 : (int)v[4];
+  d.water_level         = v[5];
+  d.tds_val             = v[6];
+  d.ph_val              = v[7];
+  d.ultra_distance_cm   = v[8];
+  d.ultra_level_percent = isnan(v[9]) ? 0 : (int)v[9];
+}
+
+#endif
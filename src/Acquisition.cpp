@@ -0,0 +1,371 @@
+#include "SensorHandler.h"
+#include <math.h>
+#include "Config.h"
+#include "Hal.h"
+#include "Log.h"
+#include "Seqlock.h"
+#include "MedianFilter.h"
+#include "SensorFields.h"
+#include "BootTrace.h"
+#include "Metrics.h"
+#include "SampleScheduler.h"
+
+// Acquisition state machine, conversions and calibration. Hardware access
+// goes through Hal.h only, so this file also builds for [env:native].
+
+#define VREF   3.3
+
+// Calibration values
+int  valAir1   = 3018;
+int  valWater1 = 1710;
+int  valAir2   = 3018;
+int  valWater2 = 1710;
+// float Tankempty = 10;
+// float TankFull  = 3;
+bool setUpComplete = true;
+
+// ✅ Published readings (written by the sensor task only)
+static Seqlock<SensorData> s_published;
+
+SensorData getSensorData(uint32_t *version) {
+  uint32_t seq = 0;
+  const SensorData data = s_published.load(&seq);
+  if (version) *version = seq / 2;
+  return data;
+}
+
+uint32_t sensorDataVersion() {
+  return s_published.version() / 2;
+}
+
+// 🔊 Ultrasonic
+#define ULTRA_TIMEOUT_US   30000UL  // ~5 m max window
+#define ULTRA_SAMPLES      5        // readings per cycle (median)
+#define ULTRA_GAP_MS       20       // pause between readings
+
+// Calibrate these to your actual tank distances
+float ULTRA_EMPTY_CM = 14.0f;  // distance when tank is EMPTY (farther)
+float ULTRA_FULL_CM  = 4.0f;   // distance when tank is FULL  (nearer)
+
+// Arduino's map()/constrain(), which are not available on the host. Like
+// arduino-esp32's map(), an empty input range gives -1 instead of dividing
+// by zero (air == water calibration).
+static int mapRange(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return -1;
+  return (int)((x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin);
+}
+
+static int clampInt(int v, int lo, int hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// ------------------ DS18B20 probes ------------------
+// The HAL caches ROM codes at scan time. A re-scan is only scheduled when a
+// probe stops answering (or was missing at the last scan).
+#define TEMP_PROBES            2
+#define TEMP_RESCAN_INTERVAL   60000UL  // ms between scans while a probe is missing
+
+static bool          s_tempFound[TEMP_PROBES] = {false};
+static bool          s_tempRescan     = true;
+static uint32_t      s_tempLastScanMs = 0;
+static uint8_t       s_tempResolution = TEMP_RESOLUTION;
+static uint16_t      s_tempConvMs     = 750;
+
+void scanTemperatureProbes() {
+  const uint8_t found = halTempScan(TEMP_PROBES, s_tempResolution, &s_tempConvMs);
+  for (uint8_t i = 0; i < TEMP_PROBES; i++) s_tempFound[i] = i < found;
+
+  s_tempRescan     = found < TEMP_PROBES;
+  s_tempLastScanMs = halMillis();
+
+  LOGI("TEMP", "%u probe(s) found, %u-bit, %u ms conversion",
+       found, s_tempResolution, s_tempConvMs);
+}
+
+void setTemperatureResolution(uint8_t bits) {
+  s_tempResolution = (uint8_t)clampInt(bits, 9, 12);
+  s_tempRescan     = true;
+  s_tempLastScanMs = halMillis() - TEMP_RESCAN_INTERVAL;  // apply on next cycle
+}
+
+// Converts a measured echo width into cm. A width of 0 means timeout.
+static float echoWidthToCM(uint32_t duration) {
+  if (duration == 0) {
+    // Timeout → no echo; wiring/voltage-level/angle issue likely
+    LOGD("ULTRA", "timeout (no echo)");
+    // Return a far distance so level% computes to ~0
+    return ULTRA_EMPTY_CM + 100.0f;
+  }
+
+  // HC-SR04 formula: distance(cm) = duration(µs) / 58.0
+  float cm = duration / 58.0f;
+
+  // Basic sanity clamp (HC-SR04 ~2–400 cm). Discard glitches.
+  if (cm < 2.0f || cm > 400.0f) {
+    LOGD("ULTRA", "out-of-range: %.1f cm", cm);
+    return ULTRA_EMPTY_CM + 100.0f;
+  }
+
+  return cm;
+}
+
+int distanceToLevelPercent(float cm) {
+  // Map distance (empty..full) → 0..100%, then clamp
+  // When cm == ULTRA_FULL_CM  → 100%
+  // When cm == ULTRA_EMPTY_CM → 0%
+  
+  // Ensure that the cm value is within the range of valid values
+  if (cm < ULTRA_FULL_CM) {
+    return 100;  // 100% full
+  }
+  if (cm > ULTRA_EMPTY_CM) {
+    return 0;    // 0% full
+  }
+
+  int percent = (int) roundf(
+      (ULTRA_EMPTY_CM - cm) * 100.0f / (ULTRA_EMPTY_CM - ULTRA_FULL_CM)
+  );
+  return clampInt(percent, 0, 100);  // Ensure percent stays between 0% and 100%
+}
+
+// ------------------ Incremental acquisition ------------------
+// A cycle walks through the channels below. Each step only ever does a short,
+// bounded amount of work per call and returns false while it is waiting on
+// hardware, so pollSensors() can be called from loop() on every iteration.
+// The published snapshot is only replaced once every channel has finished.
+// Steps whose channel was not requested are skipped and keep their values
+// from the previous snapshot (SampleScheduler.h decides what is due).
+enum AcqStep : uint8_t {
+  STEP_IDLE,
+  STEP_TEMP,
+  STEP_ANALOG,
+  STEP_ULTRASONIC,
+  STEP_TDS,
+  STEP_PH,
+  STEP_PUBLISH
+};
+
+static AcqStep    s_step = STEP_IDLE;
+static SensorData s_pending;
+static uint8_t    s_channels = SAMPLE_ALL;  // SampleChannel bits of this cycle
+
+// Step-local progress, reset by requestSensorCycle()
+static uint8_t  s_phase     = 0;
+static uint8_t  s_sampleIdx = 0;
+static uint32_t s_stepMs    = 0;
+
+// Step and cycle start times for the acquisition metrics
+static uint32_t s_stepStartUs  = 0;
+static uint32_t s_cycleStartUs = 0;
+static MedianFilter<float, ULTRA_SAMPLES> s_ultraFilter;
+
+static bool stepTemperature(uint32_t now) {
+  if (s_phase == 0) {
+    if (s_tempRescan && now - s_tempLastScanMs >= TEMP_RESCAN_INTERVAL) {
+      scanTemperatureProbes();
+    }
+    halTempRequest();
+    s_stepMs = now;
+    s_phase  = 1;
+    return false;
+  }
+
+  if (now - s_stepMs < s_tempConvMs) return false;
+
+  float *out[TEMP_PROBES] = { &s_pending.temp_val_1, &s_pending.temp_val_2 };
+  for (uint8_t i = 0; i < TEMP_PROBES; i++) {
+    *out[i] = NAN;
+    if (!s_tempFound[i]) continue;
+
+    const float c = halTempRead(i);
+    if (isnan(c)) {
+      // Probe dropped out: re-scan before the next conversion
+      s_tempFound[i]   = false;
+      s_tempRescan     = true;
+      s_tempLastScanMs = now - TEMP_RESCAN_INTERVAL;
+      continue;
+    }
+    *out[i] = c;
+  }
+
+  return true;
+}
+
+static bool stepAnalog(uint32_t /*now*/) {
+  s_pending.moist_percent_1 = getMoistureVal(HAL_AIN_MOISTURE_1, valAir1, valWater1);
+  s_pending.moist_percent_2 = getMoistureVal(HAL_AIN_MOISTURE_2, valAir2, valWater2);
+  s_pending.water_level     = getWaterLevel();
+  return true;
+}
+
+// 🔊 Several reads, median for stability
+static bool stepUltrasonic(uint32_t now) {
+  switch (s_phase) {
+    case 0:  // trigger
+      halUltraTrigger();
+      s_stepMs = now;
+      s_phase  = 1;
+      return false;
+
+    case 1: {  // wait for echo or timeout
+      uint32_t widthUs = 0;
+      const bool done = halUltraEcho(&widthUs);
+      if (!done && now - s_stepMs <= ULTRA_TIMEOUT_US / 1000UL) return false;
+
+      if (s_sampleIdx == 0) s_ultraFilter.reset();
+      s_ultraFilter.push(echoWidthToCM(done ? widthUs : 0));
+      if (++s_sampleIdx < ULTRA_SAMPLES) {
+        s_stepMs = now;
+        s_phase  = 2;
+        return false;
+      }
+
+      const float dist_cm = s_ultraFilter.median();
+      s_pending.ultra_distance_cm   = dist_cm;
+      s_pending.ultra_level_percent = distanceToLevelPercent(dist_cm);
+      return true;
+    }
+
+    default:  // small gap to let echoes die out before the next trigger
+      if (now - s_stepMs >= ULTRA_GAP_MS) s_phase = 0;
+      return false;
+  }
+}
+
+static bool stepTDS(uint32_t /*now*/) {
+  s_pending.tds_val = getTDSValue();
+  return true;
+}
+
+// Averaged on demand from the continuously sampled ADS1115 ring
+static bool stepPH(uint32_t /*now*/) {
+  const float volts = halPhVolts(PH_AVG_SAMPLES);
+  s_pending.ph_val = isnan(volts) ? NAN : voltageToPH(volts);
+  return true;
+}
+
+// Formatting is skipped entirely when LOGD is compiled out
+static void logSensorData(const SensorData &d) {
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  char value[24];
+  LOGD("SENSOR", "readings:");
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    const SensorField &f = SENSOR_FIELDS[i];
+    if (!(f.outputs & SENSOR_OUT_DEBUG)) continue;
+    formatSensorField(value, sizeof(value), d, f);
+    LOGD("SENSOR", "  %s: %s%s", f.label, value, f.unit);
+  }
+  LOGD("SENSOR", "  Avg Moisture: %d", getAvgMoisture(d));
+#endif
+}
+
+void requestSensorCycle(uint8_t channels) {
+  if (s_step != STEP_IDLE || channels == 0) return;  // previous cycle still running
+
+  s_pending = s_published.load();
+  if (channels & (1u << SAMPLE_TEMP)) {
+    s_pending.temp_val_1 = NAN;
+    s_pending.temp_val_2 = NAN;
+  }
+
+  s_channels     = channels;
+  s_step         = STEP_TEMP;
+  s_phase        = 0;
+  s_sampleIdx    = 0;
+  s_cycleStartUs = halMicros();
+  s_stepStartUs  = s_cycleStartUs;
+}
+
+bool sensorCycleBusy() {
+  return s_step != STEP_IDLE;
+}
+
+bool pollSensors() {
+  const uint32_t now = halMillis();
+
+  // Run consecutive steps until one has to wait on hardware
+  while (s_step != STEP_IDLE) {
+    // AcqStep STEP_TEMP..STEP_PH line up with SampleChannel
+    if (s_step < STEP_PUBLISH && !(s_channels & (1u << (s_step - STEP_TEMP)))) {
+      s_step = (AcqStep)(s_step + 1);
+      continue;
+    }
+
+    bool done = false;
+    switch (s_step) {
+      case STEP_TEMP:       done = stepTemperature(now); break;
+      case STEP_ANALOG:     done = stepAnalog(now);      break;
+      case STEP_ULTRASONIC: done = stepUltrasonic(now);  break;
+      case STEP_TDS:        done = stepTDS(now);         break;
+      case STEP_PH:         done = stepPH(now);          break;
+      case STEP_PUBLISH:
+        s_published.store(s_pending);
+        metricsSensorStep(METRIC_STEP_CYCLE, halMicros() - s_cycleStartUs);
+        bootMark(BOOT_FIRST_READING);
+        s_step = STEP_IDLE;
+        logSensorData(s_pending);
+        return true;
+      default:
+        s_step = STEP_IDLE;
+        return false;
+    }
+    if (!done) return false;
+
+    // ... and with MetricSensorStep
+    const uint32_t nowUs = halMicros();
+    metricsSensorStep((MetricSensorStep)(s_step - STEP_TEMP), nowUs - s_stepStartUs);
+    s_stepStartUs = nowUs;
+
+    s_step      = (AcqStep)(s_step + 1);
+    s_phase     = 0;
+    s_sampleIdx = 0;
+  }
+  return false;
+}
+
+// ------------------ Conversions ------------------
+int getMoistureVal(HalAnalog ch, int airVal, int waterVal){
+  int rawVal  = halAnalogMean(ch, ADC_MEAN_SAMPLES);
+  int percent = mapRange(rawVal, waterVal, airVal, 100, 0);
+  return clampInt(percent, 0, 100);
+}
+
+int getWaterLevel(){
+  int water_level   = halAnalogMean(HAL_AIN_WATER_LEVEL, ADC_MEAN_SAMPLES);
+  int water_percent = mapRange(water_level, 0, 2460, 0, 100);
+  return clampInt(water_percent, 0, 100);
+}
+
+float getTDSValue() {
+  // Rolling median over the newest ADC_MEDIAN_WINDOW samples (~1.2 s of
+  // DMA-decimated data), maintained by the sampler as samples arrive
+  const int raw = halAnalogMedian(HAL_AIN_TDS);
+  float averageVoltage = raw * VREF / 4095.0;
+
+  LOGV("TDS", "average voltage %.3f V", averageVoltage);
+
+  // Linear interpolation between two calibration points
+  float V1 = 0.55;  // Voltage at 84 µS/cm
+  float TDS1 = 84;  // µS/cm
+  float V2 = 1.81;  // Voltage at 1413 µS/cm
+  float TDS2 = 1413;
+
+  float tdsValue = ((TDS2 - TDS1) / (V2 - V1)) * (averageVoltage - V1) + TDS1;
+  return tdsValue;
+}
+
+float voltageToPH(float avgVoltage) {
+  // Two-point calibration values (adjust to your sensor)
+  float voltage_pH6_86 = 2.46;
+  float voltage_pH9_18 = 2.20;
+  float pH6_86 = 6.86;
+  float pH9_18 = 9.18;
+
+  // Compute slope (voltage difference per pH unit)
+  float pH_step = (voltage_pH9_18 - voltage_pH6_86) / (pH9_18 - pH6_86);
+
+  // Calculate pH based on average voltage
+  float pH_value = (avgVoltage - voltage_pH6_86) / pH_step + pH6_86;
+
+  return pH_value;
+}
@@ -0,0 +1,152 @@
+#include "AdcSampler.h"
+#include <driver/adc.h>
+#include "Config.h"
+#include "MedianFilter.h"
+#include "Log.h"
+
+#define ADC_FRAME_BYTES 1024  // bytes handed over per DMA interrupt
+
+// GPIO32..35 are ADC1 channels 4..7, in AdcChannel order
+static const adc_channel_t ADC_HW_CHANNEL[ADC_CH_COUNT] = {
+    ADC_CHANNEL_4, ADC_CHANNEL_5, ADC_CHANNEL_6, ADC_CHANNEL_7
+};
+
+struct AdcRing {
+    uint16_t samples[ADC_RING_SAMPLES];
+    uint8_t  head;   // next write position
+    uint8_t  count;
+};
+
+static AdcRing      s_rings[ADC_CH_COUNT];
+static MedianFilter<uint16_t, ADC_MEDIAN_WINDOW> s_medians[ADC_CH_COUNT];
+static portMUX_TYPE s_ringMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task    = nullptr;
+static volatile bool s_running = false;
+
+static int channelIndex(uint8_t hwChannel) {
+    for (int i = 0; i < ADC_CH_COUNT; i++) {
+        if (ADC_HW_CHANNEL[i] == hwChannel) return i;
+    }
+    return -1;
+}
+
+static void adcSamplerTask(void *) {
+    static uint8_t frame[ADC_FRAME_BYTES];
+    uint32_t sum[ADC_CH_COUNT]   = {0};
+    uint32_t count[ADC_CH_COUNT] = {0};
+    uint32_t windowStart = millis();
+
+    for (;;) {
+        uint32_t got = 0;
+        const esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &got, ADC_MAX_DELAY);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) continue;
+
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&frame[i];
+            const int idx = channelIndex(p->type1.channel);
+            if (idx < 0) continue;
+            sum[idx] += p->type1.data;
+            count[idx]++;
+        }
+
+        const uint32_t now = millis();
+        if (now - windowStart < ADC_DECIMATE_MS) continue;
+        windowStart = now;
+
+        // Decimate: one averaged sample per channel into its ring
+        portENTER_CRITICAL(&s_ringMux);
+        for (int c = 0; c < ADC_CH_COUNT; c++) {
+            if (count[c] == 0) continue;
+            const uint16_t v = (uint16_t)(sum[c] / count[c]);
+            AdcRing &ring = s_rings[c];
+            ring.samples[ring.head] = v;
+            ring.head = (ring.head + 1) % ADC_RING_SAMPLES;
+            if (ring.count < ADC_RING_SAMPLES) ring.count++;
+            s_medians[c].push(v);
+        }
+        portEXIT_CRITICAL(&s_ringMux);
+
+        memset(sum, 0, sizeof(sum));
+        memset(count, 0, sizeof(count));
+    }
+}
+
+bool startAdcSampler() {
+    if (s_running) return true;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = ADC_FRAME_BYTES * 4;
+    init.conv_num_each_intr = ADC_FRAME_BYTES;
+    for (int i = 0; i < ADC_CH_COUNT; i++) init.adc1_chan_mask |= BIT(ADC_HW_CHANNEL[i]);
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) {
+        LOGW("ADC", "DMA init failed, falling back to analogRead()");
+        return false;
+    }
+
+    static adc_digi_pattern_config_t pattern[ADC_CH_COUNT];
+    for (int i = 0; i < ADC_CH_COUNT; i++) {
+        pattern[i].atten     = ADC_ATTEN_DB_11;  // same range as analogRead()
+        pattern[i].channel   = ADC_HW_CHANNEL[i] & 0x7;
+        pattern[i].unit      = 0;                // ADC1
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_configuration_t cfg = {};
+    cfg.conv_limit_en  = 1;
+    cfg.conv_limit_num = 250;
+    cfg.pattern_num    = ADC_CH_COUNT;
+    cfg.adc_pattern    = pattern;
+    cfg.sample_freq_hz = ADC_SAMPLE_RATE_HZ;
+    cfg.conv_mode      = ADC_CONV_SINGLE_UNIT_1;
+    cfg.format         = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    if (adc_digi_controller_configure(&cfg) != ESP_OK || adc_digi_start() != ESP_OK) {
+        adc_digi_deinitialize();
+        LOGW("ADC", "DMA start failed, falling back to analogRead()");
+        return false;
+    }
+
+    xTaskCreatePinnedToCore(adcSamplerTask, "adc", 3072, nullptr,
+                            ADC_SAMPLER_PRIORITY, &s_task, SENSOR_TASK_CORE);
+    s_running = true;
+    LOGI("ADC", "continuous sampling at %d Hz", ADC_SAMPLE_RATE_HZ);
+    return true;
+}
+
+bool adcSamplerRunning() {
+    return s_running;
+}
+
+size_t adcSamplerCopy(AdcChannel ch, int *out, size_t max) {
+    if (ch >= ADC_CH_COUNT || max == 0) return 0;
+
+    portENTER_CRITICAL(&s_ringMux);
+    const AdcRing &ring = s_rings[ch];
+    const size_t n = ring.count < max ? ring.count : max;
+    size_t idx = (ring.head + ADC_RING_SAMPLES - n) % ADC_RING_SAMPLES;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ring.samples[idx];
+        idx = (idx + 1) % ADC_RING_SAMPLES;
+    }
+    portEXIT_CRITICAL(&s_ringMux);
+    return n;
+}
+
+int adcSamplerMean(AdcChannel ch, uint8_t n) {
+    int samples[ADC_RING_SAMPLES];
+    const size_t got = adcSamplerCopy(ch, samples, n < ADC_RING_SAMPLES ? n : ADC_RING_SAMPLES);
+    if (got == 0) return -1;
+    long sum = 0;
+    for (size_t i = 0; i < got; i++) sum += samples[i];
+    return (int)(sum / (long)got);
+}
+
+int adcSamplerMedian(AdcChannel ch) {
+    if (ch >= ADC_CH_COUNT) return -1;
+
+    portENTER_CRITICAL(&s_ringMux);
+    const int median = s_medians[ch].empty() ? -1 : s_medians[ch].median();
+    portEXIT_CRITICAL(&s_ringMux);
+    return median;
+}
@@ -0,0 +1,95 @@
+#include "AdsSampler.h"
+#include <Adafruit_ADS1X15.h>
+#include "Config.h"
+#include "Log.h"
+
+// Conversions per second for the ADS1115 data-rate codes (bits 7:5 of config)
+static const uint16_t ADS1115_SPS[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+
+static Adafruit_ADS1115 ads;
+
+static float         s_ring[PH_RING_SAMPLES];
+static uint8_t       s_head  = 0;
+static uint8_t       s_count = 0;
+static portMUX_TYPE  s_ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t  s_task        = nullptr;
+static volatile bool s_running     = false;
+static uint32_t      s_missedReady = 0;
+
+static void IRAM_ATTR onAdsReady() {
+    BaseType_t woken = pdFALSE;
+    if (s_task) vTaskNotifyGiveFromISR(s_task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+static void adsTask(void *) {
+    // Two conversion periods without RDY means the line is missing or a
+    // pulse was lost; read anyway, the register holds the latest result
+    const uint32_t periodMs  = 1000UL / adsSamplerRateSps();
+    const TickType_t timeout = pdMS_TO_TICKS(2 * periodMs + 2);
+
+    for (;;) {
+        if (ulTaskNotifyTake(pdTRUE, timeout > 0 ? timeout : 1) == 0) s_missedReady++;
+
+        const float volts = ads.computeVolts(ads.getLastConversionResults());
+
+        portENTER_CRITICAL(&s_ringMux);
+        s_ring[s_head] = volts;
+        s_head = (s_head + 1) % PH_RING_SAMPLES;
+        if (s_count < PH_RING_SAMPLES) s_count++;
+        portEXIT_CRITICAL(&s_ringMux);
+    }
+}
+
+bool startAdsSampler() {
+    if (s_running) return true;
+
+    if (!ads.begin()) {
+        LOGE("ADS", "ADS1115 not found");
+        return false;
+    }
+    ads.setGain(PH_ADS_GAIN);
+    ads.setDataRate(PH_ADS_DATA_RATE);
+
+    xTaskCreatePinnedToCore(adsTask, "ads", 2560, nullptr,
+                            ADC_SAMPLER_PRIORITY, &s_task, SENSOR_TASK_CORE);
+
+    pinMode(ADS_ALERT_PIN, INPUT_PULLUP);  // ALERT/RDY is open-drain
+    attachInterrupt(digitalPinToInterrupt(ADS_ALERT_PIN), onAdsReady, FALLING);
+
+    // Continuous mode; the library also points ALERT/RDY at conversion-ready
+    ads.startADCReading(ADS1X15_REG_CONFIG_MUX_SINGLE_0, /*continuous=*/true);
+
+    s_running = true;
+    LOGI("ADS", "continuous pH sampling at %u SPS", adsSamplerRateSps());
+    return true;
+}
+
+bool adsSamplerRunning() {
+    return s_running;
+}
+
+float adsSamplerMeanVolts(uint8_t n) {
+    float sum = 0.0f;
+    uint8_t used = 0;
+
+    portENTER_CRITICAL(&s_ringMux);
+    if (n > s_count) n = s_count;
+    uint8_t idx = (s_head + PH_RING_SAMPLES - n) % PH_RING_SAMPLES;
+    for (; used < n; used++) {
+        sum += s_ring[idx];
+        idx = (idx + 1) % PH_RING_SAMPLES;
+    }
+    portEXIT_CRITICAL(&s_ringMux);
+
+    return used ? sum / used : NAN;
+}
+
+uint16_t adsSamplerRateSps() {
+    return ADS1115_SPS[(PH_ADS_DATA_RATE >> 5) & 0x7];
+}
+
+uint32_t adsSamplerMissedReady() {
+    return s_missedReady;
+}
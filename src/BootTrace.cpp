@@ -0,0 +1,67 @@
+#include "BootTrace.h"
+#include <esp_timer.h>
+#include "Config.h"
+#include "Log.h"
+
+static const char *const STAGE_NAMES[BOOT_STAGE_COUNT] = {
+    "setup",
+    "pump_ready",
+    "sensors_ready",
+    "network_started",
+    "firebase_started",
+    "setup_done",
+    "storage_ready",
+    "first_reading",
+    "wifi_connected",
+    "time_synced",
+    "firebase_ready",
+    "first_upload",
+};
+
+// 0 = not reached; a stage reached at 0 ms is stored as 1
+static volatile uint32_t s_stageMs[BOOT_STAGE_COUNT];
+static portMUX_TYPE      s_mux      = portMUX_INITIALIZER_UNLOCKED;
+static bool              s_reported = false;
+
+void bootMark(BootStage stage) {
+    if (stage >= BOOT_STAGE_COUNT || s_stageMs[stage]) return;
+
+    uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (ms == 0) ms = 1;
+
+    portENTER_CRITICAL(&s_mux);
+    if (!s_stageMs[stage]) s_stageMs[stage] = ms;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool bootReached(BootStage stage) {
+    return stage < BOOT_STAGE_COUNT && s_stageMs[stage] != 0;
+}
+
+uint32_t bootStageMs(BootStage stage) {
+    return stage < BOOT_STAGE_COUNT ? s_stageMs[stage] : 0;
+}
+
+void bootTracePrint() {
+    LOGI("BOOT", "timeline (ms since start):");
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (s_stageMs[i]) LOGI("BOOT", "  %-16s %7lu", STAGE_NAMES[i], (unsigned long)s_stageMs[i]);
+        else              LOGI("BOOT", "  %-16s       -", STAGE_NAMES[i]);
+    }
+}
+
+void bootTraceJson(JsonWriter &w) {
+    w.beginObject();
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (s_stageMs[i]) w.addUInt(STAGE_NAMES[i], s_stageMs[i]);
+        else              w.addNull(STAGE_NAMES[i]);
+    }
+    w.endObject();
+}
+
+void bootTraceReportOnce() {
+    if (s_reported) return;
+    if (!bootReached(BOOT_FIRST_UPLOAD) && millis() < BOOT_TRACE_REPORT_MS) return;
+    s_reported = true;
+    bootTracePrint();
+}
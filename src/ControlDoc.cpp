@@ -0,0 +1,198 @@
+#include "ControlDoc.h"
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include <Preferences.h>
+#include <JsonStream.h>
+#include "Config.h"
+#include "Log.h"
+#include "PumpHandler.h"
+#include "SensorHandler.h"
+#include "SampleScheduler.h"
+
+static std::atomic<uint32_t> s_uploadMs(UPLOAD_INTERVAL);
+static std::atomic<uint32_t> s_historyMs(HISTORY_LOG_INTERVAL);
+
+uint32_t controlUploadIntervalMs()  { return s_uploadMs.load(std::memory_order_relaxed); }
+uint32_t controlHistoryIntervalMs() { return s_historyMs.load(std::memory_order_relaxed); }
+
+struct ApplyState {
+    uint8_t  applied;
+    uint8_t  rejected;
+    uint8_t  sampling;                          // channels with new bounds below
+    uint32_t fastMs[SAMPLE_CHANNEL_COUNT];
+    uint32_t slowMs[SAMPLE_CHANNEL_COUNT];
+};
+
+static bool inRange(const JsonValue &v, float lo, float hi, ApplyState &st) {
+    const float x = v.asFloat(NAN);
+    if (x >= lo && x <= hi) return true;
+    st.rejected++;
+    return false;
+}
+
+// ===== Handlers =====
+static void onPump(const JsonValue &v, void *ctx) {
+    setPump(v.asBool());
+    ((ApplyState *)ctx)->applied |= CONTROL_APPLIED_PUMP;
+}
+
+static void setInterval(std::atomic<uint32_t> &slot, const JsonValue &v, float lo, float hi, void *ctx) {
+    ApplyState &st = *(ApplyState *)ctx;
+    if (!inRange(v, lo, hi, st)) return;
+    slot.store((uint32_t)v.asInt(0), std::memory_order_relaxed);
+    st.applied |= CONTROL_APPLIED_INTERVALS;
+}
+
+// One fixed interval for every channel (no adaptation)
+static void onSensorMs(const JsonValue &v, void *ctx) {
+    ApplyState &st = *(ApplyState *)ctx;
+    if (!inRange(v, 1000, 3600000, st)) return;
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        st.fastMs[i] = st.slowMs[i] = (uint32_t)v.asInt(0);
+    }
+    st.sampling = SAMPLE_ALL;
+}
+
+// "/sampling/<channel>/fastMs" or ".../slowMs"; checked together after the
+// event so fastMs and slowMs may be raised or lowered in one patch
+static void onSampling(const char *leaf, const JsonValue &v, ApplyState &st) {
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        const char  *name = sampleChannelName((SampleChannel)i);
+        const size_t n    = strlen(name);
+        if (strncmp(leaf, name, n) != 0 || leaf[n] != '/') continue;
+
+        uint32_t *slot = strcmp(leaf + n, "/fastMs") == 0 ? &st.fastMs[i]
+                       : strcmp(leaf + n, "/slowMs") == 0 ? &st.slowMs[i] : nullptr;
+        if (!slot || !(v.type & JSON_NUMBER) || !inRange(v, 1000, 3600000, st)) break;
+        *slot = (uint32_t)v.asInt(0);
+        st.sampling |= 1u << i;
+        return;
+    }
+    LOGD("CONTROL", "ignored /sampling/%s", leaf);
+}
+static void onUploadMs(const JsonValue &v, void *ctx)  { setInterval(s_uploadMs, v, 10000, 86400000, ctx); }
+static void onHistoryMs(const JsonValue &v, void *ctx) { setInterval(s_historyMs, v, 10000, 86400000, ctx); }
+
+static void onTempResolution(const JsonValue &v, void *ctx) {
+    ApplyState &st = *(ApplyState *)ctx;
+    if (!inRange(v, 9, 12, st)) return;
+    setTemperatureResolution((uint8_t)v.asInt(TEMP_RESOLUTION));
+    st.applied |= CONTROL_APPLIED_TEMP;
+}
+
+static void setRaw(int &slot, const JsonValue &v, void *ctx) {
+    ApplyState &st = *(ApplyState *)ctx;
+    if (!inRange(v, 0, 4095, st)) return;
+    slot = v.asInt(slot);
+    st.applied |= CONTROL_APPLIED_CALIBRATION;
+}
+
+static void onValAir1(const JsonValue &v, void *ctx)   { setRaw(valAir1, v, ctx); }
+static void onValWater1(const JsonValue &v, void *ctx) { setRaw(valWater1, v, ctx); }
+static void onValAir2(const JsonValue &v, void *ctx)   { setRaw(valAir2, v, ctx); }
+static void onValWater2(const JsonValue &v, void *ctx) { setRaw(valWater2, v, ctx); }
+
+static void setDistance(float &slot, const JsonValue &v, void *ctx) {
+    ApplyState &st = *(ApplyState *)ctx;
+    if (!inRange(v, 2, 400, st)) return;  // HC-SR04 range
+    slot = v.asFloat(slot);
+    st.applied |= CONTROL_APPLIED_CALIBRATION;
+}
+
+static void onUltraEmpty(const JsonValue &v, void *ctx) { setDistance(ULTRA_EMPTY_CM, v, ctx); }
+static void onUltraFull(const JsonValue &v, void *ctx)  { setDistance(ULTRA_FULL_CM, v, ctx); }
+
+static const JsonRoute ROUTES[] = {
+    { "/isPump",                   JSON_BOOL | JSON_NUMBER, onPump },
+    { "/intervals/sensorMs",       JSON_NUMBER,             onSensorMs },
+    { "/intervals/uploadMs",       JSON_NUMBER,             onUploadMs },
+    { "/intervals/historyMs",      JSON_NUMBER,             onHistoryMs },
+    { "/tempResolution",           JSON_NUMBER,             onTempResolution },
+    { "/calibration/valAir1",      JSON_NUMBER,             onValAir1 },
+    { "/calibration/valWater1",    JSON_NUMBER,             onValWater1 },
+    { "/calibration/valAir2",      JSON_NUMBER,             onValAir2 },
+    { "/calibration/valWater2",    JSON_NUMBER,             onValWater2 },
+    { "/calibration/ultraEmptyCm", JSON_NUMBER,             onUltraEmpty },
+    { "/calibration/ultraFullCm",  JSON_NUMBER,             onUltraFull },
+};
+
+static void onLeaf(const char *path, const JsonValue &v, void *ctx) {
+    if (v.type == JSON_NULL) return;  // deleted in the RTDB: keep the current value
+    if (strncmp(path, "/sampling/", 10) == 0) {
+        onSampling(path + 10, v, *(ApplyState *)ctx);
+        return;
+    }
+    if (!jsonRoute(ROUTES, sizeof(ROUTES) / sizeof(ROUTES[0]), path, v, ctx)) {
+        LOGD("CONTROL", "ignored %s", path);
+    }
+}
+
+static void saveCalibration() {
+    // Own Preferences handle, as in handleCalibration()
+    Preferences prefs;
+    prefs.begin("config", false);
+    prefs.putInt("valAir1",   valAir1);
+    prefs.putInt("valWater1", valWater1);
+    prefs.putInt("valAir2",   valAir2);
+    prefs.putInt("valWater2", valWater2);
+    prefs.putFloat("ultraEmptyCm", ULTRA_EMPTY_CM);
+    prefs.putFloat("ultraFullCm",  ULTRA_FULL_CM);
+    prefs.end();
+}
+
+// Dry soil reads higher than wet (getMoistureVal()); a pair that does not is
+// put back to what it was before the event
+static void checkMoisturePair(int &air, int &water, int oldAir, int oldWater, uint8_t probe) {
+    if (air > water) return;
+    LOGW("CONTROL", "valAir%u %d <= valWater%u %d, moisture %u calibration kept",
+         probe, air, probe, water, probe);
+    air   = oldAir;
+    water = oldWater;
+}
+
+uint8_t controlDocApply(const char *dataPath, const char *json, size_t len) {
+    const float emptyCm = ULTRA_EMPTY_CM;
+    const float fullCm  = ULTRA_FULL_CM;
+    const int   air1 = valAir1, water1 = valWater1;
+    const int   air2 = valAir2, water2 = valWater2;
+
+    ApplyState st = {};
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        sampleSchedulerBounds((SampleChannel)i, &st.fastMs[i], &st.slowMs[i]);
+    }
+    if (!jsonStreamParse(json, len, dataPath, onLeaf, &st)) {
+        LOGW("CONTROL", "malformed event at %s", dataPath);
+    }
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        if (!(st.sampling & (1u << i))) continue;
+        if (sampleSchedulerSetBounds((SampleChannel)i, st.fastMs[i], st.slowMs[i])) {
+            st.applied |= CONTROL_APPLIED_INTERVALS;
+        } else {
+            st.rejected++;  // fastMs above slowMs
+        }
+    }
+    if (st.rejected) LOGW("CONTROL", "%u out-of-range value(s) ignored", st.rejected);
+
+    if (st.applied & CONTROL_APPLIED_CALIBRATION) {
+        if (ULTRA_FULL_CM >= ULTRA_EMPTY_CM) {
+            // A full tank must read nearer than an empty one
+            LOGW("CONTROL", "ultraFullCm %.1f >= ultraEmptyCm %.1f, tank distances kept",
+                 ULTRA_FULL_CM, ULTRA_EMPTY_CM);
+            ULTRA_EMPTY_CM = emptyCm;
+            ULTRA_FULL_CM  = fullCm;
+        }
+        checkMoisturePair(valAir1, valWater1, air1, water1, 1);
+        checkMoisturePair(valAir2, valWater2, air2, water2, 2);
+
+        // Only what survived the checks reaches NVS
+        if (valAir1 != air1 || valWater1 != water1 || valAir2 != air2 || valWater2 != water2 ||
+            ULTRA_EMPTY_CM != emptyCm || ULTRA_FULL_CM != fullCm) {
+            saveCalibration();
+        } else {
+            st.applied &= ~CONTROL_APPLIED_CALIBRATION;
+        }
+    }
+    if (st.applied) LOGI("CONTROL", "applied 0x%02x from %s", st.applied, dataPath);
+    return st.applied;
+}
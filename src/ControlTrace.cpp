@@ -0,0 +1,196 @@
+#include "ControlTrace.h"
+#include "Config.h"
+
+#if CONTROL_TRACE_ENABLED
+#include <LittleFS.h>
+#include "Log.h"
+
+#define TRACE_DIR  "/ctrace"
+
+static TsLogBlockEncoder s_encoder(TSLOG_CONTROL_FIELD_COUNT);
+static SemaphoreHandle_t s_lock = nullptr;
+static bool     s_ready        = false;
+static bool     s_haveSegments = false;
+static uint32_t s_firstSeq     = 0;
+static uint32_t s_lastSeq      = 0;
+static uint32_t s_segBytes     = 0;  // size of the segment being appended to
+static uint32_t s_totalBytes   = 0;
+static uint32_t s_blockFirstTs = 0;
+
+static uint8_t s_frame[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+
+static void segmentPath(uint32_t seq, char *out, size_t len) {
+  snprintf(out, len, TRACE_DIR "/%08lx.tsl", (unsigned long)seq);
+}
+
+static uint32_t fileSize(uint32_t seq) {
+  char path[32];
+  segmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+  const uint32_t size = f.size();
+  f.close();
+  return size;
+}
+
+static void dropOldestSegment() {
+  char path[32];
+  segmentPath(s_firstSeq, path, sizeof(path));
+  s_totalBytes -= min(s_totalBytes, fileSize(s_firstSeq));
+  LittleFS.remove(path);
+  s_firstSeq++;
+}
+
+static bool openNewSegment(uint32_t firstTimestamp) {
+  const uint32_t seq = s_haveSegments ? s_lastSeq + 1 : 1;
+
+  TsLogSegmentHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic          = TSLOG_MAGIC;
+  hdr.version        = TSLOG_VERSION;
+  hdr.fieldCount     = TSLOG_CONTROL_FIELD_COUNT;
+  hdr.sequence       = seq;
+  hdr.firstTimestamp = firstTimestamp;
+
+  char path[32];
+  segmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "w");
+  if (!f) return false;
+  const bool ok = f.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+  f.close();
+  if (!ok) {
+    LittleFS.remove(path);
+    return false;
+  }
+
+  if (!s_haveSegments) s_firstSeq = seq;
+  s_haveSegments = true;
+  s_lastSeq      = seq;
+  s_segBytes     = sizeof(hdr);
+  s_totalBytes  += sizeof(hdr);
+
+  while (s_lastSeq - s_firstSeq + 1 > CONTROL_TRACE_SEGMENTS) dropOldestSegment();
+  return true;
+}
+
+// Caller holds s_lock
+static void flushBlock() {
+  if (!s_ready || s_encoder.empty()) return;
+
+  const size_t n = s_encoder.finish(s_frame, sizeof(s_frame));
+  s_encoder.reset();
+  if (n == 0) return;
+
+  if ((!s_haveSegments || s_segBytes + n > CONTROL_TRACE_SEGMENT_BYTES) && !openNewSegment(s_blockFirstTs)) {
+    LOGE("CTRACE", "cannot open segment, block dropped");
+    return;
+  }
+
+  char path[32];
+  segmentPath(s_lastSeq, path, sizeof(path));
+  File f = LittleFS.open(path, "a");
+  if (!f) return;
+  const size_t written = f.write(s_frame, n);
+  f.close();
+
+  s_segBytes   += written;
+  s_totalBytes += written;
+}
+
+// LittleFS is mounted by initHistoryLog() (storageBootTask)
+bool initControlTrace() {
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+  if (!LittleFS.exists(TRACE_DIR)) LittleFS.mkdir(TRACE_DIR);
+
+  // Find the segment range; names are the hex sequence number
+  File dir = LittleFS.open(TRACE_DIR);
+  if (!dir) {
+    LOGE("CTRACE", "cannot open " TRACE_DIR);
+    return false;
+  }
+  File f = dir.openNextFile();
+  while (f) {
+    const char *name = strrchr(f.name(), '/');
+    name = name ? name + 1 : f.name();
+    char *end = nullptr;
+    const uint32_t seq = strtoul(name, &end, 16);
+    if (end && strcmp(end, ".tsl") == 0 && seq > 0) {
+      if (!s_haveSegments || seq < s_firstSeq) s_firstSeq = seq;
+      if (!s_haveSegments || seq > s_lastSeq)  s_lastSeq  = seq;
+      s_haveSegments = true;
+      s_totalBytes  += f.size();
+    }
+    f = dir.openNextFile();
+  }
+
+  if (s_haveSegments) s_segBytes = fileSize(s_lastSeq);
+  s_ready = true;
+
+  LOGI("CTRACE", "%lu segment(s), %lu bytes",
+       s_haveSegments ? (unsigned long)(s_lastSeq - s_firstSeq + 1) : 0UL,
+       (unsigned long)s_totalBytes);
+  return true;
+}
+
+void controlTraceAppend(const ControlTraceEntry &e) {
+  if (!s_ready) return;
+
+  TsLogRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  tsLogFromControl(e, rec);
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (!s_encoder.add(rec)) {
+    flushBlock();
+    s_encoder.add(rec);
+  }
+  if (s_encoder.count() == 1) s_blockFirstTs = e.timestamp;
+  if (s_encoder.count() >= CONTROL_TRACE_BLOCK_RECORDS) flushBlock();
+  xSemaphoreGive(s_lock);
+}
+
+void controlTraceFlush() {
+  if (!s_ready) return;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  flushBlock();
+  xSemaphoreGive(s_lock);
+}
+
+void controlTraceBegin(ControlTraceCursor &c) {
+  controlTraceFlush();
+  c.seq    = s_firstSeq;
+  c.offset = 0;
+}
+
+size_t controlTraceRead(ControlTraceCursor &c, uint8_t *out, size_t max) {
+  if (!s_ready || !s_haveSegments) return 0;
+
+  size_t got = 0;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (c.seq < s_firstSeq) {
+    c.seq    = s_firstSeq;  // rotated away meanwhile
+    c.offset = 0;
+  }
+  while (got == 0 && c.seq <= s_lastSeq) {
+    char path[32];
+    segmentPath(c.seq, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    if (f && f.seek(c.offset)) got = f.read(out, max);
+    if (f) f.close();
+
+    if (got == 0) {
+      c.seq++;
+      c.offset = 0;
+    } else {
+      c.offset += got;
+    }
+  }
+  xSemaphoreGive(s_lock);
+  return got;
+}
+
+uint32_t controlTraceBytes() {
+  return s_totalBytes;
+}
+
+#endif
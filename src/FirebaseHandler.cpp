@@ -1,152 +1,96 @@
-#define ENABLE_USER_AUTH
-#define ENABLE_DATABASE
-
 #include "FirebaseHandler.h"
+#include <stdio.h>
+#include <string.h>
 #include "SensorsData.h"
 #include "Config.h"
-#include "SerialDebugger.h"
+#include "Log.h"
 #include "PumpHandler.h"
+#include "RecordQueue.h"
+#include "SensorFields.h"
+#include "BootTrace.h"
+#include "Metrics.h"
+#include "ControlDoc.h"
+#include "Hal.h"
+
+// Store-and-forward uploads and the control stream, on the database calls
+// in Hal.h, so the same code runs on the board (FirebaseClient) and against
+// the fake RTDB on the host.
 
 static bool     s_counting   = false;
 static uint32_t s_startMs    = 0;
 static uint32_t s_durationMs = 5000;
 static int      s_lastShown  = -1;
 
-// ===== Firebase globals =====
-FirebaseApp app;
-RealtimeDatabase Database;
-bool firebaseBusy = false;
-
-class DebugClient : public WiFiClientSecure {
-public:
-    size_t write(const uint8_t *buf, size_t size) override {
-        Serial.print("[HTTP SEND] ");
-        Serial.write(buf, size); // raw bytes
-        Serial.println();
-        return WiFiClientSecure::write(buf, size);
-    }
-
-    int read(uint8_t *buf, size_t size) override {
-        int r = WiFiClientSecure::read(buf, size);
-        if (r > 0) {
-            // Copy to a static buffer to accumulate the full response
-            static String responseBuffer = "";
-
-            // Append new chunk
-            responseBuffer += String((const char*)buf, r);
-
-            // If the last character is a newline, print buffer and clear
-            if (responseBuffer.endsWith("\n")) {
-                Serial.print("[HTTP RECV] ");
-                Serial.println(responseBuffer);
-                responseBuffer = "";
-            }
-        }
-        return r;
-    }
-};
-
-
+#define RECORD_JSON_MAX 256  // one SensorData record as JSON
 
-// Two SSL clients & async clients (one for writes, one for stream)
-DebugClient ssl_client1, ssl_client2;
-using AsyncClient = AsyncClientClass;
-AsyncClient async_client1(ssl_client1), async_client2(ssl_client2);
-
-UserAuth *userAuth = nullptr;
+bool firebaseBusy = false;
 
-// ===== Pump control state =====
+// ===== Control stream state =====
 static volatile bool g_pumpState = false;        // last known state from Firebase
-static String g_pumpPath;                        // /Control/<DEVICE_ID>/isPump
+static char g_controlPath[48];                   // Control/<DEVICE_ID>, see ControlDoc.h
 static bool g_streamActive = false;
 
+// ===== Store-and-forward state =====
+static QueuedRecord s_liveRecord;              // last direct upload, re-queued if it fails
+static bool         s_liveInFlight  = false;
+static size_t       s_batchInFlight = 0;       // queued records carried by the pending batch
+static uint32_t     s_lastDrainMs   = 0;
+static QueuedRecord s_batch[RECORD_QUEUE_BATCH];
+static char         s_batchJson[RECORD_QUEUE_BATCH * (RECORD_JSON_MAX + 16) + 2];
+
 // Forward
-static void processData(AsyncResult &aResult);
+static void drainRecordQueue();
 void startCountdown(uint32_t ms);
 void countdownTick();
 
-// ===== Process all Firebase callbacks (writes + stream) =====
-static void processData(AsyncResult &aResult) {
-  if (!aResult.isResult()) return;
-
-  if (aResult.isEvent()) {
-    Firebase.printf("Event: %s | Msg: %s | Code: %d\n",
-                    aResult.uid().c_str(),
-                    aResult.eventLog().message().c_str(),
-                    aResult.eventLog().code());
-  }
+// ===== Bookkeeping for history writes =====
+static void onRecordWriteDone(uint8_t task, bool ok) {
+  if (ok && (task == METRIC_FB_RECORD || task == METRIC_FB_BATCH)) bootMark(BOOT_FIRST_UPLOAD);
 
-  if (aResult.isDebug()) {
-    Firebase.printf("Debug: %s | Msg: %s\n",
-                    aResult.uid().c_str(),
-                    aResult.debug().c_str());
-  }
-
-  if (aResult.isError()) {
-    Firebase.printf("Error: %s | Msg: %s | Code: %d\n",
-                    aResult.uid().c_str(),
-                    aResult.error().message().c_str(),
-                    aResult.error().code());
-    // Failsafe for pump stream errors
-    if (String(aResult.uid()) == "pumpStream") {
-      setPump(false);
-      // allow a restart later
-      g_streamActive = false;
+  if (task == METRIC_FB_RECORD && s_liveInFlight) {
+    s_liveInFlight = false;
+    if (!ok) {
+      // retry later via the queue
+      recordQueuePush(s_liveRecord.timestamp, s_liveRecord.data, s_liveRecord.fields);
     }
+  } else if (task == METRIC_FB_BATCH && s_batchInFlight) {
+    if (ok) recordQueuePop(s_batchInFlight);  // otherwise they stay queued for the next drain
+    s_batchInFlight = 0;
   }
+}
 
-  if (!aResult.available()) {
-    firebaseBusy = false;
-    return;
-  }
-
-  // Convert to RTDB result (now that we know it's available)
-  RealtimeDatabaseResult &RTDB = aResult.to<RealtimeDatabaseResult>();
+// ===== Results from the RTDB HAL (inside halRtdbLoop()) =====
+void firebaseOnWriteDone(uint8_t task, bool ok) {
+  onRecordWriteDone(task, ok);
+  metricsFirebaseDone(task, ok);
+  firebaseBusy = false;
+}
 
-  // If this is not a stream (e.g., a write callback), just log payload
-  if (!RTDB.isStream()) {
-    Firebase.printf("Task: %s | Payload: %s\n",
-                    aResult.uid().c_str(), aResult.c_str());
-    firebaseBusy = false;
-    return;
-  }
+void firebaseOnStreamError() {
+  // Failsafe: without the control stream the remote switch is unknown
+  setPump(false);
+  // allow a restart later
+  g_streamActive = false;
+  metricsFirebaseDone(METRIC_FB_STREAM, false);
+}
 
-  // ---- Stream data path/value ----
-  const bool isPumpStream = (String(aResult.uid()) == "pumpStream");
-  const int  t = RTDB.type();  // 4=bool, 1=int, 6=JSON
-  const String ev = RTDB.event();      // "put", "patch", ...
-  const String path = RTDB.dataPath(); // e.g. "/"
-  const String dataStr = RTDB.to<String>();
-
-  Firebase.printf("[STREAM %s] event=%s path=%s type=%d data=%s\n",
-                  aResult.uid().c_str(), ev.c_str(), path.c_str(), t, dataStr.c_str());
-
-  if (isPumpStream) {
-    if (t == 4 /* bool */ || t == 1 /* int */) {
-      const bool pumpState = RTDB.to<bool>();
-      setPump(pumpState);
-      if (pumpState) {
-        startCountdown(3000);
-      }
-    } else if (t == 6 /* JSON */) {
-      // Example: { "isPump": true }
-      const bool foundTrue  = (dataStr.indexOf("\"isPump\"") >= 0) && (dataStr.indexOf("true")  >= 0);
-      const bool foundFalse = (dataStr.indexOf("\"isPump\"") >= 0) && (dataStr.indexOf("false") >= 0);
-      if (foundTrue || foundFalse) {
-        setPump(foundTrue);
-        if (foundTrue) {
-          startCountdown(3000);
-        }
-      }
-    }
+void firebaseOnStreamEvent(const char *event, const char *dataPath, const char *payload) {
+  metricsFirebaseDone(METRIC_FB_STREAM, true);
+  LOGD("FB", "[STREAM] event=%s path=%s data=%s", event, dataPath, payload);
 
-    // Optional: if auth revoked/cancel, mark inactive so loop can restart it
-    if (ev == "cancel" || ev == "auth_revoked") {
-      g_streamActive = false;
+  // Parsed in place (ControlDoc.h); nothing here allocates per event
+  const uint8_t applied = controlDocApply(dataPath, payload, strlen(payload));
+  if (applied & CONTROL_APPLIED_PUMP) {
+    g_pumpState = pumpIsOn();
+    if (g_pumpState) {
+      startCountdown(3000);
     }
   }
 
-  firebaseBusy = false;
+  // Optional: if auth revoked/cancel, mark inactive so loop can restart it
+  if (strcmp(event, "cancel") == 0 || strcmp(event, "auth_revoked") == 0) {
+    g_streamActive = false;
+  }
 }
 
 // ===== Init Firebase (auth + DB URL) =====
@@ -154,48 +98,47 @@ void initFirebase(const char* apiKey,
                   const char* email,
                   const char* password,
                   const char* dbUrl) {
-  // Secure clients (you can replace setInsecure() with proper cert later)
-  ssl_client1.setInsecure();
-  ssl_client2.setInsecure();
-
-  // Reasonable timeouts
-  ssl_client1.setTimeout(1000);
-  ssl_client1.setHandshakeTimeout(5);
-  ssl_client2.setTimeout(1000);
-  ssl_client2.setHandshakeTimeout(5);
-
-  // Auth
-  userAuth = new UserAuth(apiKey, email, password);
+  metricsFirebaseStart(METRIC_FB_AUTH);
+  halRtdbBegin(apiKey, email, password, dbUrl);
 
-  // App + RTDB
-  initializeApp(async_client1, app, getAuth(*userAuth), processData, "authTask");
-  app.getApp<RealtimeDatabase>(Database);
-  Database.url(dbUrl);
-
-  // Build the pump path using your DEVICE_ID from Config.h
-  g_pumpPath = String("Control/") + String(DEVICE_ID) + "/isPump";
+  // One stream for the whole control document (ControlDoc.h)
+  snprintf(g_controlPath, sizeof(g_controlPath), "Control/%s", DEVICE_ID);
 
   // Start the stream right away (actual start in loop)
 }
 
 // ===== Keep Firebase alive in loop() =====
 void firebaseLoop() {
-  app.loop();
+  halRtdbLoop();
+  if (!halRtdbReady()) return;  // offline or not signed in yet
+  if (!bootReached(BOOT_FIREBASE_READY)) {
+    metricsFirebaseDone(METRIC_FB_AUTH, true);
+    bootMark(BOOT_FIREBASE_READY);
+  }
   startPumpListener();
+  drainRecordQueue();
   countdownTick();
 }
 
-// ===== Explicitly start the isPump stream =====
+bool firebaseUploadPending() {
+  return firebaseBusy || s_liveInFlight || s_batchInFlight || recordQueueSize() > 0;
+}
+
+void firebaseRadioDown() {
+  halRtdbStop();
+  g_streamActive = false;  // restarted by firebaseLoop() once the link is back
+  onRecordWriteDone(METRIC_FB_RECORD, false);
+  onRecordWriteDone(METRIC_FB_BATCH, false);
+  firebaseBusy = false;
+}
+
+// ===== Explicitly start the control document stream =====
 void startPumpListener() {
-  if (!app.ready()) return;
+  if (!halRtdbReady()) return;
   if (g_streamActive) return;
 
-  async_client2.setSSEFilters("get,put,patch,keep-alive,cancel,auth_revoked");
-  Database.get(async_client2,
-               g_pumpPath.c_str(),
-               processData,
-               true /* SSE streaming */,
-               "pumpStream");
+  metricsFirebaseStart(METRIC_FB_STREAM);
+  halRtdbStream(g_controlPath);
   g_streamActive = true;
 }
 
@@ -207,45 +150,96 @@ void stopPumpListener() {
 
 // ===== Upload: Real-time data =====
 void uploadDataToFirebase(const SensorData &data) {
-  if (!app.ready() || firebaseBusy) return;
-  firebaseBusy = true;
+  if (!halRtdbReady()) return;
+  if (firebaseBusy) {
+    metricsFirebaseBusySkip();
+    return;
+  }
 
-  String base = "/RealTimeData/" + String(DEVICE_ID) + "/";
+  // One JSON object per upload so each write is a single atomic set
+  char json[RECORD_JSON_MAX];
+  if (sensorDataToJson(json, sizeof(json), data, SENSOR_OUT_LIVE) == 0) return;
 
-  Database.set<float>(async_client1, (base + "temp0").c_str(), data.temp_val_1,        processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "temp1").c_str(), data.temp_val_2,        processData, "RTDB_Float");
-  Database.set<int>  (async_client1, (base + "moisture1").c_str(), data.moist_percent_1, processData, "RTDB_Int");
-  Database.set<int>  (async_client1, (base + "moisture2").c_str(), data.moist_percent_2, processData, "RTDB_Int");
-  Database.set<float>(async_client1, (base + "water_level").c_str(), data.water_level,  processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "tds_val").c_str(), data.tds_val,          processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "ph_level").c_str(), data.ph_val,          processData, "RTDB_Float");
+  char path[64];
+  snprintf(path, sizeof(path), "/RealTimeData/%s", DEVICE_ID);
 
-  Database.set<float>(async_client1, (base + "ultra_level_percent").c_str(), data.ultra_level_percent, processData, "RTDB_Float");
+  firebaseBusy = true;
+  metricsFirebaseStart(METRIC_FB_REALTIME);
+  halRtdbSet(METRIC_FB_REALTIME, path, json);
 }
 
 // ===== Upload: Historical records =====
-void uploadRecordDataToFirebase(const String &date, const SensorData &data) {
-  if (!app.ready() || firebaseBusy) return;
+void uploadRecordDataToFirebase(uint32_t timestamp, const SensorData &data, uint16_t fields) {
+  if (!halRtdbReady() || firebaseBusy) {
+    if (halRtdbReady()) metricsFirebaseBusySkip();
+    recordQueuePush(timestamp, data, fields);  // store and forward once we are back
+    return;
+  }
+
+  char json[RECORD_JSON_MAX];
+  if (sensorDataToJson(json, sizeof(json), data, SENSOR_OUT_RECORD, fields) == 0) return;
+
+  char path[64];
+  snprintf(path, sizeof(path), "/VermiBoxes/%s/%lu", DEVICE_ID, (unsigned long)timestamp);
+
+  s_liveRecord.timestamp = timestamp;
+  s_liveRecord.data      = data;
+  s_liveRecord.fields    = fields;
+  s_liveInFlight         = true;
+
   firebaseBusy = true;
+  metricsFirebaseStart(METRIC_FB_RECORD);
+  halRtdbSet(METRIC_FB_RECORD, path, json);
+}
+
+// ===== Catch-up: queued records as one multi-path update =====
+// Rate limited to one batch per RECORD_QUEUE_DRAIN_MS so live uploads still
+// get a turn on the write client. Records are only dropped from the queue once
+// the batch write is acknowledged.
+static void drainRecordQueue() {
+  if (!halRtdbReady() || firebaseBusy || s_batchInFlight) return;
+  if (!bootReached(BOOT_STORAGE_READY)) return;  // queue not loaded yet
+  if (halMillis() - s_lastDrainMs < RECORD_QUEUE_DRAIN_MS) return;
+
+  size_t n = recordQueuePeek(s_batch, RECORD_QUEUE_BATCH);
+  if (n == 0) return;
+  s_lastDrainMs = halMillis();
+
+  // { "<ts>": {record}, "<ts>": {record}, ... }
+  JsonWriter w(s_batchJson, sizeof(s_batchJson));
+  w.beginObject();
+  for (size_t i = 0; i < n; i++) {
+    const JsonWriter::Mark mark = w.mark();
+    char key[12];
+    snprintf(key, sizeof(key), "%lu", (unsigned long)s_batch[i].timestamp);
+    w.beginObject(key);
+    writeSensorFields(w, s_batch[i].data, SENSOR_OUT_RECORD, s_batch[i].fields);
+    w.endObject();
+    if (!w.ok()) { w.rewind(mark); n = i; break; }  // rest goes in the next batch
+  }
+  if (n == 0) return;
+  w.endObject();
+
+  char path[48];
+  snprintf(path, sizeof(path), "/VermiBoxes/%s", DEVICE_ID);
 
-  String base = "/VermiBoxes/" + String(DEVICE_ID) + "/" + date + "/";
+  LOGD("FB", "[QUEUE] uploading %u of %u queued record(s)",
+       (unsigned)n, (unsigned)recordQueueSize());
 
-  Database.set<float>(async_client1, (base + "temp0").c_str(), data.temp_val_1,        processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "temp1").c_str(), data.temp_val_2,        processData, "RTDB_Float");
-  Database.set<int>  (async_client1, (base + "moisture1").c_str(), data.moist_percent_1, processData, "RTDB_Int");
-  Database.set<int>  (async_client1, (base + "moisture2").c_str(), data.moist_percent_2, processData, "RTDB_Int");
-  Database.set<float>(async_client1, (base + "water_level").c_str(), data.water_level,  processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "tds_val").c_str(), data.tds_val,          processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "ph_val").c_str(), data.ph_val,            processData, "RTDB_Float");
-  Database.set<float>(async_client1, (base + "ultra_level_percent").c_str(), data.ultra_level_percent, processData, "RTDB_Float");
+  s_batchInFlight = n;
+  firebaseBusy = true;
+  metricsFirebaseStart(METRIC_FB_BATCH);
+  halRtdbUpdate(METRIC_FB_BATCH, path, s_batchJson);
 }
 
 void setIsPumpOff() {
-  if (!app.ready() || firebaseBusy) return;
+  if (!halRtdbReady() || firebaseBusy) return;
   firebaseBusy = true;
 
-  String base = "/Control/" + String(DEVICE_ID);
-  Database.set<int>(async_client1, (base + "/isPump").c_str(), 0, processData, "RTDB_Int");
+  char path[48];
+  snprintf(path, sizeof(path), "/Control/%s/isPump", DEVICE_ID);
+  metricsFirebaseStart(METRIC_FB_INT);
+  halRtdbSet(METRIC_FB_INT, path, "0");
 }
 
 bool getPumpState() {
@@ -254,7 +248,7 @@ bool getPumpState() {
 
 void startCountdown(uint32_t ms) {
   s_counting   = true;
-  s_startMs    = millis();
+  s_startMs    = halMillis();
   s_durationMs = ms;
   s_lastShown  = -1;
 }
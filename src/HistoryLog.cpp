@@ -0,0 +1,236 @@
+#include "HistoryLog.h"
+#include <LittleFS.h>
+#include <TsLog.h>
+#include <TsLogSensor.h>
+#include "Config.h"
+#include "Log.h"
+
+#define HISTORY_DIR  "/tslog"
+#define SCAN_WINDOW  1024  // must hold at least one full block
+
+static TsLogBlockEncoder s_encoder(TSLOG_SENSOR_FIELD_COUNT);
+static SemaphoreHandle_t s_lock = nullptr;
+static bool     s_ready        = false;
+static bool     s_haveSegments = false;
+static uint32_t s_firstSeq     = 0;
+static uint32_t s_lastSeq      = 0;
+static uint32_t s_segBytes     = 0;  // size of the segment being appended to
+static uint32_t s_totalBytes   = 0;
+static uint32_t s_blockFirstTs = 0;
+
+static uint8_t s_frame[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+static uint8_t s_window[SCAN_WINDOW];
+
+static void segmentPath(uint32_t seq, char *out, size_t len) {
+  snprintf(out, len, HISTORY_DIR "/%08lx.tsl", (unsigned long)seq);
+}
+
+static uint32_t fileSize(uint32_t seq) {
+  char path[32];
+  segmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+  const uint32_t size = f.size();
+  f.close();
+  return size;
+}
+
+static void dropOldestSegment() {
+  char path[32];
+  segmentPath(s_firstSeq, path, sizeof(path));
+  s_totalBytes -= min(s_totalBytes, fileSize(s_firstSeq));
+  LittleFS.remove(path);
+  s_firstSeq++;
+}
+
+static bool openNewSegment(uint32_t firstTimestamp) {
+  const uint32_t seq = s_haveSegments ? s_lastSeq + 1 : 1;
+
+  TsLogSegmentHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic          = TSLOG_MAGIC;
+  hdr.version        = TSLOG_VERSION;
+  hdr.fieldCount     = TSLOG_SENSOR_FIELD_COUNT;
+  hdr.sequence       = seq;
+  hdr.firstTimestamp = firstTimestamp;
+
+  char path[32];
+  segmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "w");
+  if (!f) return false;
+  const bool ok = f.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+  f.close();
+  if (!ok) {
+    LittleFS.remove(path);
+    return false;
+  }
+
+  if (!s_haveSegments) s_firstSeq = seq;
+  s_haveSegments = true;
+  s_lastSeq      = seq;
+  s_segBytes     = sizeof(hdr);
+  s_totalBytes  += sizeof(hdr);
+
+  while (s_lastSeq - s_firstSeq + 1 > HISTORY_SEGMENTS) dropOldestSegment();
+  return true;
+}
+
+// Caller holds s_lock
+static void flushBlock() {
+  if (!s_ready || s_encoder.empty()) return;
+
+  const size_t n = s_encoder.finish(s_frame, sizeof(s_frame));
+  s_encoder.reset();
+  if (n == 0) return;
+
+  if ((!s_haveSegments || s_segBytes + n > HISTORY_SEGMENT_BYTES) && !openNewSegment(s_blockFirstTs)) {
+    LOGE("HISTORY", "cannot open segment, block dropped");
+    return;
+  }
+
+  char path[32];
+  segmentPath(s_lastSeq, path, sizeof(path));
+  File f = LittleFS.open(path, "a");
+  if (!f) return;
+  const size_t written = f.write(s_frame, n);
+  f.close();
+
+  s_segBytes   += written;
+  s_totalBytes += written;
+}
+
+bool initHistoryLog() {
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+
+  if (!LittleFS.begin(true)) {
+    LOGE("HISTORY", "LittleFS mount failed");
+    return false;
+  }
+  if (!LittleFS.exists(HISTORY_DIR)) LittleFS.mkdir(HISTORY_DIR);
+
+  // Find the segment range; names are the hex sequence number
+  File dir = LittleFS.open(HISTORY_DIR);
+  File f = dir.openNextFile();
+  while (f) {
+    const char *name = strrchr(f.name(), '/');
+    name = name ? name + 1 : f.name();
+    char *end = nullptr;
+    const uint32_t seq = strtoul(name, &end, 16);
+    if (end && strcmp(end, ".tsl") == 0 && seq > 0) {
+      if (!s_haveSegments || seq < s_firstSeq) s_firstSeq = seq;
+      if (!s_haveSegments || seq > s_lastSeq)  s_lastSeq  = seq;
+      s_haveSegments = true;
+      s_totalBytes  += f.size();
+    }
+    f = dir.openNextFile();
+  }
+
+  if (s_haveSegments) s_segBytes = fileSize(s_lastSeq);
+  s_ready = true;
+
+  LOGI("HISTORY", "%lu segment(s), %lu bytes",
+       s_haveSegments ? (unsigned long)(s_lastSeq - s_firstSeq + 1) : 0UL,
+       (unsigned long)s_totalBytes);
+  return true;
+}
+
+void historyLogAppend(uint32_t timestamp, const SensorData &data) {
+  if (!s_ready) return;
+
+  TsLogRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  tsLogFromSensorData(timestamp, data, rec);
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (!s_encoder.add(rec)) {
+    flushBlock();
+    s_encoder.add(rec);
+  }
+  if (s_encoder.count() == 1) s_blockFirstTs = timestamp;
+  if (s_encoder.count() >= HISTORY_BLOCK_RECORDS) flushBlock();
+  xSemaphoreGive(s_lock);
+}
+
+void historyLogFlush() {
+  if (!s_ready) return;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  flushBlock();
+  xSemaphoreGive(s_lock);
+}
+
+struct ScanContext {
+  uint32_t              from;
+  uint32_t              to;
+  HistoryRecordCallback cb;
+  void                 *ctx;
+  size_t                matched;
+};
+
+static void onScanRecord(const TsLogRecord &rec, void *c) {
+  ScanContext *scan = (ScanContext *)c;
+  if (rec.timestamp < scan->from || rec.timestamp > scan->to) return;
+  SensorData data;
+  tsLogToSensorData(rec, data);
+  scan->matched++;
+  if (scan->cb) scan->cb(rec.timestamp, data, scan->ctx);
+}
+
+static bool readHeader(uint32_t seq, TsLogSegmentHeader &hdr) {
+  char path[32];
+  segmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) return false;
+  const bool ok = f.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) && tsLogValidHeader(hdr);
+  f.close();
+  return ok;
+}
+
+size_t historyLogScan(uint32_t from, uint32_t to, HistoryRecordCallback cb, void *ctx) {
+  if (!s_ready || !s_haveSegments) return 0;
+
+  ScanContext scan = { from, to, cb, ctx, 0 };
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  TsLogSegmentHeader hdr, next;
+  bool haveHdr = readHeader(s_firstSeq, hdr);
+
+  for (uint32_t seq = s_firstSeq; seq <= s_lastSeq; seq++) {
+    const bool haveNext = seq < s_lastSeq && readHeader(seq + 1, next);
+
+    // Segments are in time order: skip one whose successor starts before
+    // the range, and stop once a segment starts after it
+    const bool before = haveNext && next.firstTimestamp < from;
+    const bool after  = haveHdr && hdr.firstTimestamp > to;
+    if (after) break;
+
+    if (haveHdr && !before) {
+      char path[32];
+      segmentPath(seq, path, sizeof(path));
+      File f = LittleFS.open(path, "r");
+      if (f && f.seek(sizeof(TsLogSegmentHeader))) {
+        size_t have = 0;
+        for (;;) {
+          const size_t got = f.read(s_window + have, sizeof(s_window) - have);
+          have += got;
+          const bool atEnd = got == 0 || !f.available();
+          const size_t used = tsLogScanBuffer(s_window, have, hdr.fieldCount, atEnd,
+                                              onScanRecord, &scan, nullptr);
+          memmove(s_window, s_window + used, have - used);
+          have -= used;
+          if (atEnd) break;
+        }
+      }
+      if (f) f.close();
+    }
+
+    hdr     = next;
+    haveHdr = haveNext;
+  }
+  xSemaphoreGive(s_lock);
+
+  return scan.matched;
+}
+
+uint32_t historyLogBytes() {
+  return s_totalBytes;
+}
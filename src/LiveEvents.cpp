@@ -0,0 +1,76 @@
+#include "LiveEvents.h"
+#include <atomic>
+#include "Config.h"
+#include "Log.h"
+#include "PumpHandler.h"
+#include "SensorFields.h"
+
+static AsyncEventSource s_events("/events");
+static uint32_t         s_sentVersion = 0;
+static uint32_t         s_sentPump    = 0;
+// Subscribers, kept by onConnect/onDisconnect (AsyncTCP task). The library
+// holds its client list lock around both callbacks, so the limit is checked
+// in the request filter instead of calling count()/close() from onConnect.
+static std::atomic<uint32_t> s_clients{0};
+
+#define LIVE_FRAME_MAX 224
+
+static size_t dataFrame(char *buf, size_t len) {
+    uint32_t         version = 0;
+    const SensorData data    = getSensorData(&version);
+    JsonWriter w(buf, len);
+    w.beginObject();
+    w.addUInt("v", version);
+    writeSensorFields(w, data, SENSOR_OUT_HTTP);
+    w.addBool("pump", pumpIsOn());
+    w.endObject();
+    return w.ok() ? w.length() : 0;
+}
+
+// AsyncTCP task
+static void onSubscribe(AsyncEventSourceClient *client) {
+    s_clients.fetch_add(1, std::memory_order_relaxed);
+    char frame[LIVE_FRAME_MAX];
+    if (sensorDataVersion() && dataFrame(frame, sizeof(frame))) {
+        client->send(frame, "data", millis(), LIVE_RETRY_MS);
+    }
+}
+
+// AsyncTCP task
+static void onUnsubscribe(AsyncEventSourceClient *) {
+    s_clients.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void initLiveEvents(AsyncWebServer &server) {
+    s_events.onConnect(onSubscribe);
+    s_events.onDisconnect(onUnsubscribe);
+    // Full: the request is not routed here and gets the server's 404
+    s_events.setFilter([](AsyncWebServerRequest *) {
+        return s_clients.load(std::memory_order_relaxed) < LIVE_MAX_CLIENTS;
+    });
+    server.addHandler(&s_events);
+}
+
+void liveEventsLoop() {
+    const uint32_t version = sensorDataVersion();
+    const uint32_t pump    = pumpChangeCount();
+    if (version == s_sentVersion && pump == s_sentPump) return;
+
+    // Nobody listening: just catch up
+    if (s_clients.load(std::memory_order_relaxed) == 0) {
+        s_sentVersion = version;
+        s_sentPump    = pump;
+        return;
+    }
+
+    char frame[LIVE_FRAME_MAX];
+    if (pump != s_sentPump) {
+        s_sentPump = pump;
+        s_events.send(pumpIsOn() ? "{\"on\":true}" : "{\"on\":false}", "pump", millis());
+    }
+    if (version != s_sentVersion) {
+        s_sentVersion = version;
+        if (dataFrame(frame, sizeof(frame))) s_events.send(frame, "data", millis());
+        else LOGW("LIVE", "data frame larger than %u bytes", (unsigned)sizeof(frame));
+    }
+}
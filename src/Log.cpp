@@ -0,0 +1,81 @@
+#include "Log.h"
+#include <stdarg.h>
+#include <LogRing.h>
+
+static uint8_t  s_ringBuf[LOG_RING_BYTES];
+static LogRing  s_ring(s_ringBuf, sizeof(s_ringBuf));
+
+static LogSink           s_sinks[LOG_MAX_SINKS];
+static volatile uint8_t  s_sinkCount = 0;
+static portMUX_TYPE      s_sinkMux   = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_drainLock = nullptr;  // the ring has one consumer
+static TaskHandle_t      s_task      = nullptr;
+
+static const char LEVEL_CHARS[] = "-EWIDV";
+
+static void drain() {
+    static char line[LOG_LINE_MAX];
+    size_t  len;
+    uint8_t level;
+
+    if (s_drainLock) xSemaphoreTake(s_drainLock, portMAX_DELAY);
+    while (s_ring.pop(line, sizeof(line), &len, &level)) {
+        const uint8_t n = s_sinkCount;
+        for (uint8_t i = 0; i < n; i++) s_sinks[i](line, len);
+    }
+    if (s_drainLock) xSemaphoreGive(s_drainLock);
+}
+
+static void logTask(void *) {
+    for (;;) {
+        drain();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
+
+void logBegin() {
+    if (s_task) return;
+    s_drainLock = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, nullptr,
+                            LOG_TASK_PRIORITY, &s_task, SENSOR_TASK_CORE);
+}
+
+bool logAddSink(LogSink sink) {
+    bool added = false;
+    portENTER_CRITICAL(&s_sinkMux);
+    if (s_sinkCount < LOG_MAX_SINKS) {
+        s_sinks[s_sinkCount] = sink;
+        s_sinkCount++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&s_sinkMux);
+    return added;
+}
+
+void logWrite(uint8_t level, const char *tag, const char *fmt, ...) {
+    char line[LOG_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "[%7lu][%c][%s] ", (unsigned long)millis(),
+                     LEVEL_CHARS[level <= LOG_LEVEL_VERBOSE ? level : 0], tag);
+    if (n < 0) return;
+    if (n > (int)sizeof(line) - 1) n = sizeof(line) - 1;
+
+    va_list args;
+    va_start(args, fmt);
+    const int m = vsnprintf(line + n, sizeof(line) - n, fmt, args);
+    va_end(args);
+    if (m > 0) n += m;
+    if (n > (int)sizeof(line) - 1) n = sizeof(line) - 1;
+
+    // Sinks add their own line ending
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) n--;
+
+    s_ring.push(line, (size_t)n, level);
+}
+
+void logFlush() {
+    drain();
+}
+
+uint32_t logDropped() {
+    return s_ring.dropped();
+}
@@ -0,0 +1,224 @@
+#include "Metrics.h"
+#include <atomic>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include "Log.h"
+#include "WifiManager.h"
+#include "SampleScheduler.h"
+#include "PowerManager.h"
+
+// Upper bounds in microseconds, and the same as Prometheus "le" labels
+static const uint32_t BUCKET_US[] = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000 };
+static const char *const BUCKET_LE[] = {
+    "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1", "5", "+Inf"
+};
+#define BUCKETS (sizeof(BUCKET_US) / sizeof(BUCKET_US[0]) + 1)
+
+struct Histogram {
+    std::atomic<uint32_t> bucket[BUCKETS];  // not cumulative
+    uint64_t              sumUs;            // under s_sumMux; 32 bits of us wrap in 71 min
+    std::atomic<uint32_t> count;
+};
+
+// Guards every Histogram::sumUs (no 64-bit atomics on the ESP32)
+static portMUX_TYPE s_sumMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void observe(Histogram &h, uint32_t us) {
+    uint8_t i = 0;
+    while (i < BUCKETS - 1 && us > BUCKET_US[i]) i++;
+    h.bucket[i].fetch_add(1, std::memory_order_relaxed);
+    portENTER_CRITICAL(&s_sumMux);
+    h.sumUs += us;
+    portEXIT_CRITICAL(&s_sumMux);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+static const char *const STEP_NAMES[METRIC_STEP_COUNT] = {
+    "temp", "analog", "ultrasonic", "tds", "ph", "cycle"
+};
+static const char *const FB_UIDS[METRIC_FB_COUNT] = {
+    "authTask", "RTDB_RealTime", "RTDB_Record", "RTDB_Batch", "RTDB_Int", "controlStream", "other"
+};
+
+static Histogram             s_loop;
+static Histogram             s_steps[METRIC_STEP_COUNT];
+static Histogram             s_fbLatency[METRIC_FB_COUNT];
+static std::atomic<uint32_t> s_fbStartUs[METRIC_FB_COUNT];  // 0 = none in flight
+static std::atomic<uint32_t> s_fbOk[METRIC_FB_COUNT];
+static std::atomic<uint32_t> s_fbFailed[METRIC_FB_COUNT];
+static std::atomic<uint32_t> s_fbBusySkips;
+
+void metricsLoopInterval(uint32_t us) {
+    observe(s_loop, us);
+}
+
+void metricsSensorStep(MetricSensorStep step, uint32_t us) {
+    if (step < METRIC_STEP_COUNT) observe(s_steps[step], us);
+}
+
+uint8_t metricsFirebaseTask(const char *uid) {
+    for (uint8_t i = 0; i < METRIC_FB_OTHER; i++) {
+        if (strcmp(uid, FB_UIDS[i]) == 0) return i;
+    }
+    return METRIC_FB_OTHER;
+}
+
+void metricsFirebaseStart(uint8_t task) {
+    if (task >= METRIC_FB_COUNT) return;
+    const uint32_t now = micros();
+    s_fbStartUs[task].store(now ? now : 1, std::memory_order_relaxed);
+}
+
+void metricsFirebaseDone(uint8_t task, bool ok) {
+    if (task >= METRIC_FB_COUNT) return;
+    (ok ? s_fbOk : s_fbFailed)[task].fetch_add(1, std::memory_order_relaxed);
+
+    // Only the first result after a start has a latency (streams keep sending)
+    const uint32_t start = s_fbStartUs[task].exchange(0, std::memory_order_relaxed);
+    if (start) observe(s_fbLatency[task], micros() - start);
+}
+
+void metricsFirebaseBusySkip() {
+    s_fbBusySkips.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ===== Text format =====
+// Appends printf output at *pos, never past max
+static void put(char *out, size_t max, size_t &pos, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void put(char *out, size_t max, size_t &pos, const char *fmt, ...) {
+    if (pos >= max) return;
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(out + pos, max - pos, fmt, args);
+    va_end(args);
+    if (n > 0) pos = pos + n < max ? pos + n : max - 1;
+}
+
+static void putFamily(char *out, size_t max, size_t &pos, const char *name, const char *type,
+                      const char *help) {
+    put(out, max, pos, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// One histogram series; label is "" or `key="value"`
+static void putHistogram(char *out, size_t max, size_t &pos, const char *name, const char *label,
+                         const Histogram &h) {
+    const char *sep = *label ? "," : "";
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+        cumulative += h.bucket[i].load(std::memory_order_relaxed);
+        put(out, max, pos, "%s_bucket{%s%sle=\"%s\"} %lu\n", name, label, sep, BUCKET_LE[i],
+            (unsigned long)cumulative);
+    }
+    portENTER_CRITICAL(&s_sumMux);
+    const uint64_t sumUs = h.sumUs;
+    portEXIT_CRITICAL(&s_sumMux);
+    const char *open  = *label ? "{" : "";
+    const char *close = *label ? "}" : "";
+    put(out, max, pos, "%s_sum%s%s%s %.6f\n", name, open, label, close, sumUs / 1e6);
+    put(out, max, pos, "%s_count%s%s%s %lu\n", name, open, label, close,
+        (unsigned long)h.count.load(std::memory_order_relaxed));
+}
+
+static void putGauge(char *out, size_t max, size_t &pos, const char *name, const char *type,
+                     const char *help, long value) {
+    putFamily(out, max, pos, name, type, help);
+    put(out, max, pos, "%s %ld\n", name, value);
+}
+
+// Items: loop histogram, one per sensor step, one per Firebase task, then
+// the counter, sampling and gauge blocks
+enum : uint16_t {
+    ITEM_LOOP     = 0,
+    ITEM_STEPS    = 1,
+    ITEM_FIREBASE = ITEM_STEPS + METRIC_STEP_COUNT,
+    ITEM_COUNTERS = ITEM_FIREBASE + METRIC_FB_COUNT,
+    ITEM_SAMPLING,
+    ITEM_SYSTEM,
+    ITEM_END
+};
+
+size_t metricsRender(uint16_t &item, char *out, size_t max) {
+    size_t pos = 0;
+    char label[40];
+
+    if (item == ITEM_LOOP) {
+        putFamily(out, max, pos, "vermi_loop_interval_seconds", "histogram",
+                  "Time between consecutive loop() iterations.");
+        putHistogram(out, max, pos, "vermi_loop_interval_seconds", "", s_loop);
+    } else if (item < ITEM_FIREBASE) {
+        const uint8_t i = item - ITEM_STEPS;
+        if (i == 0) {
+            putFamily(out, max, pos, "vermi_sensor_step_seconds", "histogram",
+                      "Acquisition time per sensor step, waits on hardware included.");
+        }
+        snprintf(label, sizeof(label), "step=\"%s\"", STEP_NAMES[i]);
+        putHistogram(out, max, pos, "vermi_sensor_step_seconds", label, s_steps[i]);
+    } else if (item < ITEM_COUNTERS) {
+        const uint8_t i = item - ITEM_FIREBASE;
+        if (i == 0) {
+            putFamily(out, max, pos, "vermi_firebase_latency_seconds", "histogram",
+                      "Firebase request latency by task uid, issue to first result.");
+        }
+        snprintf(label, sizeof(label), "uid=\"%s\"", FB_UIDS[i]);
+        putHistogram(out, max, pos, "vermi_firebase_latency_seconds", label, s_fbLatency[i]);
+    } else if (item == ITEM_COUNTERS) {
+        putFamily(out, max, pos, "vermi_firebase_results_total", "counter",
+                  "Firebase results by task uid and outcome.");
+        for (uint8_t i = 0; i < METRIC_FB_COUNT; i++) {
+            put(out, max, pos, "vermi_firebase_results_total{uid=\"%s\",result=\"ok\"} %lu\n",
+                FB_UIDS[i], (unsigned long)s_fbOk[i].load(std::memory_order_relaxed));
+            put(out, max, pos, "vermi_firebase_results_total{uid=\"%s\",result=\"error\"} %lu\n",
+                FB_UIDS[i], (unsigned long)s_fbFailed[i].load(std::memory_order_relaxed));
+        }
+        putGauge(out, max, pos, "vermi_firebase_busy_skips_total", "counter",
+                 "Uploads skipped or queued because a request was in flight.",
+                 (long)s_fbBusySkips.load(std::memory_order_relaxed));
+        putGauge(out, max, pos, "vermi_log_dropped_total", "counter",
+                 "Log lines lost to a full log ring.", (long)logDropped());
+    } else if (item == ITEM_SAMPLING) {
+        putFamily(out, max, pos, "vermi_sample_interval_seconds", "gauge",
+                  "Current acquisition interval per channel (adaptive sampling).");
+        for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+            const uint32_t ms = sampleSchedulerIntervalMs((SampleChannel)i);
+            put(out, max, pos, "vermi_sample_interval_seconds{channel=\"%s\"} %.3f\n",
+                sampleChannelName((SampleChannel)i), ms / 1000.0);
+        }
+        putFamily(out, max, pos, "vermi_samples_total", "counter",
+                  "Readings taken per acquisition channel.");
+        for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+            put(out, max, pos, "vermi_samples_total{channel=\"%s\"} %lu\n",
+                sampleChannelName((SampleChannel)i), (unsigned long)sampleSchedulerReadings((SampleChannel)i));
+        }
+    } else if (item == ITEM_SYSTEM) {
+        putGauge(out, max, pos, "vermi_heap_free_bytes", "gauge", "Free internal heap.",
+                 (long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+        putGauge(out, max, pos, "vermi_heap_min_free_bytes", "gauge", "Lowest free internal heap since boot.",
+                 (long)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+        putGauge(out, max, pos, "vermi_heap_largest_free_block_bytes", "gauge", "Largest allocatable internal block.",
+                 (long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+        putGauge(out, max, pos, "vermi_psram_size_bytes", "gauge", "PSRAM size (0 = none).",
+                 (long)ESP.getPsramSize());
+        putGauge(out, max, pos, "vermi_psram_free_bytes", "gauge", "Free PSRAM.",
+                 (long)ESP.getFreePsram());
+        putGauge(out, max, pos, "vermi_wifi_connected", "gauge", "1 while the station link is up.",
+                 wifiManagerConnected() ? 1 : 0);
+        if (wifiManagerConnected()) {
+            putGauge(out, max, pos, "vermi_wifi_rssi_dbm", "gauge", "Station RSSI.", (long)WiFi.RSSI());
+        }
+        putGauge(out, max, pos, "vermi_wifi_reconnects_total", "counter",
+                 "Station links re-established after a drop.", (long)wifiManagerReconnects());
+        putGauge(out, max, pos, "vermi_uptime_seconds", "gauge", "Seconds since boot.",
+                 (long)(millis() / 1000));
+#if POWER_MODE != 0
+        putGauge(out, max, pos, "vermi_light_sleep_seconds_total", "counter",
+                 "Time spent in light sleep since boot.", (long)(powerSleptMs() / 1000));
+#endif
+    } else {
+        return 0;
+    }
+
+    item++;
+    return pos;
+}
@@ -0,0 +1,215 @@
+#include "PowerManager.h"
+
+#if POWER_MODE != 0
+
+#include <time.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/rtc_io.h>
+#include "Log.h"
+#include "Hal.h"
+#include "PowerPlan.h"
+#include "PumpHandler.h"
+#include "SensorHandler.h"
+#include "SampleScheduler.h"
+#include "WifiManager.h"
+#include "FirebaseHandler.h"
+#include "RecordQueue.h"
+#include "HistoryLog.h"
+#include "ControlTrace.h"
+#include "BootTrace.h"
+#include "ReportFilter.h"
+
+#define POWER_RTC_MAGIC   0x50575232u  // "PWR2" (report filter state added)
+#define CLOCK_VALID_AFTER 1600000000   // unix time of a synced clock (2020)
+
+// Survives deep sleep (RTC slow memory); reset on power-up
+struct PowerRtc {
+    uint32_t    magic;
+    uint32_t    monoBootMs;  // monotonic ms at the start of this boot
+    uint32_t    spanMs;      // previous boot: awake + sleep
+    PumpControl pump;
+    PowerBatch  batch;
+    ReportFilterState report;  // last upload per field, on the monotonic clock
+};
+
+RTC_DATA_ATTR static PowerRtc s_rtc;
+
+static bool     s_uploadWake     = true;
+static bool     s_added          = false;  // this wake's reading is in the batch
+static uint32_t s_serviceUntilMs = 0;
+static uint32_t s_radioChangedMs = 0;
+static uint32_t s_sleptMs        = 0;
+
+static bool clockSet() {
+    return time(nullptr) > CLOCK_VALID_AFTER;
+}
+
+static uint32_t monoNow() {
+    return s_rtc.monoBootMs + millis();
+}
+
+static bool serviceActive(uint32_t now) {
+    return (int32_t)(s_serviceUntilMs - now) > 0;
+}
+
+void powerBegin(PumpControl &pump) {
+    const esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+
+#if POWER_WAKE_GPIO >= 0
+    pinMode(POWER_WAKE_GPIO, INPUT_PULLUP);
+    if (cause == ESP_SLEEP_WAKEUP_EXT0) {
+        s_serviceUntilMs = millis() + POWER_SERVICE_MS;
+        LOGI("POWER", "service wake, radio up for %lu s", (unsigned long)(POWER_SERVICE_MS / 1000));
+    }
+#endif
+
+#if POWER_MODE == 2
+    if (s_rtc.magic == POWER_RTC_MAGIC && cause != ESP_SLEEP_WAKEUP_UNDEFINED) {
+        s_rtc.monoBootMs += s_rtc.spanMs;
+        pump = s_rtc.pump;
+        powerRebasePump(pump, s_rtc.spanMs);
+    } else {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = POWER_RTC_MAGIC;
+        powerBatchReset(s_rtc.batch);
+    }
+    s_uploadWake = powerUploadWake(s_rtc.batch, monoNow(), clockSet()) || serviceActive(millis());
+    LOGI("POWER", "wake %u, %u reading(s) held, %s", (unsigned)cause, s_rtc.batch.count,
+         s_uploadWake ? "uploading" : "reading only");
+#endif
+}
+
+bool powerNetworkAtBoot() {
+    return POWER_MODE != 2 || s_uploadWake;
+}
+
+uint32_t powerSleptMs() {
+    return s_sleptMs;
+}
+
+// ===== Light sleep =====
+static void lightLoop(uint32_t uploadEveryMs) {
+    const uint32_t now = millis();
+
+    PowerState st;
+    st.nextReadingMs = sampleSchedulerWaitMs(now, pumpIsOn());
+    st.sinceRadioMs  = now - s_radioChangedMs;
+    st.radioEveryMs  = uploadEveryMs;
+    st.radioUp       = wifiManagerRadioOn();
+    st.radioPending  = firebaseUploadPending() || !clockSet();
+    st.service       = serviceActive(now) || wifiManagerApActive();
+    st.pumpOn        = pumpIsOn();
+    st.cycleBusy     = sensorCycleBusy();
+
+    const bool radio = powerRadioWanted(st);
+    if (radio != st.radioUp) {
+        if (!radio) firebaseRadioDown();
+        wifiManagerSetRadio(radio);
+        s_radioChangedMs = now;
+        return;
+    }
+
+    const uint32_t sleepMs = powerLightSleepMs(st);
+    if (sleepMs == 0) return;
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+#if POWER_WAKE_GPIO >= 0
+    gpio_wakeup_enable((gpio_num_t)POWER_WAKE_GPIO, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+#endif
+    logFlush();
+    const uint32_t before = millis();
+    esp_light_sleep_start();
+    s_sleptMs += millis() - before;
+
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+        s_serviceUntilMs = millis() + POWER_SERVICE_MS;
+        LOGI("POWER", "service wake, radio up for %lu s", (unsigned long)(POWER_SERVICE_MS / 1000));
+    }
+    sensorTaskWake();  // its FreeRTOS delay did not advance while asleep
+}
+
+// ===== Deep sleep =====
+// Moves the held readings into RecordQueue once they can be keyed by unix
+// time, each through the report filter at the time it was taken, like the
+// live uploads in main.cpp; true when this wake's uploading is finished
+static bool uploadStep(uint32_t now) {
+    if (s_rtc.batch.count && clockSet()) {
+        const uint32_t unixNow = (uint32_t)time(nullptr);
+        const uint32_t mono    = monoNow();
+        uint16_t queued = 0;
+        for (uint16_t i = 0; i < s_rtc.batch.count; i++) {
+            const PowerBatchEntry &e = s_rtc.batch.entry[i];
+            const uint16_t fields = reportDueFields(s_rtc.report, e.data, e.monoMs);
+            if (fields == 0) continue;  // nothing moved past its deadband
+            recordQueuePush(powerBatchTimestamp(s_rtc.batch, i, unixNow, mono), e.data, fields);
+            reportCommit(s_rtc.report, e.data, fields, e.monoMs);
+            queued++;
+        }
+        LOGI("POWER", "%u of %u held reading(s) queued for upload", queued, s_rtc.batch.count);
+        powerBatchReset(s_rtc.batch);
+    }
+    if (now >= POWER_RADIO_MAX_MS) return true;  // the rest goes with the next upload wake
+    if (s_rtc.batch.count) return false;         // waiting on NTP
+    return now >= POWER_RADIO_MIN_MS && !firebaseUploadPending();
+}
+
+static void deepSleep(PumpControl &pump) {
+    const uint32_t sleepMs = powerDeepSleepMs(millis());
+
+    recordQueueFlush();
+    historyLogFlush();
+#if CONTROL_TRACE_ENABLED
+    controlTraceFlush();
+#endif
+
+    setPump(false);
+    halPumpHoldOff();
+    s_rtc.pump   = pump;
+    s_rtc.spanMs = millis() + sleepMs;
+
+    LOGI("POWER", "deep sleep %lu ms after %lu ms awake, %u reading(s) held",
+         (unsigned long)sleepMs, (unsigned long)millis(), s_rtc.batch.count);
+    logFlush();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+#if POWER_WAKE_GPIO >= 0
+    rtc_gpio_pullup_en((gpio_num_t)POWER_WAKE_GPIO);
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)POWER_WAKE_GPIO, 0);
+#endif
+    esp_deep_sleep_start();
+}
+
+static void deepLoop(PumpControl &pump, const SensorData &data, uint32_t dataVersion) {
+    const uint32_t now = millis();
+
+    // Awake while the pump runs (its rules need fresh readings), until the
+    // rules have run on this wake's reading and until flash is mounted. The
+    // version is the one loop() used: a reading published after the pump
+    // step waits for the next loop() instead of going to sleep unchecked.
+    if (pumpIsOn() || sensorCycleBusy() || dataVersion == 0 ||
+        !bootReached(BOOT_STORAGE_READY)) {
+        return;
+    }
+
+    if (!s_added) {
+        powerBatchAdd(s_rtc.batch, monoNow(), data);
+        s_added = true;
+    }
+
+    if (s_uploadWake && !uploadStep(now)) return;
+    if (serviceActive(now)) return;
+    deepSleep(pump);
+}
+
+void powerLoop(PumpControl &pump, uint32_t uploadEveryMs,
+               const SensorData &data, uint32_t dataVersion) {
+#if POWER_MODE == 1
+    lightLoop(uploadEveryMs);
+#else
+    deepLoop(pump, data, dataVersion);
+#endif
+}
+
+#endif
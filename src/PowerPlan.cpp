@@ -0,0 +1,58 @@
+#include "PowerPlan.h"
+#include <string.h>
+
+// ===== Light sleep =====
+bool powerRadioWanted(const PowerState &s) {
+    if (s.service) return true;
+    if (!s.radioUp) return s.sinceRadioMs >= s.radioEveryMs;
+
+    // A window runs its minimum length, longer while uploads are still going
+    if (s.sinceRadioMs < POWER_RADIO_MIN_MS) return true;
+    return s.radioPending && s.sinceRadioMs < POWER_RADIO_MAX_MS;
+}
+
+uint32_t powerLightSleepMs(const PowerState &s) {
+    // The pump rules and the network stack only run while awake
+    if (s.pumpOn || s.cycleBusy || s.radioUp || s.service) return 0;
+
+    uint32_t ms = s.nextReadingMs > POWER_WARMUP_MS ? s.nextReadingMs - POWER_WARMUP_MS : 0;
+    const uint32_t toRadio = s.sinceRadioMs < s.radioEveryMs ? s.radioEveryMs - s.sinceRadioMs : 0;
+    if (toRadio < ms) ms = toRadio;
+
+    return ms >= POWER_SLEEP_MIN_MS ? ms : 0;
+}
+
+// ===== Deep sleep =====
+void powerBatchReset(PowerBatch &b) {
+    b.count = 0;
+}
+
+void powerBatchAdd(PowerBatch &b, uint32_t monoMs, const SensorData &d) {
+    if (b.count == POWER_BATCH_RECORDS) {
+        memmove(&b.entry[0], &b.entry[1], sizeof(b.entry[0]) * (POWER_BATCH_RECORDS - 1));
+        b.count--;
+    }
+    b.entry[b.count].monoMs = monoMs;
+    b.entry[b.count].data   = d;
+    b.count++;
+}
+
+bool powerUploadWake(const PowerBatch &b, uint32_t monoMs, bool clockSet) {
+    if (!clockSet || b.count + 1 >= POWER_BATCH_RECORDS) return true;
+    return b.count > 0 && monoMs - b.entry[0].monoMs >= POWER_BATCH_MAX_AGE_MS;
+}
+
+uint32_t powerBatchTimestamp(const PowerBatch &b, uint16_t i, uint32_t unixNow, uint32_t monoNowMs) {
+    return unixNow - (monoNowMs - b.entry[i].monoMs) / 1000;
+}
+
+uint32_t powerDeepSleepMs(uint32_t awakeMs) {
+    if (awakeMs + POWER_SLEEP_MIN_MS >= POWER_DEEP_PERIOD_MS) return POWER_SLEEP_MIN_MS;
+    return POWER_DEEP_PERIOD_MS - awakeMs;
+}
+
+void powerRebasePump(PumpControl &pc, uint32_t elapsedMs) {
+    // Unsigned wrap keeps now - lastOffMs correct in the new clock
+    pc.startMs   -= elapsedMs;
+    pc.lastOffMs -= elapsedMs;
+}
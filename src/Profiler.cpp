@@ -0,0 +1,106 @@
+#include "Profiler.h"
+
+#if LOOP_PROFILER
+#include "Log.h"
+
+// Bucket i < 4 holds exactly i cycles; above that each power of two 2^e is
+// split into 4 buckets of width 2^(e-2)
+#define PROF_BUCKETS 124
+
+struct PhaseStats {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t bucket[PROF_BUCKETS];
+};
+
+static const char *const PHASE_NAMES[PROF_PHASE_COUNT] = {
+    "loop", "wifi_server", "firebase", "history", "trend", "upload", "pump", "sensor_poll"
+};
+
+static PhaseStats s_phases[PROF_PHASE_COUNT];
+
+static inline uint8_t bucketOf(uint32_t cycles) {
+    if (cycles < 4) return (uint8_t)cycles;
+    const uint8_t e = 31 - __builtin_clz(cycles);
+    return (uint8_t)((e - 1) * 4 + ((cycles >> (e - 2)) & 3));
+}
+
+static uint32_t bucketUpper(uint8_t i) {
+    if (i < 4) return i;
+    const uint8_t  e     = i / 4 + 1;
+    const uint32_t width = 1UL << (e - 2);
+    return ((4UL + i % 4) << (e - 2)) + (width - 1);
+}
+
+void profilerRecord(ProfPhase phase, uint32_t cycles) {
+    if (phase >= PROF_PHASE_COUNT) return;
+    PhaseStats &p = s_phases[phase];
+    if (p.count == 0 || cycles < p.min) p.min = cycles;
+    if (cycles > p.max) p.max = cycles;
+    p.bucket[bucketOf(cycles)]++;
+    p.count++;
+}
+
+void profilerReset() {
+    memset(s_phases, 0, sizeof(s_phases));
+}
+
+// Smallest bucket bound covering the q-quantile (permille), capped at max
+static uint32_t quantile(const PhaseStats &p, uint32_t permille) {
+    const uint32_t target = (uint32_t)(((uint64_t)p.count * permille + 999) / 1000);
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < PROF_BUCKETS; i++) {
+        seen += p.bucket[i];
+        if (seen >= target) {
+            const uint32_t upper = bucketUpper(i);
+            return upper < p.max ? upper : p.max;
+        }
+    }
+    return p.max;
+}
+
+size_t profilerReport(char *out, size_t max) {
+    if (max == 0) return 0;
+    const uint32_t mhz = getCpuFrequencyMhz();
+    size_t pos = 0;
+
+    int n = snprintf(out, max, "%-12s %9s %9s %9s %9s %9s %9s %9s  (us)\n",
+                     "phase", "count", "min", "p50", "p90", "p99", "p99.9", "max");
+    pos = n > 0 ? ((size_t)n < max ? (size_t)n : max - 1) : 0;
+
+    for (uint8_t i = 0; i < PROF_PHASE_COUNT && pos + 1 < max; i++) {
+        const PhaseStats p = s_phases[i];  // copy: the writer keeps going
+        if (p.count == 0) {
+            n = snprintf(out + pos, max - pos, "%-12s %9lu\n", PHASE_NAMES[i], 0UL);
+        } else {
+            n = snprintf(out + pos, max - pos, "%-12s %9lu %9lu %9lu %9lu %9lu %9lu %9lu\n",
+                         PHASE_NAMES[i], (unsigned long)p.count,
+                         (unsigned long)(p.min / mhz),
+                         (unsigned long)(quantile(p, 500) / mhz),
+                         (unsigned long)(quantile(p, 900) / mhz),
+                         (unsigned long)(quantile(p, 990) / mhz),
+                         (unsigned long)(quantile(p, 999) / mhz),
+                         (unsigned long)(p.max / mhz));
+        }
+        if (n > 0) pos = pos + n < max ? pos + n : max - 1;
+    }
+    return pos;
+}
+
+void profilerLog() {
+    char report[(PROF_PHASE_COUNT + 1) * 96];
+    profilerReport(report, sizeof(report));
+
+    // One log line per report line
+    char *line = report;
+    while (*line) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        LOGI("PROF", "%s", line);
+        if (!nl) break;
+        line = nl + 1;
+    }
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "PumpControl.h"
+#include "Config.h"
+
+const PumpRules PUMP_RULES_DEFAULT = {
+  60,             // moistOnBelow
+  80,             // moistOffAbove
+  30.0f,          // tempOnAbove
+  90,             // teaBlockAt:  ≥90% → never turn ON
+  85,             // teaResumeAt: ≤85% → allow ON again (hysteresis)
+  PUMP_DURATION,  // durationMs
+  PUMP_COOLDOWN,  // cooldownMs
+};
+
+static const char *const REASON_NAMES[PUMP_REASON_COUNT] = {
+  "none", "water_empty", "tea_full", "moist_low", "temp_high", "duration", "moist_ok"
+};
+
+const char *pumpReasonName(uint8_t reason) {
+  return reason < PUMP_REASON_COUNT ? REASON_NAMES[reason] : "unknown";
+}
+
+static bool turnOff(PumpControl &pc, uint32_t nowMs, PumpReason reason) {
+  if (!pc.active) return false;
+  pc.active    = false;
+  pc.lastOffMs = nowMs;
+  pc.reason    = reason;
+  return true;
+}
+
+bool pumpControlStep(PumpControl &pc, const SensorData &data, uint32_t nowMs,
+                     const PumpRules &rules) {
+  // Average temperature (simple mean; adjust if you want to ignore NaNs)
+  const float avgTemp = (data.temp_val_1 + data.temp_val_2) / 2.0f;
+
+  // Average moisture from both probes
+  const int avgMoist = getAvgMoisture(data);
+
+  // Ultrasonic (% full) used as Vermi Tea tank level
+  const int vermiTeaLevel = data.ultra_level_percent;
+
+  // 1) Safety: if tank water level sensor says empty/invalid, force OFF
+  if (data.water_level <= 0) return turnOff(pc, nowMs, PUMP_REASON_WATER_EMPTY);
+
+  // 2) Hard block: if Vermi Tea ≥ 90%, ensure pump is OFF and block ON
+  if (vermiTeaLevel >= rules.teaBlockAt) return turnOff(pc, nowMs, PUMP_REASON_TEA_FULL);
+
+  // 3) Optional hysteresis: only allow ON again when level < 85%
+  if (!pc.active && vermiTeaLevel > rules.teaResumeAt) return false;
+
+  // 4) Normal pump control logic
+  // Turn ON if cooldown elapsed AND (avg moisture low OR temp high). A hot
+  // bed that is already wet enough to stop the pump does not start it: the
+  // OFF rule below would end the run on the next pass.
+  if (!pc.active && (nowMs - pc.lastOffMs >= rules.cooldownMs)) {
+    const bool hot = avgTemp > rules.tempOnAbove && avgMoist <= rules.moistOffAbove;
+    if (avgMoist < rules.moistOnBelow || hot) {
+      pc.active  = true;
+      pc.startMs = nowMs;
+      pc.reason  = avgMoist < rules.moistOnBelow ? PUMP_REASON_MOIST_LOW : PUMP_REASON_TEMP_HIGH;
+      return true;
+    }
+  }
+
+  // Turn OFF if duration elapsed OR avg moisture restored
+  if (pc.active) {
+    if (nowMs - pc.startMs >= rules.durationMs) return turnOff(pc, nowMs, PUMP_REASON_DURATION);
+    if (avgMoist > rules.moistOffAbove)         return turnOff(pc, nowMs, PUMP_REASON_MOIST_OK);
+  }
+  return false;
+}
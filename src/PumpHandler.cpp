@@ -1,19 +1,26 @@
 #include "PumpHandler.h"
-#include "Config.h"   // optional: define PUMP_RELAY and RELAY_ACTIVE_LOW here
-
-#define PUMP_RELAY 25
-
-
-#define PUMP_ON_LEVEL  HIGH
-#define PUMP_OFF_LEVEL LOW
+#include "Hal.h"   // relay pin and levels live in the HAL
 
+static volatile bool     s_pumpOn      = false;
+static volatile uint32_t s_pumpChanges = 0;
 
 void initPump() {
-  pinMode(PUMP_RELAY, OUTPUT);
-  digitalWrite(PUMP_RELAY, PUMP_OFF_LEVEL);  // start OFF
+  halPumpInit();  // start OFF
 }
 
 void setPump(bool isPump) {
 
-  digitalWrite(PUMP_RELAY, isPump ? PUMP_ON_LEVEL : PUMP_OFF_LEVEL);
+  halPumpWrite(isPump);
+  if (isPump != s_pumpOn) {
+    s_pumpOn = isPump;
+    s_pumpChanges = s_pumpChanges + 1;
+  }
+}
+
+bool pumpIsOn() {
+  return s_pumpOn;
+}
+
+uint32_t pumpChangeCount() {
+  return s_pumpChanges;
 }
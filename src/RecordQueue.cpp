@@ -0,0 +1,244 @@
+#include "RecordQueue.h"
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include "Config.h"
+#include "Log.h"
+
+#define SPOOL_PATH  "/rq_spool.bin"
+#define HEAD_PATH   "/rq_head.bin"
+#define TRIM_PATH   "/rq_trim.bin"
+#define SPOOL_MAGIC 0x32515256UL  // "VRQ2" (records carry a field mask)
+
+// The spool starts with this header; a record size mismatch (struct changed
+// between firmware versions) discards the old spool instead of misreading it.
+struct SpoolHeader {
+    uint32_t magic;
+    uint32_t recordSize;
+};
+
+static const uint32_t REC_SIZE = sizeof(QueuedRecord);
+
+// ===== RAM ring =====
+static QueuedRecord *s_ring      = nullptr;
+static size_t        s_ringCap   = 0;
+static size_t        s_ringHead  = 0;  // index of the oldest record
+static size_t        s_ringCount = 0;
+
+// ===== Flash spool =====
+static bool     s_fsReady   = false;
+static uint32_t s_spoolHead = 0;  // byte offset of the oldest unread record
+static uint32_t s_spoolSize = 0;  // byte size of the spool file (0 = none)
+static uint32_t s_dropped   = 0;
+
+static size_t spoolCount() {
+    return s_spoolSize > s_spoolHead ? (s_spoolSize - s_spoolHead) / REC_SIZE : 0;
+}
+
+static void saveSpoolHead() {
+    File f = LittleFS.open(HEAD_PATH, "w");
+    if (!f) return;
+    f.write((const uint8_t *)&s_spoolHead, sizeof(s_spoolHead));
+    f.close();
+}
+
+static void resetSpool() {
+    LittleFS.remove(SPOOL_PATH);
+    LittleFS.remove(HEAD_PATH);
+    s_spoolHead = 0;
+    s_spoolSize = 0;
+}
+
+// Appends go to the end of the file, so a torn tail record would put every
+// later record off the record boundary. LittleFS cannot truncate: copy the
+// unread whole records into a fresh spool instead (boot only, after a power
+// cut).
+static void trimSpool() {
+    if (!LittleFS.rename(SPOOL_PATH, TRIM_PATH)) {
+        resetSpool();
+        return;
+    }
+    File in  = LittleFS.open(TRIM_PATH, "r");
+    File out = LittleFS.open(SPOOL_PATH, "w");
+    const SpoolHeader hdr = { SPOOL_MAGIC, REC_SIZE };
+    bool ok = in && out && in.seek(s_spoolHead) &&
+              out.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+
+    uint8_t buf[256];
+    uint32_t left = s_spoolSize - s_spoolHead;
+    while (ok && left > 0) {
+        const size_t n = left < sizeof(buf) ? left : sizeof(buf);
+        ok = in.read(buf, n) == n && out.write(buf, n) == n;
+        left -= n;
+    }
+    if (in) in.close();
+    if (out) out.close();
+    LittleFS.remove(TRIM_PATH);
+
+    if (!ok) {
+        LOGW("QUEUE", "spool trim failed, discarding it");
+        resetSpool();
+        return;
+    }
+    s_spoolSize = sizeof(hdr) + (s_spoolSize - s_spoolHead);
+    s_spoolHead = sizeof(hdr);
+    LittleFS.remove(HEAD_PATH);
+}
+
+static void loadSpool() {
+    File f = LittleFS.open(SPOOL_PATH, "r");
+    if (!f) return;
+
+    SpoolHeader hdr = {0, 0};
+    const size_t size = f.size();
+    const bool valid = f.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+                       hdr.magic == SPOOL_MAGIC && hdr.recordSize == REC_SIZE;
+    f.close();
+    if (!valid) {
+        LOGW("QUEUE", "discarding incompatible spool");
+        resetSpool();
+        return;
+    }
+
+    // Ignore a torn record at the tail (power cut mid-write)
+    s_spoolSize = sizeof(hdr) + ((size - sizeof(hdr)) / REC_SIZE) * REC_SIZE;
+    s_spoolHead = sizeof(hdr);
+
+    File h = LittleFS.open(HEAD_PATH, "r");
+    if (h) {
+        uint32_t head = 0;
+        if (h.read((uint8_t *)&head, sizeof(head)) == sizeof(head) &&
+            head >= sizeof(hdr) && head <= s_spoolSize &&
+            (head - sizeof(hdr)) % REC_SIZE == 0) {
+            s_spoolHead = head;
+        }
+        h.close();
+    }
+
+    if (spoolCount() == 0) {
+        resetSpool();
+    } else if (size != s_spoolSize) {
+        trimSpool();
+    }
+}
+
+bool initRecordQueue() {
+    if (!s_ring) {
+        s_ringCap = RECORD_QUEUE_RAM;
+        s_ring = (QueuedRecord *)heap_caps_malloc(s_ringCap * REC_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_ring) {
+            // No PSRAM: keep a small ring in internal RAM and lean on the spool
+            s_ringCap = RECORD_QUEUE_FLUSH_AT * 2;
+            s_ring = (QueuedRecord *)malloc(s_ringCap * REC_SIZE);
+        }
+        if (!s_ring) s_ringCap = 0;
+    }
+
+    s_fsReady = LittleFS.begin(true);
+    if (s_fsReady) {
+        loadSpool();
+    } else {
+        LOGE("QUEUE", "LittleFS mount failed, RAM only");
+    }
+
+    LOGI("QUEUE", "ready: %u spooled, RAM ring %u", (unsigned)spoolCount(), (unsigned)s_ringCap);
+    return s_ring != nullptr;
+}
+
+void recordQueueFlush() {
+    if (!s_fsReady || s_ringCount == 0) return;
+
+    const uint32_t base = s_spoolSize ? s_spoolSize : sizeof(SpoolHeader);
+    size_t room = base < RECORD_QUEUE_SPOOL_MAX ? (RECORD_QUEUE_SPOOL_MAX - base) / REC_SIZE : 0;
+    size_t n = s_ringCount < room ? s_ringCount : room;
+    if (n == 0) return;
+
+    File f = LittleFS.open(SPOOL_PATH, "a");
+    if (!f) return;
+    if (s_spoolSize == 0) {
+        const SpoolHeader hdr = { SPOOL_MAGIC, REC_SIZE };
+        f.write((const uint8_t *)&hdr, sizeof(hdr));
+        s_spoolSize = sizeof(hdr);
+        s_spoolHead = sizeof(hdr);
+    }
+
+    // The ring may wrap: write it as up to two contiguous runs
+    size_t written = 0;
+    while (written < n) {
+        const size_t idx = (s_ringHead + written) % s_ringCap;
+        size_t run = s_ringCap - idx;
+        if (run > n - written) run = n - written;
+        if (f.write((const uint8_t *)&s_ring[idx], run * REC_SIZE) != run * REC_SIZE) break;
+        written += run;
+    }
+    f.close();
+
+    s_spoolSize += written * REC_SIZE;
+    s_ringHead   = (s_ringHead + written) % s_ringCap;
+    s_ringCount -= written;
+}
+
+void recordQueuePush(uint32_t timestamp, const SensorData &data, uint16_t fields) {
+    if (s_ringCap == 0) {
+        s_dropped++;
+        return;
+    }
+    if (s_ringCount == s_ringCap) recordQueueFlush();
+    if (s_ringCount == s_ringCap) {
+        s_dropped++;  // both stores full: keep what we have, lose the newest
+        return;
+    }
+
+    QueuedRecord &rec = s_ring[(s_ringHead + s_ringCount) % s_ringCap];
+    rec.timestamp = timestamp;
+    rec.data      = data;
+    rec.fields    = fields;
+    s_ringCount++;
+
+    if (s_ringCount >= RECORD_QUEUE_FLUSH_AT) recordQueueFlush();
+}
+
+size_t recordQueuePeek(QueuedRecord *out, size_t max) {
+    size_t n = 0;
+
+    const size_t spooled = spoolCount();
+    if (spooled > 0 && max > 0) {
+        File f = LittleFS.open(SPOOL_PATH, "r");
+        if (f && f.seek(s_spoolHead)) {
+            size_t want = spooled < max ? spooled : max;
+            n = f.read((uint8_t *)out, want * REC_SIZE) / REC_SIZE;
+        }
+        if (f) f.close();
+        // Never hand out RAM records ahead of unread spool records
+        if (n < spooled && n < max) return n;
+    }
+
+    for (size_t i = 0; i < s_ringCount && n < max; i++) {
+        out[n++] = s_ring[(s_ringHead + i) % s_ringCap];
+    }
+    return n;
+}
+
+void recordQueuePop(size_t count) {
+    const size_t spooled = spoolCount();
+    const size_t fromSpool = count < spooled ? count : spooled;
+    if (fromSpool > 0) {
+        s_spoolHead += fromSpool * REC_SIZE;
+        if (spoolCount() == 0) resetSpool();
+        else saveSpoolHead();
+        count -= fromSpool;
+    }
+
+    if (count > s_ringCount) count = s_ringCount;
+    if (count > 0) {
+        s_ringHead   = (s_ringHead + count) % s_ringCap;
+        s_ringCount -= count;
+    }
+}
+
+size_t recordQueueSize() {
+    return spoolCount() + s_ringCount;
+}
+
+uint32_t recordQueueDropped() {
+    return s_dropped;
+}
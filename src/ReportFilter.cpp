@@ -0,0 +1,60 @@
+#include "ReportFilter.h"
+#include <math.h>
+#include "Config.h"
+#include "SensorFields.h"
+
+static ReportFilterState s_state;  // live uploads, since boot
+static uint32_t          s_suppressed = 0;
+
+static bool exceedsDeadband(const SensorField &f, float last, float now) {
+  const bool lastNan = isnan(last);
+  if (lastNan || isnan(now)) return lastNan != isnan(now);
+
+  float band = f.deadband;
+  const float pct = fabsf(last) * f.deadbandPct / 100.0f;
+  if (pct > band) band = pct;
+
+  const float diff = fabsf(now - last);
+  return band > 0 ? diff > band : diff != 0;
+}
+
+uint16_t reportDueFields(const ReportFilterState &state, const SensorData &d, uint32_t nowMs) {
+  uint16_t mask = 0;
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    const SensorField &f = SENSOR_FIELDS[i];
+    if (!(f.outputs & SENSOR_OUT_RECORD)) continue;
+
+    const ReportFieldState &st = state.field[i];
+    const float v = sensorFieldValue(d, f);
+    if (!st.sent || nowMs - st.atMs >= REPORT_HEARTBEAT_MS || exceedsDeadband(f, st.value, v)) {
+      mask |= (uint16_t)(1u << i);
+    }
+  }
+  return mask;
+}
+
+void reportCommit(ReportFilterState &state, const SensorData &d, uint16_t mask, uint32_t nowMs) {
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    if (!(SENSOR_FIELDS[i].outputs & SENSOR_OUT_RECORD)) continue;
+    if (!(mask & (1u << i))) {
+      s_suppressed++;
+      continue;
+    }
+    ReportFieldState &st = state.field[i];
+    st.value = sensorFieldValue(d, SENSOR_FIELDS[i]);
+    st.atMs  = nowMs;
+    st.sent  = true;
+  }
+}
+
+uint16_t reportDueFields(const SensorData &d, uint32_t nowMs) {
+  return reportDueFields(s_state, d, nowMs);
+}
+
+void reportCommit(const SensorData &d, uint16_t mask, uint32_t nowMs) {
+  reportCommit(s_state, d, mask, nowMs);
+}
+
+uint32_t reportSuppressedFields() {
+  return s_suppressed;
+}
@@ -0,0 +1,200 @@
+#include "SampleScheduler.h"
+#include <atomic>
+#include <math.h>
+#include "Config.h"
+#include "Log.h"
+
+#if ADAPTIVE_SAMPLING
+#define BOUNDS(ch) SAMPLE_##ch##_FAST_MS, SAMPLE_##ch##_SLOW_MS
+#else
+#define BOUNDS(ch) SENSOR_READ_INTERVAL, SENSOR_READ_INTERVAL
+#endif
+
+// A channel due this soon is read in the same cycle as one that is due now
+#define SAMPLE_GROUP_MS   500
+#define SAMPLE_VALUES_MAX 3
+
+struct ChannelSpec {
+    const char *name;
+    uint32_t    fastMs;
+    uint32_t    slowMs;
+    float       delta;
+    bool        pumpMoves;  // fastMs while the pump runs
+};
+
+static const ChannelSpec SPECS[SAMPLE_CHANNEL_COUNT] = {
+    { "temp",       BOUNDS(TEMP),       SAMPLE_TEMP_DELTA,       false },
+    { "analog",     BOUNDS(ANALOG),     SAMPLE_ANALOG_DELTA,     true  },
+    { "ultrasonic", BOUNDS(ULTRASONIC), SAMPLE_ULTRASONIC_DELTA, true  },
+    { "tds",        BOUNDS(TDS),        SAMPLE_TDS_DELTA,        false },
+    { "ph",         BOUNDS(PH),         SAMPLE_PH_DELTA,         false },
+};
+
+// Bounds may be set from loop() (ControlDoc.cpp), the rest is sensor-task state
+static std::atomic<uint32_t> s_fastMs[SAMPLE_CHANNEL_COUNT];
+static std::atomic<uint32_t> s_slowMs[SAMPLE_CHANNEL_COUNT];
+static std::atomic<uint32_t> s_intervalMs[SAMPLE_CHANNEL_COUNT];
+static std::atomic<uint32_t> s_readings[SAMPLE_CHANNEL_COUNT];
+static std::atomic<uint8_t>  s_moving(0);
+
+static uint32_t s_lastMs[SAMPLE_CHANNEL_COUNT];
+static float    s_last[SAMPLE_CHANNEL_COUNT][SAMPLE_VALUES_MAX];
+static uint8_t  s_seen = 0;  // channels read at least once
+
+void sampleSchedulerInit() {
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        s_fastMs[i].store(SPECS[i].fastMs, std::memory_order_relaxed);
+        s_slowMs[i].store(SPECS[i].slowMs, std::memory_order_relaxed);
+        s_intervalMs[i].store(SPECS[i].fastMs, std::memory_order_relaxed);
+        s_readings[i].store(0, std::memory_order_relaxed);
+    }
+    s_moving.store(0, std::memory_order_relaxed);
+    s_seen = 0;
+}
+
+const char *sampleChannelName(SampleChannel ch) {
+    return ch < SAMPLE_CHANNEL_COUNT ? SPECS[ch].name : "?";
+}
+
+bool sampleSchedulerSetBounds(SampleChannel ch, uint32_t fastMs, uint32_t slowMs) {
+    if (ch >= SAMPLE_CHANNEL_COUNT || fastMs < 1000 || fastMs > slowMs) return false;
+    s_fastMs[ch].store(fastMs, std::memory_order_relaxed);
+    s_slowMs[ch].store(slowMs, std::memory_order_relaxed);
+    return true;
+}
+
+void sampleSchedulerBounds(SampleChannel ch, uint32_t *fastMs, uint32_t *slowMs) {
+    *fastMs = s_fastMs[ch].load(std::memory_order_relaxed);
+    *slowMs = s_slowMs[ch].load(std::memory_order_relaxed);
+}
+
+// Interval for the next reading, within the current bounds
+static uint32_t effectiveMs(uint8_t ch, bool pumpOn) {
+    const uint32_t fast = s_fastMs[ch].load(std::memory_order_relaxed);
+    const uint32_t slow = s_slowMs[ch].load(std::memory_order_relaxed);
+    if (pumpOn && SPECS[ch].pumpMoves) return fast;
+
+    const uint32_t ms = s_intervalMs[ch].load(std::memory_order_relaxed);
+    return ms < fast ? fast : (ms > slow ? slow : ms);
+}
+
+// ms until channel ch is due (0 = now)
+static uint32_t remainingMs(uint8_t ch, uint32_t nowMs, bool pumpOn) {
+    if (!(s_seen & (1u << ch))) return 0;
+    const uint32_t elapsed = nowMs - s_lastMs[ch];
+    const uint32_t ms      = effectiveMs(ch, pumpOn);
+    return elapsed >= ms ? 0 : ms - elapsed;
+}
+
+uint8_t sampleSchedulerDue(uint32_t nowMs, bool pumpOn) {
+    uint8_t due = 0;
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        if (remainingMs(i, nowMs, pumpOn) == 0) due |= 1u << i;
+    }
+    if (!due) return 0;
+
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        if (remainingMs(i, nowMs, pumpOn) <= SAMPLE_GROUP_MS) due |= 1u << i;
+    }
+    return due;
+}
+
+uint32_t sampleSchedulerWaitMs(uint32_t nowMs, bool pumpOn) {
+    uint32_t wait = UINT32_MAX;
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        const uint32_t ms = remainingMs(i, nowMs, pumpOn);
+        if (ms < wait) wait = ms;
+    }
+    return wait;
+}
+
+static uint8_t channelValues(uint8_t ch, const SensorData &d, float *out) {
+    switch (ch) {
+        case SAMPLE_TEMP:
+            out[0] = d.temp_val_1;
+            out[1] = d.temp_val_2;
+            return 2;
+        case SAMPLE_ANALOG:
+            out[0] = (float)d.moist_percent_1;
+            out[1] = (float)d.moist_percent_2;
+            out[2] = d.water_level;
+            return 3;
+        case SAMPLE_ULTRASONIC:
+            out[0] = (float)d.ultra_level_percent;
+            return 1;
+        case SAMPLE_TDS:
+            out[0] = d.tds_val;
+            return 1;
+        case SAMPLE_PH:
+            out[0] = d.ph_val;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Largest change of the channel's values in units of its delta; a value
+// appearing or disappearing (NAN) counts as a jump
+static float changeInDeltas(uint8_t ch, const float *now, uint8_t n) {
+    float worst = 0.0f;
+    for (uint8_t i = 0; i < n; i++) {
+        const float prev = s_last[ch][i];
+        if (isnan(prev) != isnan(now[i])) return INFINITY;
+        if (isnan(prev)) continue;
+        const float d = fabsf(now[i] - prev) / SPECS[ch].delta;
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+void sampleSchedulerObserve(uint8_t channels, const SensorData &d, uint32_t nowMs, bool pumpOn) {
+    uint8_t moving = s_moving.load(std::memory_order_relaxed);
+
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        if (!(channels & (1u << i))) continue;
+
+        float values[SAMPLE_VALUES_MAX];
+        const uint8_t n = channelValues(i, d, values);
+
+        const uint32_t fast = s_fastMs[i].load(std::memory_order_relaxed);
+        const uint32_t slow = s_slowMs[i].load(std::memory_order_relaxed);
+        uint32_t ms = effectiveMs(i, false);
+
+        if (s_seen & (1u << i)) {
+            const float change = changeInDeltas(i, values, n);
+            if (change >= 4.0f)      ms = fast;
+            else if (change >= 1.0f) ms = ms / 2;
+            else                     ms = ms > slow / 2 ? slow : ms * 2;
+
+            if (change >= 1.0f) moving |= 1u << i;
+            else                moving &= ~(1u << i);
+        }
+        if (pumpOn && SPECS[i].pumpMoves) ms = fast;
+        ms = ms < fast ? fast : (ms > slow ? slow : ms);
+
+        const uint32_t prevMs = s_intervalMs[i].load(std::memory_order_relaxed);
+        if (ms != prevMs && (ms == fast || ms == slow)) {
+            LOGD("SAMPLE", "%s every %lu ms", SPECS[i].name, (unsigned long)ms);
+        }
+
+        s_intervalMs[i].store(ms, std::memory_order_relaxed);
+        s_readings[i].fetch_add(1, std::memory_order_relaxed);
+        for (uint8_t k = 0; k < n; k++) s_last[i][k] = values[k];
+        s_lastMs[i] = nowMs;
+        s_seen     |= 1u << i;
+    }
+
+    s_moving.store(moving, std::memory_order_relaxed);
+}
+
+uint32_t sampleSchedulerIntervalMs(SampleChannel ch) {
+    return ch < SAMPLE_CHANNEL_COUNT ? s_intervalMs[ch].load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t sampleSchedulerReadings(SampleChannel ch) {
+    return ch < SAMPLE_CHANNEL_COUNT ? s_readings[ch].load(std::memory_order_relaxed) : 0;
+}
+
+uint8_t sampleSchedulerMoving() {
+    return s_moving.load(std::memory_order_relaxed);
+}
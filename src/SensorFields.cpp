@@ -0,0 +1,74 @@
+#include "SensorFields.h"
+#include "Config.h"
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#define SENSOR_FIELD_TYPE(member)                                                   \
+  (std::is_same<decltype(SensorData::member), float>::value ? SENSOR_FIELD_FLOAT    \
+                                                            : SENSOR_FIELD_INT)
+
+// key, live key, dump label, unit, member, decimals, outputs, deadband, deadband %
+#define SENSOR_FIELD(key, liveKey, label, unit, member, precision, outputs, db, dbPct) \
+  { key, liveKey, label, unit, (uint16_t)offsetof(SensorData, member),                 \
+    (uint8_t)SENSOR_FIELD_TYPE(member), precision, outputs, db, dbPct }
+
+#define OUT_ALL    (SENSOR_OUT_HTTP | SENSOR_OUT_RECORD | SENSOR_OUT_LIVE | SENSOR_OUT_DEBUG)
+#define OUT_UPLOAD (SENSOR_OUT_RECORD | SENSOR_OUT_LIVE | SENSOR_OUT_DEBUG)
+
+const SensorField SENSOR_FIELDS[] = {
+  SENSOR_FIELD("temp0",               nullptr,    "Temperature 1", "",     temp_val_1,          2, OUT_ALL,          DEADBAND_TEMP_C,      0),
+  SENSOR_FIELD("temp1",               nullptr,    "Temperature 2", "",     temp_val_2,          2, OUT_ALL,          DEADBAND_TEMP_C,      0),
+  SENSOR_FIELD("moisture1",           nullptr,    "Moisture 1",    "",     moist_percent_1,     0, OUT_ALL,          DEADBAND_MOISTURE,    0),
+  SENSOR_FIELD("moisture2",           nullptr,    "Moisture 2",    "",     moist_percent_2,     0, OUT_ALL,          DEADBAND_MOISTURE,    0),
+  SENSOR_FIELD("water_level",         nullptr,    "Water Level",   "",     water_level,         2, OUT_ALL,          DEADBAND_WATER_LEVEL, 0),
+  SENSOR_FIELD("tds_val",             nullptr,    "TDS Value",     " ppm", tds_val,             2, OUT_UPLOAD,       DEADBAND_TDS_ABS,     DEADBAND_TDS_PCT),
+  SENSOR_FIELD("ph_val",              "ph_level", "PH Value",      "",     ph_val,              2, OUT_UPLOAD,       DEADBAND_PH,          0),
+  SENSOR_FIELD("ultra_distance_cm",   nullptr,    "US Distance",   " cm",  ultra_distance_cm,   2, SENSOR_OUT_DEBUG, 0,                    0),
+  SENSOR_FIELD("ultra_level_percent", nullptr,    "US Level",      " %",   ultra_level_percent, 0, OUT_UPLOAD,       DEADBAND_ULTRA_LEVEL, 0),
+};
+
+const size_t SENSOR_FIELD_COUNT = sizeof(SENSOR_FIELDS) / sizeof(SENSOR_FIELDS[0]);
+static_assert(sizeof(SENSOR_FIELDS) / sizeof(SENSOR_FIELDS[0]) <= SENSOR_FIELD_MAX,
+              "field masks are 16 bits wide");
+
+static int fieldInt(const SensorData &data, const SensorField &field) {
+  int v;
+  memcpy(&v, (const uint8_t *)&data + field.offset, sizeof(v));
+  return v;
+}
+
+float sensorFieldValue(const SensorData &data, const SensorField &field) {
+  if (field.type == SENSOR_FIELD_INT) return (float)fieldInt(data, field);
+  float v;
+  memcpy(&v, (const uint8_t *)&data + field.offset, sizeof(v));
+  return v;
+}
+
+size_t formatSensorField(char *out, size_t len, const SensorData &data, const SensorField &field) {
+  if (field.type == SENSOR_FIELD_FLOAT) {
+    return JsonWriter::formatFloat(out, len, sensorFieldValue(data, field), field.precision);
+  }
+  const int n = snprintf(out, len, "%d", fieldInt(data, field));
+  return (n < 0 || (size_t)n >= len) ? 0 : (size_t)n;
+}
+
+void writeSensorFields(JsonWriter &w, const SensorData &data, uint8_t output, uint16_t mask) {
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    const SensorField &f = SENSOR_FIELDS[i];
+    if (!(f.outputs & output) || !(mask & (1u << i))) continue;
+
+    const char *key = (output == SENSOR_OUT_LIVE && f.liveKey) ? f.liveKey : f.key;
+    if (f.type == SENSOR_FIELD_FLOAT) w.addFloat(key, sensorFieldValue(data, f), f.precision);
+    else w.addInt(key, fieldInt(data, f));
+  }
+}
+
+size_t sensorDataToJson(char *buf, size_t len, const SensorData &data, uint8_t output,
+                        uint16_t mask) {
+  JsonWriter w(buf, len);
+  w.beginObject();
+  writeSensorFields(w, data, output, mask);
+  w.endObject();
+  return w.ok() ? w.length() : 0;
+}
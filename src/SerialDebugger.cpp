@@ -3,29 +3,16 @@
 
 Debugger Debug; // Define global instance
 
-void Debugger::begin(unsigned long baud) {
-    Serial.begin(baud);
-    if (DEBUG_MODE) {
-        while (!Serial) { delay(10); }
-        Serial.println("[DEBUG] Serial initialized");
-    }
-}
-
-void Debugger::print(const String &msg) {
-    if (DEBUG_MODE) Serial.print(msg);
+// Runs on the log task only
+static void serialSink(const char *line, size_t len) {
+    Serial.write((const uint8_t *)line, len);
+    Serial.write((const uint8_t *)"\r\n", 2);
 }
 
-void Debugger::println(const String &msg) {
-    if (DEBUG_MODE) Serial.println(msg);
-}
-
-void Debugger::printf(const char *format, ...) {
-    if (DEBUG_MODE) {
-        char buffer[128];
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
-        va_end(args);
-        Serial.print(buffer);
-    }
+void Debugger::begin(unsigned long baud) {
+    // No waiting on the port: the UART is usable as soon as begin() returns
+    Serial.begin(baud);
+    logAddSink(serialSink);
+    logBegin();
+    LOGI("DEBUG", "serial log at %lu baud, level %d", baud, LOG_LEVEL);
 }
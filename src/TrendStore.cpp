@@ -0,0 +1,276 @@
+#include "TrendStore.h"
+#include <esp_heap_caps.h>
+#include <math.h>
+#include "Config.h"
+#include "HistoryLog.h"
+#include "Log.h"
+
+// Row: header followed by one float (raw) or one TrendStat (rollups) per field
+struct RowHeader {
+    uint32_t t;
+    uint16_t samples;
+    uint16_t reserved;
+};
+
+// Open rollup period, written out as a row once the next period starts
+struct Accumulator {
+    uint32_t start;
+    uint16_t samples;
+    bool     open;
+    float    sum[SENSOR_FIELD_MAX];
+    float    min[SENSOR_FIELD_MAX];
+    float    max[SENSOR_FIELD_MAX];
+    uint16_t count[SENSOR_FIELD_MAX];
+};
+
+struct Tier {
+    uint8_t    *rows;
+    uint32_t    cap;
+    uint32_t    end;     // rows written so far; [end - cap, end) are held
+    uint32_t    stride;
+    uint32_t    period;  // seconds, 0 = raw
+    Accumulator acc;
+};
+
+static const uint32_t TIER_SECONDS[TREND_TIER_COUNT] = { 0, 60, 3600, 86400 };
+static const uint32_t TIER_ROWS[TREND_TIER_COUNT] = {
+    TREND_RAW_SAMPLES, TREND_MINUTE_ROWS, TREND_HOUR_ROWS, TREND_DAY_ROWS
+};
+
+static Tier         s_tiers[TREND_TIER_COUNT];
+static uint32_t     s_rawLast = 0;
+static portMUX_TYPE s_mux     = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t firstHeld(const Tier &t) {
+    return t.end > t.cap ? t.end - t.cap : 0;
+}
+
+static inline uint8_t *rowAt(const Tier &t, uint32_t seq) {
+    return t.rows + (size_t)(seq % t.cap) * t.stride;
+}
+
+uint32_t trendTierSeconds(uint8_t tier) {
+    return tier < TREND_TIER_COUNT ? TIER_SECONDS[tier] : 0;
+}
+
+bool initTrendStore() {
+    bool ok = true;
+    for (uint8_t i = 0; i < TREND_TIER_COUNT; i++) {
+        Tier &t = s_tiers[i];
+        if (t.rows) continue;
+        t.period = TIER_SECONDS[i];
+        t.stride = sizeof(RowHeader) +
+                   SENSOR_FIELD_COUNT * (t.period ? sizeof(TrendStat) : sizeof(float));
+        t.cap  = TIER_ROWS[i];
+        t.rows = (uint8_t *)heap_caps_malloc((size_t)t.cap * t.stride, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!t.rows) {
+            // No PSRAM: a short window of each tier in internal RAM
+            t.cap  = TIER_ROWS[i] / 16 > 8 ? TIER_ROWS[i] / 16 : 8;
+            t.rows = (uint8_t *)malloc((size_t)t.cap * t.stride);
+        }
+        if (!t.rows) {
+            t.cap = 0;
+            ok    = false;
+        }
+    }
+    LOGI("TREND", "rows kept: raw %lu, minute %lu, hour %lu, day %lu",
+         (unsigned long)s_tiers[TREND_RAW].cap, (unsigned long)s_tiers[TREND_MINUTE].cap,
+         (unsigned long)s_tiers[TREND_HOUR].cap, (unsigned long)s_tiers[TREND_DAY].cap);
+    return ok;
+}
+
+// ===== Writing (one task) =====
+static void accReset(Accumulator &a, uint32_t start) {
+    a.start   = start;
+    a.samples = 0;
+    a.open    = true;
+    for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) {
+        a.sum[f]   = 0;
+        a.min[f]   = NAN;
+        a.max[f]   = NAN;
+        a.count[f] = 0;
+    }
+}
+
+static void accStat(const Accumulator &a, size_t f, TrendStat &s) {
+    s.count    = a.count[f];
+    s.mean     = a.count[f] ? a.sum[f] / a.count[f] : NAN;
+    s.min      = a.min[f];
+    s.max      = a.max[f];
+    s.reserved = 0;
+}
+
+// Caller holds s_mux
+static void accClose(Tier &t) {
+    uint8_t   *row = rowAt(t, t.end);
+    RowHeader *h   = (RowHeader *)row;
+    h->t        = t.acc.start;
+    h->samples  = t.acc.samples;
+    h->reserved = 0;
+    TrendStat *stats = (TrendStat *)(row + sizeof(RowHeader));
+    for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) accStat(t.acc, f, stats[f]);
+    t.end++;
+}
+
+static void addRollup(Tier &t, uint32_t timestamp, const float *values) {
+    const uint32_t start = timestamp - timestamp % t.period;
+    if (t.acc.open && start < t.acc.start) return;  // older than the open period
+
+    portENTER_CRITICAL(&s_mux);
+    if (t.acc.open && start != t.acc.start) accClose(t);
+    if (!t.acc.open || start != t.acc.start) accReset(t.acc, start);
+
+    Accumulator &a = t.acc;
+    if (a.samples < UINT16_MAX) a.samples++;
+    for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) {
+        const float v = values[f];
+        if (isnan(v) || a.count[f] == UINT16_MAX) continue;
+        a.sum[f] += v;
+        if (a.count[f] == 0 || v < a.min[f]) a.min[f] = v;
+        if (a.count[f] == 0 || v > a.max[f]) a.max[f] = v;
+        a.count[f]++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void addSample(uint32_t timestamp, const SensorData &data, bool raw) {
+    float values[SENSOR_FIELD_MAX];
+    for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) values[f] = sensorFieldValue(data, SENSOR_FIELDS[f]);
+
+    Tier &r = s_tiers[TREND_RAW];
+    if (raw && r.cap && timestamp > s_rawLast) {
+        portENTER_CRITICAL(&s_mux);
+        uint8_t   *row = rowAt(r, r.end);
+        RowHeader *h   = (RowHeader *)row;
+        h->t        = timestamp;
+        h->samples  = 1;
+        h->reserved = 0;
+        memcpy(row + sizeof(RowHeader), values, SENSOR_FIELD_COUNT * sizeof(float));
+        r.end++;
+        portEXIT_CRITICAL(&s_mux);
+        s_rawLast = timestamp;
+    }
+
+    for (uint8_t i = TREND_MINUTE; i < TREND_TIER_COUNT; i++) {
+        if (s_tiers[i].cap) addRollup(s_tiers[i], timestamp, values);
+    }
+}
+
+void trendStoreAdd(uint32_t timestamp, const SensorData &data) {
+    addSample(timestamp, data, true);
+}
+
+static void onHistoryRecord(uint32_t timestamp, const SensorData &data, void *) {
+    addSample(timestamp, data, false);  // one record a minute: too sparse for the raw tier
+}
+
+void trendStoreSeedFromHistory() {
+    const size_t n = historyLogScan(0, UINT32_MAX, onHistoryRecord, nullptr);
+    LOGI("TREND", "seeded rollups from %u history record(s)", (unsigned)n);
+}
+
+// ===== Reading (any task) =====
+// Row seq of tier as a TrendPoint; seq == end is the open period. False if
+// the row is not held (overwritten, or nothing open).
+static bool readPoint(uint8_t tier, uint32_t seq, TrendPoint &p) {
+    const Tier &t = s_tiers[tier];
+    bool held = false;
+
+    portENTER_CRITICAL(&s_mux);
+    if (seq >= firstHeld(t) && seq < t.end) {
+        const uint8_t   *row = rowAt(t, seq);
+        const RowHeader *h   = (const RowHeader *)row;
+        p.t       = h->t;
+        p.samples = h->samples;
+        if (t.period) {
+            memcpy(p.stat, row + sizeof(RowHeader), SENSOR_FIELD_COUNT * sizeof(TrendStat));
+        } else {
+            const float *v = (const float *)(row + sizeof(RowHeader));
+            for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) {
+                p.stat[f].min = p.stat[f].mean = p.stat[f].max = v[f];
+                p.stat[f].count    = isnan(v[f]) ? 0 : 1;
+                p.stat[f].reserved = 0;
+            }
+        }
+        held = true;
+    } else if (seq == t.end && t.period && t.acc.open) {
+        p.t       = t.acc.start;
+        p.samples = t.acc.samples;
+        for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) accStat(t.acc, f, p.stat[f]);
+        held = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return held;
+}
+
+// Oldest timestamp a tier can still answer for (UINT32_MAX if empty)
+static uint32_t oldestTimestamp(uint8_t tier) {
+    TrendPoint p;
+    const Tier &t = s_tiers[tier];
+    if (!t.cap) return UINT32_MAX;
+    return readPoint(tier, firstHeld(t), p) ? p.t : UINT32_MAX;
+}
+
+void trendStoreQuery(TrendCursor &c, uint32_t from, uint32_t to, uint32_t step) {
+    uint8_t tier = TREND_RAW;
+    while (tier + 1 < TREND_TIER_COUNT && TIER_SECONDS[tier + 1] <= step) tier++;
+
+    // Go coarser while this tier has been overwritten past `from` and the
+    // next one reaches further back
+    while (tier + 1 < TREND_TIER_COUNT && oldestTimestamp(tier) > from &&
+           oldestTimestamp(tier + 1) < oldestTimestamp(tier)) {
+        tier++;
+    }
+
+    c.tier = tier;
+    c.seq  = firstHeld(s_tiers[tier]);
+    c.from = from;
+    c.to   = to;
+    c.step = step > TIER_SECONDS[tier] ? step : TIER_SECONDS[tier];
+    if (c.step == 0) c.step = 1;
+}
+
+static void mergeStat(TrendStat &into, const TrendStat &s) {
+    if (s.count == 0) return;
+    if (into.count == 0) {
+        into = s;
+        return;
+    }
+    const uint32_t n = (uint32_t)into.count + s.count;
+    into.mean  = (into.mean * into.count + s.mean * s.count) / n;
+    into.min   = s.min < into.min ? s.min : into.min;
+    into.max   = s.max > into.max ? s.max : into.max;
+    into.count = n > UINT16_MAX ? UINT16_MAX : (uint16_t)n;
+}
+
+bool trendStoreNext(TrendCursor &c, TrendPoint &out) {
+    if (c.tier >= TREND_TIER_COUNT || !s_tiers[c.tier].cap) return false;
+    const Tier &t = s_tiers[c.tier];
+
+    bool       have = false;
+    TrendPoint p;
+    while (c.seq <= t.end) {
+        if (c.seq < firstHeld(t)) c.seq = firstHeld(t);  // overwritten meanwhile
+        if (!readPoint(c.tier, c.seq, p)) break;
+        if (p.t + (t.period ? t.period - 1 : 0) < c.from) { c.seq++; continue; }  // ends before from
+        if (p.t > c.to) break;
+
+        const uint32_t bucket = p.t - p.t % c.step;
+        if (have && bucket != out.t) return true;  // row belongs to the next point
+
+        if (!have) {
+            out.t       = bucket;
+            out.samples = 0;
+            for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) {
+                out.stat[f].min = out.stat[f].mean = out.stat[f].max = NAN;
+                out.stat[f].count = out.stat[f].reserved = 0;
+            }
+            have = true;
+        }
+        out.samples = (uint32_t)out.samples + p.samples > UINT16_MAX ? UINT16_MAX : out.samples + p.samples;
+        for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) mergeStat(out.stat[f], p.stat[f]);
+        c.seq++;
+    }
+    c.seq = UINT32_MAX;  // done
+    return have;
+}
@@ -0,0 +1,325 @@
+#include "WifiManager.h"
+#include <WiFi.h>
+#include "Globals.h"
+#include "Config.h"
+#include "Log.h"
+#include "BootTrace.h"
+
+enum WifiState : uint8_t {
+    WM_AP_ONLY,     // no usable credentials: provisioning AP only
+    WM_CONNECTING,  // WiFi.begin() issued, waiting for an IP
+    WM_CONNECTED,
+    WM_BACKOFF,     // waiting to retry
+    WM_OFF          // radio powered down (wifiManagerSetRadio)
+};
+
+enum CredSource : uint8_t {
+    CRED_NONE,
+    CRED_SAVED,  // NVS "wifi" namespace
+    CRED_DEBUG   // WIFI_SSID / WIFI_PASSWORD from Config.h
+};
+
+struct Credentials {
+    char ssid[33];
+    char pass[65];
+    bool valid;
+};
+
+static const IPAddress AP_IP(10, 0, 0, 1);
+static const IPAddress AP_MASK(255, 255, 255, 0);
+
+static WifiState   s_state         = WM_AP_ONLY;
+static CredSource  s_source        = CRED_NONE;  // set used by the current / next attempt
+static Credentials s_saved;
+static Credentials s_debug;
+static uint32_t    s_attemptMs     = 0;
+static uint32_t    s_retryAtMs     = 0;
+static uint32_t    s_backoffMs     = WIFI_BACKOFF_MIN_MS;
+static bool        s_apUp          = false;
+static bool        s_everConnected = false;
+static uint32_t    s_reconnects    = 0;
+
+// Set by the WiFi event task, consumed by wifiManagerLoop()
+static volatile bool    s_evGotIp        = false;
+static volatile bool    s_evDisconnected = false;
+static volatile uint8_t s_evReason       = 0;  // wifi_err_reason_t of the last drop
+
+// Provisioning request (written from the HTTP task)
+static portMUX_TYPE            s_joinMux     = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool           s_joinPending = false;
+static volatile WifiJoinResult s_joinResult  = WIFI_JOIN_IDLE;
+static char                    s_joinSsid[33];
+static char                    s_joinPass[65];
+static bool                    s_joining     = false;  // current attempt uses s_join*
+
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            s_evGotIp = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // Our own WiFi.disconnect() before the next attempt, not a failure
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) break;
+            s_evReason       = info.wifi_sta_disconnected.reason;
+            s_evDisconnected = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            s_evReason       = 0;
+            s_evDisconnected = true;
+            break;
+        default:
+            break;
+    }
+}
+
+static bool copyCredentials(char *ssid, char *pass, const char *newSsid, const char *newPass) {
+    if (!newSsid || !newPass || newSsid[0] == '\0' ||
+        strlen(newSsid) >= sizeof(Credentials::ssid) || strlen(newPass) >= sizeof(Credentials::pass)) {
+        return false;
+    }
+    strcpy(ssid, newSsid);
+    strcpy(pass, newPass);
+    return true;
+}
+
+static const Credentials &sourceCredentials(CredSource src) {
+    return src == CRED_DEBUG ? s_debug : s_saved;
+}
+
+// The set to try after src fails: saved and debug take turns when both
+// exist, so a slow router is rejoined without a reboot
+static CredSource otherSource(CredSource src) {
+    if (src == CRED_SAVED && s_debug.valid) return CRED_DEBUG;
+    if (src == CRED_DEBUG && s_saved.valid) return CRED_SAVED;
+    return src;
+}
+
+// ===== Radio actions =====
+static void startAp() {
+    if (s_apUp) return;
+    WiFi.mode(s_source == CRED_NONE ? WIFI_AP : WIFI_AP_STA);
+    WiFi.softAPConfig(AP_IP, AP_IP, AP_MASK);
+    WiFi.softAP(DEVICE_NAME);
+    s_apUp = true;
+    LOGI("WIFI", "provisioning AP \"%s\" up", DEVICE_NAME);
+}
+
+static void startAttempt(const char *ssid, const char *pass) {
+    WiFi.mode(s_apUp ? WIFI_AP_STA : WIFI_STA);
+    s_evGotIp        = false;
+    s_evDisconnected = false;
+    WiFi.begin(ssid, pass);
+    s_attemptMs = millis();
+    s_state     = WM_CONNECTING;
+    LOGI("WIFI", "connecting to %s", ssid);
+}
+
+static void startSourceAttempt() {
+    const Credentials &c = sourceCredentials(s_source);
+    startAttempt(c.ssid, c.pass);
+}
+
+static void scheduleRetry(uint32_t now) {
+    s_retryAtMs = now + s_backoffMs;
+    LOGI("WIFI", "retry in %lu ms", (unsigned long)s_backoffMs);
+    s_backoffMs = s_backoffMs * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : s_backoffMs * 2;
+    s_state     = WM_BACKOFF;
+}
+
+// ===== Transitions =====
+static void onConnected() {
+    s_evGotIp        = false;
+    s_evDisconnected = false;
+
+    const bool joined = s_joining;
+    if (joined) {
+        // New credentials proven: they become the saved set
+        preferences.begin("wifi", false);
+        preferences.putString("ssid", s_joinSsid);
+        preferences.putString("password", s_joinPass);
+        preferences.end();
+        s_saved.valid = copyCredentials(s_saved.ssid, s_saved.pass, s_joinSsid, s_joinPass);
+        s_source      = CRED_SAVED;
+        s_joining     = false;
+        s_joinResult  = WIFI_JOIN_SUCCESS;
+    }
+
+    if (s_everConnected) s_reconnects++;
+    s_everConnected = true;
+    s_backoffMs     = WIFI_BACKOFF_MIN_MS;
+    s_state         = WM_CONNECTED;
+    bootMark(BOOT_WIFI_CONNECTED);
+    LOGI("WIFI", "connected to %s, IP %s",
+         WiFi.SSID().c_str(), WiFi.localIP().toString().c_str());
+
+    // A fallback AP is no longer needed once the saved network is back; after
+    // provisioning the app drops it with /confirm
+    if (!joined && s_apUp) wifiManagerStopAp();
+}
+
+static void onAttemptFailed(uint32_t now) {
+    WiFi.disconnect(false);
+
+    if (s_joining) {
+        s_joining    = false;
+        s_joinResult = WIFI_JOIN_FAILED;
+        LOGW("WIFI", "provisioning join failed");
+        if (s_source == CRED_NONE) {
+            s_state = WM_AP_ONLY;
+        } else {
+            scheduleRetry(now);
+        }
+        return;
+    }
+
+    // Saved network not reachable before the first link: try the debug SSID
+    // straight away. Either way the next retry uses the other set.
+    const CredSource failed = s_source;
+    s_source = otherSource(failed);
+    if (!s_everConnected && failed == CRED_SAVED && s_source == CRED_DEBUG) {
+        startSourceAttempt();
+        return;
+    }
+
+    if (!s_everConnected) startAp();
+    scheduleRetry(now);
+}
+
+static void startJoin() {
+    portENTER_CRITICAL(&s_joinMux);
+    s_joinPending = false;
+    portEXIT_CRITICAL(&s_joinMux);
+
+    s_joining = true;
+    if (s_state == WM_CONNECTED) WiFi.disconnect(false);
+    startAttempt(s_joinSsid, s_joinPass);
+}
+
+// ===== Public =====
+void wifiManagerBegin() {
+    WiFi.persistent(false);       // credentials live in our own NVS namespace
+    WiFi.setAutoReconnect(false); // retries are ours, with backoff
+    WiFi.onEvent(onWifiEvent);
+
+    preferences.begin("wifi", true);
+    const String savedSsid = preferences.getString("ssid", "");
+    const String savedPass = preferences.getString("password", "");
+    preferences.end();
+
+    s_saved.valid = copyCredentials(s_saved.ssid, s_saved.pass, savedSsid.c_str(), savedPass.c_str());
+    s_debug.valid = DEBUG_DEFAULT_WIFI && copyCredentials(s_debug.ssid, s_debug.pass, WIFI_SSID, WIFI_PASSWORD);
+
+    if (s_saved.valid) {
+        s_source = CRED_SAVED;
+    } else if (s_debug.valid) {
+        s_source = CRED_DEBUG;
+    }
+
+    if (s_source == CRED_NONE) {
+        startAp();
+        s_state = WM_AP_ONLY;
+        return;
+    }
+    startSourceAttempt();
+}
+
+void wifiManagerLoop() {
+    const uint32_t now = millis();
+
+    if (s_joinPending) startJoin();
+
+    switch (s_state) {
+        case WM_CONNECTING:
+            if (s_evGotIp) {
+                onConnected();
+            } else if (s_evDisconnected) {
+                // Rejected (wrong password, no such SSID): no point waiting out the timeout
+                LOGW("WIFI", "attempt rejected, reason %u", (unsigned)s_evReason);
+                onAttemptFailed(now);
+            } else if (now - s_attemptMs >= WIFI_CONNECT_TIMEOUT_MS) {
+                onAttemptFailed(now);
+            }
+            break;
+
+        case WM_CONNECTED:
+            if (s_evDisconnected) {
+                s_evDisconnected = false;
+                LOGW("WIFI", "link lost");
+                s_backoffMs = WIFI_BACKOFF_MIN_MS;
+                scheduleRetry(now);
+            }
+            break;
+
+        case WM_BACKOFF:
+            if ((int32_t)(now - s_retryAtMs) >= 0) startSourceAttempt();
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool wifiManagerConnected() {
+    return s_state == WM_CONNECTED;
+}
+
+bool wifiManagerApActive() {
+    return s_apUp;
+}
+
+void wifiManagerStopAp() {
+    if (!s_apUp) return;
+    WiFi.softAPdisconnect(true);
+    s_apUp = false;
+    LOGI("WIFI", "provisioning AP down");
+}
+
+bool wifiManagerJoin(const char *ssid, const char *password) {
+    bool accepted = false;
+    portENTER_CRITICAL(&s_joinMux);
+    if (!s_joinPending && s_joinResult != WIFI_JOIN_CONNECTING &&
+        copyCredentials(s_joinSsid, s_joinPass, ssid, password)) {
+        s_joinPending = true;
+        s_joinResult  = WIFI_JOIN_CONNECTING;
+        accepted      = true;
+    }
+    portEXIT_CRITICAL(&s_joinMux);
+    return accepted;
+}
+
+WifiJoinResult wifiManagerJoinResult() {
+    return s_joinResult;
+}
+
+const char *wifiManagerStateName() {
+    switch (s_state) {
+        case WM_CONNECTING: return "connecting";
+        case WM_CONNECTED:  return "connected";
+        case WM_BACKOFF:    return "backoff";
+        case WM_OFF:        return "off";
+        default:            return "ap";
+    }
+}
+
+void wifiManagerSetRadio(bool on) {
+    if (s_state == WM_AP_ONLY || on == (s_state != WM_OFF)) return;
+
+    if (!on) {
+        WiFi.disconnect(true);
+        WiFi.mode(WIFI_OFF);
+        s_apUp  = false;
+        s_state = WM_OFF;
+        LOGI("WIFI", "radio off");
+        return;
+    }
+    s_backoffMs = WIFI_BACKOFF_MIN_MS;
+    startSourceAttempt();
+}
+
+bool wifiManagerRadioOn() {
+    return s_state != WM_OFF;
+}
+
+uint32_t wifiManagerReconnects() {
+    return s_reconnects;
+}
@@ -3,122 +3,362 @@
 #include <ESPmDNS.h>
 #include "SensorsData.h"  // ✅ Include global sensor struct
 #include "SensorHandler.h"
+#include "SensorFields.h"
 #include "Globals.h"
 #include "Config.h"
-#include "SerialDebugger.h"
-
-WebServer server(80);
+#include "Log.h"
+#include "WifiManager.h"
+#include "BootTrace.h"
+#include "WireCapture.h"
+#include "TrendStore.h"
+#include "LiveEvents.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include "ControlTrace.h"
+
+AsyncWebServer server(80);
 WiFiServer telnetServer(23);
 WiFiClient telnetClient;
 
-IPAddress local_IP(10, 0, 0, 1);
-IPAddress gateway(10, 0, 0, 1);
-IPAddress subnet(255, 255, 255, 0);
+// The log task writes to telnetClient while loop() replaces it
+static SemaphoreHandle_t s_telnetLock = nullptr;
+
+// ===== Deferred jobs =====
+// Request handlers run on the AsyncTCP task and must return at once. Anything
+// that reconfigures the radio is recorded here and carried out from
+// loopWiFiAndServer(); network joins go through WifiManager and the app polls
+// /connect_status.
+static volatile bool     s_confirmPending = false;
+static volatile bool     s_resetPending   = false;
+static volatile uint32_t s_resetAtMs      = 0;
+static bool              s_netServicesUp  = false;
+
+static const char *joinResultName(WifiJoinResult r) {
+    switch (r) {
+        case WIFI_JOIN_CONNECTING: return "connecting";
+        case WIFI_JOIN_SUCCESS:    return "success";
+        case WIFI_JOIN_FAILED:     return "failed";
+        default:                   return "idle";
+    }
+}
+
+// The response outlives the handler, so the body is copied once here
+static void sendJson(AsyncWebServerRequest *request, const JsonWriter &w) {
+    if (!w.ok()) {
+        request->send(500, "text/plain", "response too large");
+        return;
+    }
+    request->send(200, "application/json", w.c_str());
+}
 
-void handlePing() {
-    server.send(200, "text/plain", "");
+// ===== Handlers =====
+void handlePing(AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "");
 }
 
-void handleHandshake() {
-    String json = "{\"device_id\": \"" + String(DEVICE_ID) +
-                  "\", \"device_mdns\": \"" + String(MDNS_HOST) +
-                  "\", \"device_name\": \"" + String(DEVICE_NAME) + "\"}";
-    server.send(200, "application/json", json);
+void handleHandshake(AsyncWebServerRequest *request) {
+    char buf[160];
+    JsonWriter w(buf, sizeof(buf));
+    w.beginObject();
+    w.addString("device_id", DEVICE_ID);
+    w.addString("device_mdns", MDNS_HOST);
+    w.addString("device_name", DEVICE_NAME);
+    w.endObject();
+    sendJson(request, w);
 }
 
-void handleConnectToNetwork() {
-    if (!server.hasArg("ssid") || !server.hasArg("password")) {
-        server.send(400, "text/plain", "Missing ssid or password");
+// Replies "pending" at once; the result is read from /connect_status
+void handleConnectToNetwork(AsyncWebServerRequest *request) {
+    if (!request->hasParam("ssid") || !request->hasParam("password")) {
+        request->send(400, "text/plain", "Missing ssid or password");
         return;
     }
 
-    String ssid = server.arg("ssid");
-    String password = server.arg("password");
-
-    Debug.printf("Connecting to WiFi SSID: %s\n", ssid.c_str());
-    WiFi.mode(WIFI_AP_STA);
-    WiFi.enableAP(true);
-    WiFi.begin(ssid.c_str(), password.c_str());
-
-    int retries = 0;
-    while (WiFi.status() != WL_CONNECTED && retries < 20) {
-        delay(500);
-        Debug.print(".");
-        retries++;
+    const String &ssid     = request->getParam("ssid")->value();
+    const String &password = request->getParam("password")->value();
+    if (ssid.length() == 0) {
+        request->send(400, "text/plain", "Invalid ssid or password");
+        return;
     }
-    Debug.println("");
 
-    if (WiFi.status() == WL_CONNECTED) {
-        Debug.println("WiFi connected successfully.");
-        preferences.begin("wifi", false);
-        preferences.putString("ssid", ssid);
-        preferences.putString("password", password);
-        preferences.end();
-        server.send(200, "text/plain", "success");
+    if (wifiManagerJoinResult() == WIFI_JOIN_CONNECTING) {
+        request->send(409, "text/plain", "busy");
+    } else if (!wifiManagerJoin(ssid.c_str(), password.c_str())) {
+        request->send(400, "text/plain", "Invalid ssid or password");
     } else {
-        Debug.println("WiFi connection failed.");
-        server.send(200, "text/plain", "failed");
+        request->send(202, "text/plain", "pending");
     }
 }
 
-void handleConfirm() {
-    Debug.println("Disabling AP mode...");
-    WiFi.softAPdisconnect(true);
-    server.send(200, "text/plain", "AP disabled");
+void handleConnectStatus(AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", joinResultName(wifiManagerJoinResult()));
+}
+
+void handleConfirm(AsyncWebServerRequest *request) {
+    s_confirmPending = true;
+    request->send(200, "text/plain", "AP disabled");
+}
+
+// Replies first, then clears credentials and restarts once the reply is out
+void handleResetWifi(AsyncWebServerRequest *request) {
+    s_resetAtMs    = millis() + WIFI_RESET_DELAY_MS;
+    s_resetPending = true;
+    request->send(200, "text/plain", "WiFi credentials reset and AP re-enabled");
 }
 
-void handleResetWifi() {
-    preferences.begin("wifi", false);
-    preferences.clear();
-    preferences.end();
+void handleGetData(AsyncWebServerRequest *request) {
+    const SensorData data = getSensorData();
+    char buf[192];
+    JsonWriter w(buf, sizeof(buf));
+    w.beginObject();
+    writeSensorFields(w, data, SENSOR_OUT_HTTP);
+    w.endObject();
+    sendJson(request, w);
+}
+
+void handleBootTrace(AsyncWebServerRequest *request) {
+    char buf[384];
+    JsonWriter w(buf, sizeof(buf));
+    bootTraceJson(w);
+    sendJson(request, w);
+}
+
+// ?enable=0|1 and ?clear=1 act first; the capture is then streamed out as
+// text, one slot per line, without copying the whole ring
+void handleWireCapture(AsyncWebServerRequest *request) {
+#if WIRE_CAPTURE_ENABLED
+    if (request->hasParam("enable")) wireCaptureEnable(request->getParam("enable")->value() == "1");
+    if (request->hasParam("clear"))  wireCaptureClear();
+
+    uint32_t next = wireCaptureFirst();
+    const uint32_t end = wireCaptureEnd();
+    request->send(request->beginChunkedResponse("text/plain",
+            [next, end](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        char  *out = (char *)buf;
+        size_t pos = 0;
+        while (next < end && maxLen - pos > 1) {
+            char line[WIRE_CAPTURE_SNIP * 2 + 40];
+            const size_t n = wireCaptureRender(next, line, sizeof(line));
+            if (n > maxLen - pos) {
+                if (pos) break;  // next chunk
+                memcpy(out, line, maxLen);
+                next++;
+                return maxLen;
+            }
+            memcpy(out + pos, line, n);
+            pos += n;
+            next++;
+        }
+        return pos;
+    }));
+#else
+    request->send(404, "text/plain", "wire capture not built in");
+#endif
+}
+
+// ===== GET /history =====
+// Streamed as it is generated, one TrendPoint per JSON row:
+//   {"from":..,"to":..,"step":60,"rows":[
+//     {"t":1718000000,"n":12,"temp0":{"min":..,"mean":..,"max":..},...},...]}
+struct HistoryStream {
+    TrendCursor cursor;
+    uint16_t    fields;
+    uint8_t     stage;                 // 0 header, 1 rows, 2 done
+    bool        first;
+    uint16_t    len;                   // bytes in pending
+    uint16_t    off;                   // bytes of pending already sent
+    char        pending[SENSOR_FIELD_MAX * 80 + 48];
+};
+
+static void historyRender(HistoryStream &st) {
+    TrendPoint p;
+    st.len = st.off = 0;
+
+    if (st.stage == 0) {
+        const int n = snprintf(st.pending, sizeof(st.pending), "{\"from\":%lu,\"to\":%lu,\"step\":%lu,\"rows\":[",
+                               (unsigned long)st.cursor.from, (unsigned long)st.cursor.to,
+                               (unsigned long)st.cursor.step);
+        st.len   = n > 0 ? (uint16_t)n : 0;
+        st.stage = 1;
+    } else if (st.stage == 1 && trendStoreNext(st.cursor, p)) {
+        const size_t lead = st.first ? 0 : 1;
+        st.pending[0] = ',';
+        JsonWriter w(st.pending + lead, sizeof(st.pending) - lead);
+        w.beginObject();
+        w.addUInt("t", p.t);
+        w.addUInt("n", p.samples);
+        for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+            if (!(st.fields & (1u << i))) continue;
+            const SensorField &f = SENSOR_FIELDS[i];
+            w.beginObject(f.key);
+            w.addFloat("min", p.stat[i].min, f.precision);
+            w.addFloat("mean", p.stat[i].mean, f.precision + 1);
+            w.addFloat("max", p.stat[i].max, f.precision);
+            w.endObject();
+        }
+        w.endObject();
+        if (!w.ok()) return;  // row larger than pending: skipped
+        st.len   = (uint16_t)(lead + w.length());
+        st.first = false;
+    } else if (st.stage == 1) {
+        memcpy(st.pending, "]}", 2);
+        st.len   = 2;
+        st.stage = 2;
+    }
+}
+
+void handleHistory(AsyncWebServerRequest *request) {
+    uint16_t fields = 0;
+    if (request->hasParam("fields")) {
+        // Comma-separated SENSOR_FIELDS keys
+        const String &list = request->getParam("fields")->value();
+        int start = 0;
+        while (start <= (int)list.length()) {
+            int comma = list.indexOf(',', start);
+            if (comma < 0) comma = list.length();
+            const String key = list.substring(start, comma);
+            size_t i = 0;
+            while (i < SENSOR_FIELD_COUNT && key != SENSOR_FIELDS[i].key) i++;
+            if (i == SENSOR_FIELD_COUNT) {
+                request->send(400, "text/plain", "Unknown field");
+                return;
+            }
+            fields |= 1u << i;
+            start = comma + 1;
+        }
+    } else {
+        fields = (1u << SENSOR_FIELD_COUNT) - 1;
+    }
+
+    const time_t now = time(nullptr);
+    uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), nullptr, 10)
+                                          : (now > 1600000000 ? (uint32_t)now : UINT32_MAX);
+    uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), nullptr, 10)
+                                              : (to > TREND_QUERY_SPAN ? to - TREND_QUERY_SPAN : 0);
+    const uint32_t step = request->hasParam("step") ? strtoul(request->getParam("step")->value().c_str(), nullptr, 10) : 0;
+    if (from > to) {
+        request->send(400, "text/plain", "from is after to");
+        return;
+    }
 
-    preferences.begin("config", false);
-    preferences.clear();
-    preferences.end();
+    HistoryStream st;
+    trendStoreQuery(st.cursor, from, to, step);
+    st.fields = fields;
+    st.stage  = 0;
+    st.first  = true;
+    st.len    = 0;
+    st.off    = 0;
+
+    request->send(request->beginChunkedResponse("application/json",
+            [st](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        size_t pos = 0;
+        while (pos < maxLen) {
+            if (st.off == st.len) {
+                if (st.stage == 2) break;
+                historyRender(st);
+                continue;
+            }
+            size_t n = st.len - st.off;
+            if (n > maxLen - pos) n = maxLen - pos;
+            memcpy(buf + pos, st.pending + st.off, n);
+            st.off += n;
+            pos    += n;
+        }
+        return pos;
+    }));
+}
 
-    Debug.println("WiFi credentials cleared.");
-    WiFi.disconnect(true);
-    delay(1000);
+// Prometheus text format, rendered one piece per chunk
+struct MetricsStream {
+    uint16_t item;
+    uint16_t len;
+    uint16_t off;
+    char     pending[METRICS_PIECE_MAX];
+};
+
+void handleMetrics(AsyncWebServerRequest *request) {
+    MetricsStream st;
+    st.item = st.len = st.off = 0;
+
+    request->send(request->beginChunkedResponse("text/plain; version=0.0.4",
+            [st](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        size_t pos = 0;
+        while (pos < maxLen) {
+            if (st.off == st.len) {
+                st.off = 0;
+                st.len = (uint16_t)metricsRender(st.item, st.pending, sizeof(st.pending));
+                if (st.len == 0) break;
+            }
+            size_t n = st.len - st.off;
+            if (n > maxLen - pos) n = maxLen - pos;
+            memcpy(buf + pos, st.pending + st.off, n);
+            st.off += n;
+            pos    += n;
+        }
+        return pos;
+    }));
+}
 
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP("Vermi_Compost_Reset");
-    Debug.println("AP restarted after reset.");
-    server.send(200, "text/plain", "WiFi credentials reset and AP re-enabled");
-    ESP.restart();
+// Control trace segments back to back, as written to flash; decode and
+// replay with tools/control_replay
+void handleControlTrace(AsyncWebServerRequest *request) {
+#if CONTROL_TRACE_ENABLED
+    ControlTraceCursor cursor;
+    controlTraceBegin(cursor);
+    request->send(request->beginChunkedResponse("application/octet-stream",
+            [cursor](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        return controlTraceRead(cursor, buf, maxLen);
+    }));
+#else
+    request->send(404, "text/plain", "control trace not built in");
+#endif
 }
 
-void handleGetData() {
-    String json = "{";
-    json += "\"temp0\":" + String(g_sensorData.temp_val_1, 2) + ",";
-    json += "\"temp1\":" + String(g_sensorData.temp_val_2, 2) + ",";
-    json += "\"moisture1\":" + String(g_sensorData.moist_percent_1) + ",";
-    json += "\"moisture2\":" + String(g_sensorData.moist_percent_2) + ",";
-    json += "\"water_level\":" + String(g_sensorData.water_level);
-    json += "}";
-    server.send(200, "application/json", json);
+#if LOOP_PROFILER
+void handleProfile(AsyncWebServerRequest *request) {
+    char report[(PROF_PHASE_COUNT + 1) * 96];
+    profilerReport(report, sizeof(report));
+    if (request->hasParam("reset")) profilerReset();
+    request->send(200, "text/plain", report);
 }
+#endif
 
-void handleCalibration() {
-    if (!server.hasArg("target")) {
-        server.send(400, "text/plain", "Missing target or value");
+void handleCalibration(AsyncWebServerRequest *request) {
+    if (!request->hasParam("target")) {
+        request->send(400, "text/plain", "Missing target or value");
         return;
     }
 
-    String target = server.arg("target");
-    preferences.begin("config", false);
+    // Own Preferences handle: the global one belongs to the loop() task
+    Preferences prefs;
+    const String &target = request->getParam("target")->value();
+    // Calibration points are raw ADC counts (getMoistureVal()), not the
+    // percentages in the published snapshot
+    const int raw1 = halAnalogMean(HAL_AIN_MOISTURE_1, ADC_MEAN_SAMPLES);
+    const int raw2 = halAnalogMean(HAL_AIN_MOISTURE_2, ADC_MEAN_SAMPLES);
+    prefs.begin("config", false);
 
     if (target == "moisture_dry") {
-        preferences.putInt("valAir1", g_sensorData.moist_percent_1);
-        preferences.putInt("valAir2", g_sensorData.moist_percent_2);
-        valAir1 = g_sensorData.moist_percent_1;
-        valAir2 = g_sensorData.moist_percent_2;
-        server.send(200, "text/plain", "Moisture dry calibrated.");
+        // Dry soil reads higher than wet; anything else would be stored for good
+        if (raw1 <= valWater1 || raw2 <= valWater2) {
+            request->send(409, "text/plain", "Dry reading not above the wet calibration.");
+        } else {
+            prefs.putInt("valAir1", raw1);
+            prefs.putInt("valAir2", raw2);
+            valAir1 = raw1;
+            valAir2 = raw2;
+            request->send(200, "text/plain", "Moisture dry calibrated.");
+        }
     } else if (target == "moisture_wet") {
-        preferences.putInt("valWater1", g_sensorData.moist_percent_1);
-        preferences.putInt("valWater2", g_sensorData.moist_percent_2);
-        valWater1 = g_sensorData.moist_percent_1;
-        valWater2 = g_sensorData.moist_percent_2;
-        server.send(200, "text/plain", "Moisture wet calibrated.");
+        if (raw1 < 0 || raw2 < 0 || raw1 >= valAir1 || raw2 >= valAir2) {
+            request->send(409, "text/plain", "Wet reading not below the dry calibration.");
+        } else {
+            prefs.putInt("valWater1", raw1);
+            prefs.putInt("valWater2", raw2);
+            valWater1 = raw1;
+            valWater2 = raw2;
+            request->send(200, "text/plain", "Moisture wet calibrated.");
+        }
     } 
     // else if (target == "tankempty") {
     //     preferences.putFloat("Tankempty", g_sensorData.water_level);
@@ -134,75 +374,62 @@ void handleCalibration() {
     //     server.send(200, "text/plain", "Tank full calibrated.");
     // } 
     else {
-        server.send(400, "text/plain", "Unknown target.");
+        request->send(400, "text/plain", "Unknown target.");
     }
 
-    preferences.end();
+    prefs.end();
 }
 
-void connectWithSavedCredentials() {
-    preferences.begin("wifi", true);
-    String saved_ssid = preferences.getString("ssid", "");
-    String saved_password = preferences.getString("password", "");
-    preferences.end();
-
-    if (saved_ssid.length() > 0 ) {
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(saved_ssid.c_str(), saved_password.c_str());
-
-        int retries = 0;
-        while (WiFi.status() != WL_CONNECTED && retries < 20) {
-            delay(500);
-            Debug.print(".");
-            retries++;
-        }
-        Debug.println("");
-
-        if (WiFi.status() == WL_CONNECTED) {
-            ArduinoOTA.setPassword("VermiDev1929");
-            ArduinoOTA.begin();
-            telnetServer.begin();
-            telnetServer.setNoDelay(true);
-            return;
-        }
+// ===== Job runners (loop task) =====
+static void runPendingJobs() {
+    if (s_confirmPending) {
+        s_confirmPending = false;
+        LOGI("HTTP", "disabling AP mode");
+        wifiManagerStopAp();
     }
-    if(DEBUG_DEFAULT_WIFI){
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-        Debug.print("Connecting to WiFi SSID: ");
-        Debug.println(WIFI_SSID);
-
-        int retries = 0;
-        while (WiFi.status() != WL_CONNECTED && retries < 20) {
-            delay(500);
-            Debug.print(".");
-            retries++;
-        }
 
-        Debug.println(""); // newline
+    if (s_resetPending && (int32_t)(millis() - s_resetAtMs) >= 0) {
+        s_resetPending = false;
+        preferences.begin("wifi", false);
+        preferences.clear();
+        preferences.end();
 
-        if (WiFi.status() == WL_CONNECTED) {
-            Debug.println("✅ Connected to default WiFi!");
-            Debug.print("IP Address: ");
-            return;
-        } else {
-            Debug.println("❌ Failed to connect to default WiFi.");
-        }
+        preferences.begin("config", false);
+        preferences.clear();
+        preferences.end();
 
+        LOGW("HTTP", "WiFi credentials cleared, restarting");
+        logFlush();
+        WiFi.disconnect(true);
+        ESP.restart();
     }
-    // Fallback to AP mode
+}
 
-    WiFi.mode(WIFI_AP);
-    WiFi.softAPConfig(local_IP, gateway, subnet);
-    WiFi.softAP(DEVICE_NAME);
+// Log sink: runs on the log task, never on the caller of LOGx()
+static void telnetSink(const char *line, size_t len) {
+    if (xSemaphoreTake(s_telnetLock, pdMS_TO_TICKS(5)) != pdTRUE) return;
+    if (telnetClient && telnetClient.connected()) {
+        telnetClient.write((const uint8_t *)line, len);
+        telnetClient.write((const uint8_t *)"\r\n", 2);
+    }
+    xSemaphoreGive(s_telnetLock);
 }
 
-void setupWiFiAndServer() {
-    connectWithSavedCredentials();
+// NTP, OTA and telnet, once the first station link is up
+static void startNetServices() {
+    configTime(8 * 3600, 0, "pool.ntp.org", "time.nist.gov");
+    ArduinoOTA.setPassword("VermiDev1929");
+    ArduinoOTA.begin();
+    telnetServer.begin();
+    telnetServer.setNoDelay(true);
+    s_telnetLock = xSemaphoreCreateMutex();
+    logAddSink(telnetSink);
+    s_netServicesUp = true;
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-        configTime(8 * 3600, 0, "pool.ntp.org", "time.nist.gov");
-    }
+// Returns at once: the network comes up in the background (see WifiManager.h)
+void setupWiFiAndServer() {
+    wifiManagerBegin();
 
     server.on("/handshake", HTTP_GET, handleHandshake);
     server.on("/connect_to_network", HTTP_GET, handleConnectToNetwork);
@@ -211,24 +438,42 @@ void setupWiFiAndServer() {
     server.on("/reset_wifi", HTTP_GET, handleResetWifi);
     server.on("/get_data", HTTP_GET, handleGetData);
     server.on("/ping", HTTP_GET, handlePing);
+    server.on("/connect_status", HTTP_GET, handleConnectStatus);
+    server.on("/boot", HTTP_GET, handleBootTrace);
+    server.on("/wire_capture", HTTP_GET, handleWireCapture);
+    server.on("/history", HTTP_GET, handleHistory);
+    server.on("/metrics", HTTP_GET, handleMetrics);
+    server.on("/trace", HTTP_GET, handleControlTrace);
+#if LOOP_PROFILER
+    server.on("/profile", HTTP_GET, handleProfile);
+#endif
+    initLiveEvents(server);
+    server.onNotFound([](AsyncWebServerRequest *request) {
+        request->send(404, "text/plain", "Not found");
+    });
     server.begin();
 
     if (!MDNS.begin(MDNS_HOST)) {
-        Debug.println("Error starting mDNS");
+        LOGE("HTTP", "mDNS responder failed to start");
     } else {
-        Debug.println("mDNS responder started: http://" + String(MDNS_HOST) + ".local");
+        LOGI("HTTP", "mDNS responder started: http://%s.local", MDNS_HOST);
     }
 }
 
 void loopWiFiAndServer() {
-    if (WiFi.status() == WL_CONNECTED) {
+    wifiManagerLoop();
+
+    if (wifiManagerConnected()) {
+        if (!s_netServicesUp) startNetServices();
         ArduinoOTA.handle();
 
         if (telnetServer.hasClient()) {
             if (!telnetClient || !telnetClient.connected()) {
+                xSemaphoreTake(s_telnetLock, portMAX_DELAY);
                 if (telnetClient) telnetClient.stop();
                 telnetClient = telnetServer.available();
-                Debug.println("New Telnet client");
+                xSemaphoreGive(s_telnetLock);
+                LOGI("TELNET", "client connected");
             } else {
                 WiFiClient newClient = telnetServer.available();
                 newClient.println("Only one client allowed");
@@ -236,5 +481,6 @@ void loopWiFiAndServer() {
             }
         }
     }
-    server.handleClient();
+    liveEventsLoop();
+    runPendingJobs();
 }
@@ -0,0 +1,113 @@
+#include "WireCapture.h"
+#include "Config.h"
+#include "Log.h"
+
+struct WireSlot {
+    uint32_t startMs;
+    uint32_t lastMs;
+    uint32_t total;     // bytes seen, captured or not
+    uint16_t len;       // bytes kept in data
+    uint8_t  client;
+    uint8_t  dir;
+    uint8_t  data[WIRE_CAPTURE_SNIP];
+};
+
+#define WIRE_CAPTURE_CLIENTS 4
+
+volatile bool g_wireCaptureOn = false;
+
+static WireSlot     s_slots[WIRE_CAPTURE_SLOTS];
+static uint32_t     s_end = 0;                        // next sequence to fill
+static uint32_t     s_open[WIRE_CAPTURE_CLIENTS];     // per client: last slot + 1, 0 = none
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t firstHeld() {
+    return s_end > WIRE_CAPTURE_SLOTS ? s_end - WIRE_CAPTURE_SLOTS : 0;
+}
+
+void wireCaptureEnable(bool on) {
+    g_wireCaptureOn = on;
+    LOGI("WIRE", "capture %s", on ? "on" : "off");
+}
+
+void wireCaptureClear() {
+    portENTER_CRITICAL(&s_mux);
+    s_end = 0;
+    memset(s_open, 0, sizeof(s_open));
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void wireCaptureRecord(uint8_t client, WireDir dir, const uint8_t *buf, size_t len) {
+    if (client >= WIRE_CAPTURE_CLIENTS || len == 0) return;
+    const uint32_t now = millis();
+
+    portENTER_CRITICAL(&s_mux);
+    WireSlot *s = nullptr;
+    const uint32_t open = s_open[client];
+    if (open && open - 1 >= firstHeld()) {
+        WireSlot *last = &s_slots[(open - 1) % WIRE_CAPTURE_SLOTS];
+        if (last->dir == dir && now - last->lastMs < WIRE_CAPTURE_GAP_MS) s = last;
+    }
+    if (!s) {
+        s = &s_slots[s_end % WIRE_CAPTURE_SLOTS];
+        s->startMs = now;
+        s->total   = 0;
+        s->len     = 0;
+        s->client  = client;
+        s->dir     = dir;
+        s_open[client] = ++s_end;
+    }
+
+    const size_t room = WIRE_CAPTURE_SNIP - s->len;
+    const size_t n    = len < room ? len : room;
+    memcpy(s->data + s->len, buf, n);
+    s->len   += n;
+    s->total += len;
+    s->lastMs = now;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+uint32_t wireCaptureFirst() {
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t first = firstHeld();
+    portEXIT_CRITICAL(&s_mux);
+    return first;
+}
+
+uint32_t wireCaptureEnd() {
+    return s_end;
+}
+
+size_t wireCaptureRender(uint32_t seq, char *out, size_t max) {
+    if (max == 0) return 0;
+
+    WireSlot s;
+    portENTER_CRITICAL(&s_mux);
+    const bool held = seq >= firstHeld() && seq < s_end;
+    if (held) s = s_slots[seq % WIRE_CAPTURE_SLOTS];
+    portEXIT_CRITICAL(&s_mux);
+    if (!held) return 0;
+
+    int n = snprintf(out, max, "%10lu c%u %c %6luB ", (unsigned long)s.startMs, s.client,
+                     s.dir == WIRE_SEND ? '>' : '<', (unsigned long)s.total);
+    if (n < 0) return 0;
+    size_t pos = (size_t)n < max ? (size_t)n : max - 1;
+
+    // Printable bytes as-is, CR/LF escaped, anything else as '.'
+    for (uint16_t i = 0; i < s.len && pos + 3 < max; i++) {
+        const uint8_t c = s.data[i];
+        if (c == '\r' || c == '\n') {
+            out[pos++] = '\\';
+            out[pos++] = c == '\r' ? 'r' : 'n';
+        } else {
+            out[pos++] = (c >= 0x20 && c < 0x7F) ? (char)c : '.';
+        }
+    }
+    if (s.total > s.len && pos + 4 < max) {
+        memcpy(out + pos, "...", 3);
+        pos += 3;
+    }
+    if (pos + 1 < max) out[pos++] = '\n';
+    out[pos] = '\0';
+    return pos;
+}
@@ -0,0 +1,175 @@
+#include "Hal.h"
+#include <Arduino.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include <soc/gpio_struct.h>
+#include <driver/gpio.h>
+#include "Config.h"
+#include "AdcSampler.h"
+#include "AdsSampler.h"
+#include "MedianFilter.h"
+
+// Pins
+#define MOISTURE_SENSOR_1 32
+#define MOISTURE_SENSOR_2 33
+#define WATER_LEVEL       34
+#define TdsSensorPin      35
+#define ONE_WIRE_BUS      14
+#define ULTRA_TRIG_PIN    5
+#define ULTRA_ECHO_PIN    18
+#define PUMP_RELAY        25
+
+#define PUMP_ON_LEVEL  HIGH
+#define PUMP_OFF_LEVEL LOW
+
+#define TEMP_PROBES_MAX 4
+
+static const uint8_t ANALOG_PINS[HAL_AIN_COUNT] = {
+    MOISTURE_SENSOR_1, MOISTURE_SENSOR_2, WATER_LEVEL, TdsSensorPin
+};
+
+OneWire           oneWire(ONE_WIRE_BUS);
+DallasTemperature sensors(&oneWire);
+
+static DeviceAddress s_tempAddr[TEMP_PROBES_MAX];
+static uint8_t       s_tempCount = 0;
+
+static MedianFilter<int, ADC_MEDIAN_WINDOW> s_tdsFallback;  // used when ADC DMA is unavailable
+
+static void IRAM_ATTR onUltraEcho();
+
+void halSensorsBegin() {
+    for (uint8_t i = 0; i < HAL_AIN_COUNT; i++) pinMode(ANALOG_PINS[i], INPUT);
+    startAdcSampler();
+
+    pinMode(ULTRA_TRIG_PIN, OUTPUT);
+    pinMode(ULTRA_ECHO_PIN, INPUT);      // don't pullup; echo is driven by sensor
+    digitalWrite(ULTRA_TRIG_PIN, LOW);   // keep TRIG low when idle
+    attachInterrupt(digitalPinToInterrupt(ULTRA_ECHO_PIN), onUltraEcho, CHANGE);
+
+    sensors.begin();
+    sensors.setWaitForConversion(false); // conversions are collected by polling
+    startAdsSampler();
+}
+
+// ===== Clock =====
+uint32_t halMillis() {
+    return millis();
+}
+
+uint32_t halMicros() {
+    return micros();
+}
+
+// ===== Analog =====
+// Smoothed from the DMA sampler, or a single analogRead() if it is not running
+int halAnalogMean(HalAnalog ch, uint8_t n) {
+    if (ch >= HAL_AIN_COUNT) return -1;
+    if (adcSamplerRunning()) {
+        const int v = adcSamplerMean((AdcChannel)ch, n);
+        if (v >= 0) return v;
+    }
+    return analogRead(ANALOG_PINS[ch]);
+}
+
+int halAnalogMedian(HalAnalog ch) {
+    if (ch >= HAL_AIN_COUNT) return -1;
+    const int v = adcSamplerRunning() ? adcSamplerMedian((AdcChannel)ch) : -1;
+    if (v >= 0) return v;
+
+    // Fallback (TDS only): one fresh sample per call into the rolling window
+    if (ch != HAL_AIN_TDS) return analogRead(ANALOG_PINS[ch]);
+    s_tdsFallback.push(analogRead(TdsSensorPin));
+    return s_tdsFallback.median();
+}
+
+// ===== Ultrasonic =====
+// The echo pulse is timed by a pin-change interrupt instead of pulseIn(), so a
+// measurement never holds the caller for the full timeout window.
+static volatile uint32_t s_echoRiseUs  = 0;
+static volatile uint32_t s_echoWidthUs = 0;
+static volatile bool     s_echoDone    = false;
+
+static void IRAM_ATTR onUltraEcho() {
+    const uint32_t nowUs = micros();
+    if ((GPIO.in >> ULTRA_ECHO_PIN) & 1) {
+        s_echoRiseUs = nowUs;
+    } else if (s_echoRiseUs != 0 && !s_echoDone) {
+        s_echoWidthUs = nowUs - s_echoRiseUs;
+        s_echoDone    = true;
+    }
+}
+
+void halUltraTrigger() {
+    s_echoRiseUs  = 0;
+    s_echoWidthUs = 0;
+    s_echoDone    = false;
+
+    // Ensure a clean trigger (idle low)
+    digitalWrite(ULTRA_TRIG_PIN, LOW);
+    delayMicroseconds(3);
+
+    // 10 µs trigger pulse
+    digitalWrite(ULTRA_TRIG_PIN, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(ULTRA_TRIG_PIN, LOW);
+}
+
+bool halUltraEcho(uint32_t *widthUs) {
+    if (!s_echoDone) return false;
+    *widthUs = s_echoWidthUs;
+    return true;
+}
+
+// ===== DS18B20 =====
+// ROM codes are discovered here and cached; conversions are addressed by ROM
+// so a cycle never walks the OneWire search tree again.
+uint8_t halTempScan(uint8_t max, uint8_t resolution, uint16_t *convMs) {
+    if (max > TEMP_PROBES_MAX) max = TEMP_PROBES_MAX;
+    uint8_t found = 0;
+    DeviceAddress addr;
+
+    oneWire.reset_search();
+    while (found < max && oneWire.search(addr)) {
+        if (!sensors.validAddress(addr) || !sensors.validFamily(addr)) continue;
+        memcpy(s_tempAddr[found], addr, sizeof(DeviceAddress));
+        sensors.setResolution(s_tempAddr[found], resolution, true);
+        found++;
+    }
+    s_tempCount = found;
+    *convMs     = sensors.millisToWaitForConversion(resolution);
+    return found;
+}
+
+void halTempRequest() {
+    sensors.requestTemperatures();  // returns at once, see halSensorsBegin()
+}
+
+float halTempRead(uint8_t probe) {
+    if (probe >= s_tempCount) return NAN;
+    const float c = sensors.getTempC(s_tempAddr[probe]);
+    return c == DEVICE_DISCONNECTED_C ? NAN : c;
+}
+
+// ===== ADS1115 =====
+float halPhVolts(uint8_t n) {
+    return adsSamplerMeanVolts(n);
+}
+
+// ===== Pump relay =====
+void halPumpInit() {
+    gpio_hold_dis((gpio_num_t)PUMP_RELAY);     // released after a deep-sleep wake
+    pinMode(PUMP_RELAY, OUTPUT);
+    digitalWrite(PUMP_RELAY, PUMP_OFF_LEVEL);  // start OFF
+}
+
+void halPumpWrite(bool on) {
+    digitalWrite(PUMP_RELAY, on ? PUMP_ON_LEVEL : PUMP_OFF_LEVEL);
+}
+
+// The pin would float during deep sleep; the pad hold keeps the OFF level
+void halPumpHoldOff() {
+    digitalWrite(PUMP_RELAY, PUMP_OFF_LEVEL);
+    gpio_hold_en((gpio_num_t)PUMP_RELAY);
+    gpio_deep_sleep_hold_en();
+}
@@ -0,0 +1,146 @@
+#define ENABLE_USER_AUTH
+#define ENABLE_DATABASE
+
+#define FIREBASE_DEBUG_ENABLE 1
+#define FIREBASE_DEBUG_LEVEL 4
+
+#include "Hal.h"
+#include <WiFiClientSecure.h>
+#include <FirebaseClient.h>
+#include "FirebaseHandler.h"
+#include "Metrics.h"
+#include "WifiManager.h"
+#include "WireCapture.h"
+
+// Realtime Database part of Hal.h on FirebaseClient. Everything above the
+// wire (store-and-forward, batching, the control document) is in
+// FirebaseHandler.cpp.
+
+static FirebaseApp      app;
+static RealtimeDatabase Database;
+
+// Two SSL clients & async clients (one for writes, one for stream)
+#if WIRE_CAPTURE_ENABLED
+static CaptureClient ssl_client1(1), ssl_client2(2);
+#else
+static WiFiClientSecure ssl_client1, ssl_client2;
+#endif
+// AsyncClientClass spelled out: AsyncTCP (web server) owns the AsyncClient name
+static AsyncClientClass async_client1(ssl_client1), async_client2(ssl_client2);
+
+static UserAuth *userAuth = nullptr;
+
+// AsyncResult uids by MetricFirebaseTask; metricsFirebaseTask() maps back
+static const char *const TASK_UIDS[METRIC_FB_COUNT] = {
+  "authTask", "RTDB_RealTime", "RTDB_Record", "RTDB_Batch", "RTDB_Int", "controlStream", "RTDB_Other"
+};
+
+static const char *taskUid(uint8_t task) {
+  return TASK_UIDS[task < METRIC_FB_COUNT ? task : METRIC_FB_OTHER];
+}
+
+// ===== Process all Firebase callbacks (writes + stream) =====
+static void processData(AsyncResult &aResult) {
+  if (!aResult.isResult()) return;
+
+  // Resolved once; everything below compares the enum, not the uid string
+  const uint8_t task = metricsFirebaseTask(aResult.uid().c_str());
+
+  if (aResult.isEvent()) {
+    Firebase.printf("Event: %s | Msg: %s | Code: %d\n",
+                    aResult.uid().c_str(),
+                    aResult.eventLog().message().c_str(),
+                    aResult.eventLog().code());
+  }
+
+  if (aResult.isDebug()) {
+    Firebase.printf("Debug: %s | Msg: %s\n",
+                    aResult.uid().c_str(),
+                    aResult.debug().c_str());
+  }
+
+  if (aResult.isError()) {
+    Firebase.printf("Error: %s | Msg: %s | Code: %d\n",
+                    aResult.uid().c_str(),
+                    aResult.error().message().c_str(),
+                    aResult.error().code());
+    if (task == METRIC_FB_STREAM) {
+      firebaseOnStreamError();
+    } else {
+      firebaseOnWriteDone(task, false);
+    }
+    return;
+  }
+
+  if (!aResult.available()) return;
+
+  // Convert to RTDB result (now that we know it's available)
+  RealtimeDatabaseResult &RTDB = aResult.to<RealtimeDatabaseResult>();
+
+  // If this is not a stream (e.g., a write callback), just log payload
+  if (!RTDB.isStream()) {
+    Firebase.printf("Task: %s | Payload: %s\n",
+                    aResult.uid().c_str(), aResult.c_str());
+    firebaseOnWriteDone(task, true);
+    return;
+  }
+
+  // ---- Stream data path/value ----
+  // The payload is handed over in place; event names and data paths are
+  // short enough for String's inline buffer, so nothing here allocates per
+  // event.
+  const String ev   = RTDB.event();     // "put", "patch", ...
+  const String path = RTDB.dataPath();  // e.g. "/" or "/isPump"
+  const char *payload = RTDB.to<const char *>();
+  firebaseOnStreamEvent(ev.c_str(), path.c_str(), payload ? payload : "null");
+}
+
+// ===== Init Firebase (auth + DB URL) =====
+void halRtdbBegin(const char *apiKey, const char *email, const char *password, const char *dbUrl) {
+  // Secure clients (you can replace setInsecure() with proper cert later)
+  ssl_client1.setInsecure();
+  ssl_client2.setInsecure();
+
+  // Reasonable timeouts
+  ssl_client1.setTimeout(1000);
+  ssl_client1.setHandshakeTimeout(5);
+  ssl_client2.setTimeout(1000);
+  ssl_client2.setHandshakeTimeout(5);
+
+  // Auth
+  userAuth = new UserAuth(apiKey, email, password);
+
+  // App + RTDB
+  initializeApp(async_client1, app, getAuth(*userAuth), processData, taskUid(METRIC_FB_AUTH));
+  app.getApp<RealtimeDatabase>(Database);
+  Database.url(dbUrl);
+}
+
+void halRtdbLoop() {
+  // Offline: nothing to service, and TLS connects would only stall loop()
+  if (!wifiManagerConnected()) return;
+  app.loop();
+}
+
+bool halRtdbReady() {
+  return wifiManagerConnected() && app.ready();
+}
+
+void halRtdbSet(uint8_t task, const char *path, const char *json) {
+  Database.set<object_t>(async_client1, path, object_t(json), processData, taskUid(task));
+}
+
+void halRtdbUpdate(uint8_t task, const char *path, const char *json) {
+  Database.update<object_t>(async_client1, path, object_t(json), processData, taskUid(task));
+}
+
+void halRtdbStream(const char *path) {
+  async_client2.setSSEFilters("get,put,patch,keep-alive,cancel,auth_revoked");
+  Database.get(async_client2, path, processData, true /* SSE streaming */,
+               taskUid(METRIC_FB_STREAM));
+}
+
+void halRtdbStop() {
+  async_client1.stopAsync(true);
+  async_client2.stopAsync(true);
+}
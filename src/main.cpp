@@ -5,153 +5,238 @@
 #include "Config.h"
 #include "SerialDebugger.h"
 #include "PumpHandler.h"
+#include "PumpControl.h"
 #include "SensorsData.h"
-
-bool pumpActive = false;
-unsigned long pumpStartTime = 0;
-unsigned long lastPumpOffTime = 0;
-
-unsigned long lastSensorRead = 0;
-const unsigned long sensorReadInterval = 5000;
+#include "HistoryLog.h"
+#include "TrendStore.h"
+#include "ReportFilter.h"
+#include "RecordQueue.h"
+#include "BootTrace.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include "ControlTrace.h"
+#include "ControlDoc.h"
+#include "SampleScheduler.h"
+#include "PowerManager.h"
+
+PumpControl pumpControl = { false, 0, 0, PUMP_REASON_NONE };
 
 unsigned long lastUpload = 0;
 unsigned long lastSendTime = 0;
+unsigned long lastHistoryLog = 0;
+uint32_t lastTrendVersion = 0;
 
-const unsigned long uploadInterval = 60000;
 const unsigned long sendInterval   = 60000;
 
-// Vermi Tea level thresholds (ultrasonic percent full)
-const int VERMITEA_BLOCK_ON_THRESHOLD = 90;  // ≥90% → never turn ON
-const int VERMITEA_RESUME_THRESHOLD   = 85;  // <85% → allow ON again (hysteresis)
-
-SensorData prevReading;
+// Mounting LittleFS (a format on first boot) and loading the spool and
+// history segments is the slowest part of boot, so it runs beside the rest.
+// Uploads, history appends and trend samples wait for BOOT_STORAGE_READY.
+static void storageBootTask(void *) {
+  initRecordQueue();
+  initHistoryLog();
+#if CONTROL_TRACE_ENABLED
+  initControlTrace();
+#endif
+  initTrendStore();
+  trendStoreSeedFromHistory();
+  bootMark(BOOT_STORAGE_READY);
+  vTaskDelete(nullptr);
+}
 
+// Stages that do not depend on each other are started back to back and run
+// concurrently: acquisition on core 0, WiFi association and Firebase auth in
+// their own tasks, storage in storageBootTask. See BootTrace.h for the trace.
 void setup() {
+  bootMark(BOOT_SETUP);
   Debug.begin(115200);
+#if POWER_MODE != 0
+  powerBegin(pumpControl);  // deep sleep: pump cooldown and held readings
+#endif
   initPump();
+  bootMark(BOOT_PUMP_READY);
+
+  // First reading does not wait on the network
+  initSensors();
+  startSensorTask();
+  bootMark(BOOT_SENSORS_READY);
+
+  xTaskCreatePinnedToCore(storageBootTask, "storage", STORAGE_TASK_STACK, nullptr,
+                          1, nullptr, SENSOR_TASK_CORE);
+
+  // A deep-sleep wake that only takes a reading leaves the radio off
+#if POWER_MODE != 0
+  const bool network = powerNetworkAtBoot();
+#else
+  const bool network = true;
+#endif
 
   #if !DEBUG_WIFI_SERVER
+  if (network) {
     setupWiFiAndServer();
+    bootMark(BOOT_NETWORK_STARTED);
+  }
   #endif
 
   #if !DEBUG_FIREBASE
+  if (network) {
     initFirebase(FIREBASE_API_KEY, EMAIL, PASSWORD, FIREBASE_DB_URL);
+    bootMark(BOOT_FIREBASE_STARTED);
+  }
   #endif
 
-  initSensors();
+  bootMark(BOOT_SETUP_DONE);
 }
 
-String getUnixTimeString() {
+// Unix seconds, or 0 while the clock has not been synced yet
+uint32_t getUnixTime() {
   struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return "0";
+  if (!getLocalTime(&timeinfo, 0)) {
+    return 0;
   }
   time_t unixTime = mktime(&timeinfo);
   if (unixTime == -1) {
-    return "0";
+    return 0;
   }
-  return String(unixTime);
+  bootMark(BOOT_TIME_SYNCED);
+  return (uint32_t)unixTime;
 }
 
-void firebaseSenderHandler(unsigned long currentTime) {
-  // Correct, field-by-field equality check
-  if (prevReading.temp_val_1          == g_sensorData.temp_val_1 &&
-      prevReading.temp_val_2          == g_sensorData.temp_val_2 &&
-      prevReading.moist_percent_1     == g_sensorData.moist_percent_1 &&
-      prevReading.moist_percent_2     == g_sensorData.moist_percent_2 &&
-      prevReading.water_level         == g_sensorData.water_level &&
-      prevReading.tds_val             == g_sensorData.tds_val &&
-      prevReading.ph_val              == g_sensorData.ph_val &&
-      prevReading.ultra_level_percent == g_sensorData.ultra_level_percent) {
-    return; // no change → skip upload
-  }
+void firebaseSenderHandler(unsigned long currentTime, const SensorData &data) {
+  if (sensorDataVersion() == 0 || !bootReached(BOOT_STORAGE_READY)) return;
+
+  // Only fields that moved past their deadband (or hit the heartbeat)
+  const uint16_t fields = reportDueFields(data, currentTime);
+  if (fields == 0) return; // nothing changed enough → skip upload
+
+  const uint32_t timestamp = getUnixTime();
+  if (timestamp == 0) return; // no valid time yet → nothing to key the record by
 
-  String currentTimeStamp = getUnixTimeString();
   lastUpload = currentTime;
-  uploadRecordDataToFirebase(currentTimeStamp, g_sensorData);
-  prevReading = g_sensorData;
+  uploadRecordDataToFirebase(timestamp, data, fields);
+  reportCommit(data, fields, currentTime);
 }
 
-void loop() {
-  loopWiFiAndServer();
+#if CONTROL_TRACE_ENABLED
+// Readings and relay changes for tools/control_replay. A relay change the
+// pump rules did not make (RTDB isPump) is recorded as external.
+static void traceControl(unsigned long currentTime, const SensorData &data, bool pumpAuto) {
+  static uint32_t lastVersion = 0;
+  static uint32_t lastChanges = 0;
+
+  const uint32_t version = sensorDataVersion();
+  const uint32_t changes = pumpChangeCount();
+  if (version == lastVersion && changes == lastChanges) return;
+
+  ControlTraceEntry e;
+  e.timestamp = getUnixTime();
+  e.uptimeMs  = currentTime;
+  e.pumpOn    = pumpIsOn();
+  e.data      = data;
+
+  if (changes != lastChanges) {
+    lastChanges = changes;
+    e.event  = pumpAuto ? CTRACE_PUMP_AUTO : CTRACE_PUMP_EXTERNAL;
+    e.reason = pumpAuto ? pumpControl.reason : PUMP_REASON_NONE;
+    controlTraceAppend(e);
+  }
+  if (version != lastVersion) {
+    lastVersion = version;
+    e.event  = CTRACE_READING;
+    e.reason = PUMP_REASON_NONE;
+    controlTraceAppend(e);
+  }
+}
+#endif
 
-  unsigned long currentTime = millis();
+void loop() {
+  static uint32_t lastLoopUs = 0;
+  const uint32_t loopUs = micros();
+  if (lastLoopUs) metricsLoopInterval(loopUs - lastLoopUs);
+  lastLoopUs = loopUs;
+  PROFILE_PHASE(PROF_LOOP);
+
+#if LOOP_PROFILER
+  // 'p' on the serial console dumps the phase histograms
+  while (Serial.available()) {
+    if (Serial.read() == 'p') profilerLog();
+  }
+#endif
 
-  if (currentTime - lastSensorRead >= sensorReadInterval) {
-    lastSensorRead = currentTime;
-    readSensors();
+  {
+    PROFILE_PHASE(PROF_WIFI_SERVER);
+    loopWiFiAndServer();
   }
+  bootTraceReportOnce();
+
+  unsigned long currentTime = millis();
 
   if (setUpComplete) {
-    // Average temperature (simple mean; adjust if you want to ignore NaNs)
-    float avgTemp = (g_sensorData.temp_val_1 + g_sensorData.temp_val_2) / 2.0f;
+    // One consistent snapshot for this iteration (published by the sensor task)
+    uint32_t dataVersion = 0;
+    const SensorData data = getSensorData(&dataVersion);
 
-    // Average moisture from both probes
-    const int avgMoist = getAvgMoisture();
+    {
+      PROFILE_PHASE(PROF_FIREBASE);
+      firebaseLoop();
+    }
 
-    // Ultrasonic (% full) used as Vermi Tea tank level
-    const int vermiTeaLevel = g_sensorData.ultra_level_percent;
+    // Local on-flash history, independent of connectivity
+    if ((lastHistoryLog == 0 || currentTime - lastHistoryLog >= controlHistoryIntervalMs()) &&
+        sensorDataVersion() > 0 && bootReached(BOOT_STORAGE_READY)) {
+      const uint32_t timestamp = getUnixTime();
+      if (timestamp != 0) {
+        PROFILE_PHASE(PROF_HISTORY);
+        lastHistoryLog = currentTime;
+        historyLogAppend(timestamp, data);
+      }
+    }
 
-    firebaseLoop();
+    // Every new reading goes to the local trend store (GET /history)
+    if (sensorDataVersion() != lastTrendVersion && bootReached(BOOT_STORAGE_READY)) {
+      const uint32_t timestamp = getUnixTime();
+      if (timestamp != 0) {
+        PROFILE_PHASE(PROF_TREND);
+        lastTrendVersion = sensorDataVersion();
+        trendStoreAdd(timestamp, data);
+      }
+    }
 
-    if (app.ready() && !DEBUG_FIREBASE) {
-      if (currentTime - lastUpload >= uploadInterval) {
-        firebaseSenderHandler(currentTime);
+    // Runs while offline too: records are queued and caught up later. With
+    // deep sleep, readings go up as batches instead (PowerManager.h).
+    if (!DEBUG_FIREBASE && POWER_MODE != 2) {
+      // Sooner while a sampled channel is moving (SampleScheduler.h); the
+      // report filter still only sends the fields that changed
+      uint32_t uploadMs = controlUploadIntervalMs();
+      if (sampleSchedulerMoving() && uploadMs > UPLOAD_INTERVAL_MOVING) uploadMs = UPLOAD_INTERVAL_MOVING;
+
+      // First record goes out as soon as there is a reading and a clock
+      if (lastUpload == 0 || currentTime - lastUpload >= uploadMs) {
+        PROFILE_PHASE(PROF_UPLOAD);
+        firebaseSenderHandler(currentTime, data);
       }
       // else if (currentTime - lastSendTime >= sendInterval) {
       //   lastSendTime = currentTime;
-      //   uploadDataToFirebase(g_sensorData);
+      //   uploadDataToFirebase(data);
       // }
     }
 
+    bool pumpAuto = false;
     if (!DEBUG_PUMP) {
-      // 1) Safety: if tank water level sensor says empty/invalid, force OFF
-      if (g_sensorData.water_level <= 0) {
-        if (pumpActive) {
-          setPump(0);
-          pumpActive = false;
-          lastPumpOffTime = currentTime;
-          // Debug.println("⚠ Pump OFF: Water level too low");
-        }
-        return; // skip rest of pump logic
-      }
-
-      // 2) Hard block: if Vermi Tea ≥ 90%, ensure pump is OFF and block ON
-      if (vermiTeaLevel >= VERMITEA_BLOCK_ON_THRESHOLD) {
-        if (pumpActive) {
-          setPump(0);
-          pumpActive = false;
-          lastPumpOffTime = currentTime;
-          // Debug.println("⚠ Pump OFF: Vermi Tea ≥ 90%");
-        }
-        return; // do not allow turn ON while ≥90%
-      }
-
-      // 3) Optional hysteresis: only allow ON again when level < 85%
-      if (!pumpActive && vermiTeaLevel > VERMITEA_RESUME_THRESHOLD) {
-        // Still too high to turn ON
-        return;
-      }
-
-      // 4) Normal pump control logic
-      // Turn ON if cooldown elapsed AND (avg moisture low OR temp high)
-      if (!pumpActive && (currentTime - lastPumpOffTime >= PUMP_COOLDOWN)) {
-        if (avgMoist < 60 || avgTemp > 30.0f) {
-          setPump(1);
-          pumpStartTime = currentTime;
-          pumpActive = true;
-          // Debug.println("Pump ON: Avg moisture low or temp high");
-        }
-      }
+      PROFILE_PHASE(PROF_PUMP);
+      pumpAuto = pumpControlStep(pumpControl, data, currentTime);
+      if (pumpAuto) setPump(pumpControl.active);
+    }
 
-      // Turn OFF if duration elapsed OR avg moisture restored
-      if (pumpActive &&
-          ((currentTime - pumpStartTime >= PUMP_DURATION) || (avgMoist > 80))) {
-        setPump(0);
-        pumpActive = false;
-        lastPumpOffTime = currentTime;
-        // Debug.println("Pump OFF: Avg moisture restored or duration ended");
-      }
+#if CONTROL_TRACE_ENABLED
+    if (sensorDataVersion() > 0 && bootReached(BOOT_STORAGE_READY)) {
+      traceControl(currentTime, data, pumpAuto);
     }
+#endif
+
+#if POWER_MODE != 0
+    // Last: may sleep until the next reading or radio window. Gets the
+    // snapshot the pump rules just ran on, not whatever was published since.
+    powerLoop(pumpControl, controlUploadIntervalMs(), data, dataVersion);
+#endif
   }
 }
@@ -0,0 +1,241 @@
+#include "Sim.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <string.h>
+#include "Hal.h"
+#include "FirebaseHandler.h"
+
+// Realtime Database part of Hal.h on the host: an in-memory path -> JSON
+// store. Writes complete after the simulated latency, from inside
+// halRtdbLoop(), and only while online; results and stream events reach
+// FirebaseHandler.cpp through the same hooks FirebaseClient drives on the
+// board.
+
+struct FakeWrite {
+    uint8_t     task;
+    bool        merge;
+    bool        fail;
+    uint32_t    dueMs;
+    std::string path;
+    std::string json;
+};
+
+struct FakeEvent {
+    bool        error;
+    std::string event;
+    std::string path;
+    std::string json;
+};
+
+static std::map<std::string, std::string> s_docs;
+static std::deque<FakeWrite>              s_writes;
+static std::deque<FakeEvent>              s_events;
+static std::string                        s_streamPath;
+static bool                               s_begun     = false;
+static bool                               s_online    = true;
+static bool                               s_streamOn  = false;
+static uint32_t                           s_latencyMs = 0;
+static uint32_t                           s_failNext  = 0;
+static FakeRtdbStats                      s_stats;
+
+// Firmware paths come with and without the leading slash
+static std::string normPath(const char *path) {
+    while (*path == '/') path++;
+    std::string p(path);
+    while (!p.empty() && p.back() == '/') p.pop_back();
+    return p;
+}
+
+static void store(const std::string &path, const char *json, size_t len) {
+    s_docs[path].assign(json, len);
+}
+
+// Top-level members of an object become children of path (a multi-path
+// update); anything else replaces the node
+static void merge(const std::string &path, const std::string &json) {
+    const char *p   = json.c_str();
+    const char *end = p + json.size();
+    while (p < end && *p != '{') p++;
+    if (p == end) {
+        store(path, json.c_str(), json.size());
+        return;
+    }
+    p++;
+
+    while (p < end) {
+        while (p < end && *p != '"' && *p != '}') p++;
+        if (p >= end || *p == '}') return;
+        const char *keyStart = ++p;
+        while (p < end && *p != '"') p++;
+        const std::string key(keyStart, p - keyStart);
+        while (p < end && *p != ':') p++;
+        const char *val = ++p;
+
+        // Value runs to the comma or brace at depth 0, skipping strings
+        int  depth    = 0;
+        bool inString = false;
+        for (; p < end; p++) {
+            if (inString) {
+                if (*p == '\\') p++;
+                else if (*p == '"') inString = false;
+            } else if (*p == '"') {
+                inString = true;
+            } else if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                if (depth == 0) break;
+                depth--;
+            } else if (*p == ',' && depth == 0) {
+                break;
+            }
+        }
+        const char *valEnd = p;
+        while (val < valEnd && *val == ' ') val++;
+        store(path + "/" + key, val, valEnd - val);
+        if (p < end && *p == ',') p++;
+    }
+}
+
+static void queueWrite(uint8_t task, const char *path, const char *json, bool isMerge) {
+    FakeWrite w;
+    w.task  = task;
+    w.merge = isMerge;
+    w.fail  = s_failNext > 0;
+    w.dueMs = halMillis() + s_latencyMs;
+    w.path  = normPath(path);
+    w.json  = json;
+    if (s_failNext) s_failNext--;
+    s_writes.push_back(w);
+}
+
+// ===== Hal.h =====
+void halRtdbBegin(const char *, const char *, const char *, const char *) {
+    s_begun = true;
+}
+
+void halRtdbLoop() {
+    if (!s_online) return;
+
+    // Hooks may issue the next write or reopen the stream: take each item
+    // off its queue before calling out
+    while (!s_writes.empty() && (int32_t)(halMillis() - s_writes.front().dueMs) >= 0) {
+        const FakeWrite w = s_writes.front();
+        s_writes.pop_front();
+        if (!w.fail) {
+            if (w.merge) merge(w.path, w.json);
+            else store(w.path, w.json.c_str(), w.json.size());
+            s_stats.writes++;
+            s_stats.bytes += w.json.size();
+        } else {
+            s_stats.failed++;
+        }
+        firebaseOnWriteDone(w.task, !w.fail);
+    }
+
+    while (s_streamOn && !s_events.empty()) {
+        const FakeEvent e = s_events.front();
+        s_events.pop_front();
+        if (e.error) {
+            s_streamOn = false;
+            s_events.clear();
+            firebaseOnStreamError();
+            return;
+        }
+        firebaseOnStreamEvent(e.event.c_str(), e.path.c_str(), e.json.c_str());
+    }
+}
+
+bool halRtdbReady() {
+    return s_begun && s_online;
+}
+
+void halRtdbSet(uint8_t task, const char *path, const char *json) {
+    queueWrite(task, path, json, false);
+}
+
+void halRtdbUpdate(uint8_t task, const char *path, const char *json) {
+    queueWrite(task, path, json, true);
+}
+
+void halRtdbStream(const char *path) {
+    s_streamPath = normPath(path);
+    s_streamOn   = true;
+    s_events.clear();
+    s_stats.streams++;
+
+    // Like the RTDB, a new stream starts with the whole document
+    const char *doc = fakeRtdbGet(s_streamPath.c_str());
+    s_events.push_back({ false, "put", "/", doc ? doc : "null" });
+}
+
+void halRtdbStop() {
+    s_writes.clear();
+    s_events.clear();
+    s_streamOn = false;
+}
+
+// ===== Sim.h =====
+void fakeRtdbReset() {
+    s_docs.clear();
+    s_writes.clear();
+    s_events.clear();
+    s_streamPath.clear();
+    s_begun     = false;
+    s_online    = true;
+    s_streamOn  = false;
+    s_latencyMs = 0;
+    s_failNext  = 0;
+    s_stats     = FakeRtdbStats();
+}
+
+void fakeRtdbSetOnline(bool online) {
+    s_online = online;
+}
+
+void fakeRtdbSetLatency(uint32_t ms) {
+    s_latencyMs = ms;
+}
+
+void fakeRtdbFailWrites(uint32_t n) {
+    s_failNext = n;
+}
+
+size_t fakeRtdbInFlight() {
+    return s_writes.size();
+}
+
+bool fakeRtdbStreamOpen() {
+    return s_streamOn;
+}
+
+void fakeRtdbStreamPush(const char *event, const char *path, const char *json) {
+    if (s_streamOn) s_events.push_back({ false, event, path, json });
+}
+
+void fakeRtdbStreamFail() {
+    if (s_streamOn) s_events.push_back({ true, "", "", "" });
+}
+
+void fakeRtdbPut(const char *path, const char *json) {
+    store(normPath(path), json, strlen(json));
+}
+
+size_t fakeRtdbCount(const char *prefix) {
+    const std::string p = normPath(prefix);
+    size_t n = 0;
+    for (auto it = s_docs.lower_bound(p); it != s_docs.end(); ++it) {
+        if (it->first.compare(0, p.size(), p) != 0) break;
+        if (it->first.size() > p.size() && it->first[p.size()] == '/') n++;
+    }
+    return n;
+}
+
+const char *fakeRtdbGet(const char *path) {
+    const auto it = s_docs.find(normPath(path));
+    return it == s_docs.end() ? nullptr : it->second.c_str();
+}
+
+const FakeRtdbStats &fakeRtdbStats() {
+    return s_stats;
+}
@@ -0,0 +1,182 @@
+#include "Hal.h"
+#include <math.h>
+#include "Config.h"
+#include "Sim.h"
+
+// Hal.h on the host. Raw values are produced the way the board sees them
+// (12-bit counts, echo widths, volts) from the state in g_sim, so the
+// conversions and calibration in Acquisition.cpp run unchanged.
+
+SimWorld g_sim;
+SimStats g_simStats;
+
+static uint64_t s_nowUs = 0;
+static uint32_t s_rng   = 1;
+
+// Small deterministic LCG, so runs are repeatable for a given seed
+static float noise(float amplitude) {
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return ((s_rng >> 8) / 16777216.0f * 2.0f - 1.0f) * amplitude;
+}
+
+static bool chance(uint32_t oneIn) {
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (s_rng >> 8) % oneIn == 0;
+}
+
+void simReset(uint32_t seed) {
+    s_nowUs = 0;
+    s_rng   = seed ? seed : 1;
+    g_sim   = { 55.0f, 26.0f, 100.0f, 20.0f, 800.0f, 7.2f, false, true };
+    g_simStats = SimStats();
+}
+
+uint64_t simNowMs() {
+    return s_nowUs / 1000;
+}
+
+void simAdvance(uint32_t ms) {
+    s_nowUs += (uint64_t)ms * 1000;
+    const float dt    = ms / 1000.0f;
+    const float hours = s_nowUs / 3.6e9f;
+
+    // Bed warms in the afternoon and dries faster while it is warm
+    const float ambient = 27.0f + 5.0f * sinf((hours - 9.0f) * (float)M_PI / 12.0f);
+    g_sim.bedTempC    += (ambient - g_sim.bedTempC) * dt / 1800.0f;
+    g_sim.bedMoisture -= dt * (0.0015f + 0.0002f * fmaxf(g_sim.bedTempC - 25.0f, 0.0f));
+
+    if (g_sim.pumpOn && g_sim.reservoirPct > 0.0f) {
+        g_sim.bedMoisture  += dt * 0.5f;
+        g_sim.bedTempC     -= dt * 0.02f;
+        g_sim.reservoirPct -= dt * 0.05f;
+        g_sim.teaPct       += dt * 0.03f;
+        g_sim.tdsUs        += dt * 0.5f;
+        g_simStats.pumpOnMs += ms;
+    }
+    g_sim.tdsUs -= dt * 0.002f;
+
+    if (g_sim.bedMoisture < 0.0f)   g_sim.bedMoisture = 0.0f;
+    if (g_sim.bedMoisture > 100.0f) g_sim.bedMoisture = 100.0f;
+    if (g_sim.reservoirPct < 0.0f)  g_sim.reservoirPct = 0.0f;
+
+    // Reservoir topped up once it runs dry, tea tank emptied when nearly full
+    if (g_sim.reservoirPct <= 0.0f && chance(3600)) {
+        g_sim.reservoirPct = 100.0f;
+        g_simStats.reservoirRefills++;
+    }
+    if (g_sim.teaPct >= 95.0f) {
+        g_sim.teaPct = 10.0f;
+        g_simStats.teaDrains++;
+    }
+}
+
+void halSensorsBegin() {}
+
+// ===== Clock =====
+uint32_t halMillis() {
+    return (uint32_t)(s_nowUs / 1000);
+}
+
+uint32_t halMicros() {
+    return (uint32_t)s_nowUs;
+}
+
+// ===== Analog =====
+// Same calibration points as the defaults in Acquisition.cpp
+static int clampRaw(float v) {
+    return v < 0.0f ? 0 : (v > 4095.0f ? 4095 : (int)v);
+}
+
+static int analogRaw(HalAnalog ch) {
+    switch (ch) {
+        case HAL_AIN_MOISTURE_1:
+        case HAL_AIN_MOISTURE_2: {
+            const float m = g_sim.bedMoisture + (ch == HAL_AIN_MOISTURE_2 ? 3.0f : 0.0f);
+            return clampRaw(3018.0f - (3018.0f - 1710.0f) * m / 100.0f + noise(20.0f));
+        }
+        case HAL_AIN_WATER_LEVEL:
+            return clampRaw(g_sim.reservoirPct * 2460.0f / 100.0f + noise(10.0f));
+        case HAL_AIN_TDS: {
+            const float volts = 0.55f + (g_sim.tdsUs - 84.0f) * (1.81f - 0.55f) / (1413.0f - 84.0f);
+            return clampRaw(volts * 4095.0f / 3.3f + noise(8.0f));
+        }
+        default:
+            return -1;
+    }
+}
+
+int halAnalogMean(HalAnalog ch, uint8_t /*n*/) {
+    return analogRaw(ch);
+}
+
+int halAnalogMedian(HalAnalog ch) {
+    return analogRaw(ch);
+}
+
+// ===== Ultrasonic =====
+// Tank geometry matches ULTRA_EMPTY_CM / ULTRA_FULL_CM (14 cm .. 4 cm)
+static uint64_t s_echoAtUs  = 0;
+static uint32_t s_echoWidth = 0;
+
+void halUltraTrigger() {
+    if (chance(200)) {
+        s_echoAtUs = UINT64_MAX;  // lost echo
+        g_simStats.echoTimeouts++;
+        return;
+    }
+    const float cm = 14.0f - 10.0f * g_sim.teaPct / 100.0f + noise(0.2f);
+    s_echoWidth = (uint32_t)(cm * 58.0f);
+    s_echoAtUs  = s_nowUs + s_echoWidth;
+}
+
+bool halUltraEcho(uint32_t *widthUs) {
+    if (s_nowUs < s_echoAtUs) return false;
+    *widthUs = s_echoWidth;
+    return true;
+}
+
+// ===== DS18B20 =====
+static uint8_t s_tempCount = 0;
+
+uint8_t halTempScan(uint8_t max, uint8_t resolution, uint16_t *convMs) {
+    const uint8_t present = g_sim.probe2Present ? 2 : 1;
+    s_tempCount = present < max ? present : max;
+    *convMs     = (uint16_t)(94u << (resolution - 9));
+    return s_tempCount;
+}
+
+void halTempRequest() {
+    // Probe 2 drops off the bus now and then and comes back a while later
+    if (g_sim.probe2Present && chance(2000)) {
+        g_sim.probe2Present = false;
+        g_simStats.probeDropouts++;
+    } else if (!g_sim.probe2Present && chance(30)) {
+        g_sim.probe2Present = true;
+    }
+}
+
+float halTempRead(uint8_t probe) {
+    if (probe >= s_tempCount) return NAN;
+    if (probe == 1 && !g_sim.probe2Present) return NAN;
+    return roundf((g_sim.bedTempC + (probe ? 0.4f : 0.0f) + noise(0.1f)) * 16.0f) / 16.0f;
+}
+
+// ===== ADS1115 =====
+float halPhVolts(uint8_t /*n*/) {
+    // Inverse of voltageToPH() in Acquisition.cpp
+    const float step = (2.20f - 2.46f) / (9.18f - 6.86f);
+    return (g_sim.ph - 6.86f) * step + 2.46f + noise(0.002f);
+}
+
+// ===== Pump relay =====
+void halPumpInit() {
+    g_sim.pumpOn = false;
+}
+
+void halPumpWrite(bool on) {
+    g_sim.pumpOn = on;
+}
+
+void halPumpHoldOff() {
+    g_sim.pumpOn = false;
+}
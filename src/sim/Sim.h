@@ -0,0 +1,70 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host-side world behind HalSim.cpp, driven by SimMain.cpp ([env:native]).
+//
+// The clock only moves when simAdvance() is called, so a day of operation
+// runs in well under a second. The bed dries out and warms up over the day,
+// the pump wets it and moves water from the reservoir into the vermi tea
+// tank, and the second DS18B20 drops off the bus now and then.
+
+struct SimWorld {
+    float bedMoisture;    // % (0 = dry, 100 = soaked)
+    float bedTempC;
+    float reservoirPct;   // tank feeding the pump
+    float teaPct;         // vermi tea tank under the ultrasonic sensor
+    float tdsUs;          // µS/cm
+    float ph;
+    bool  pumpOn;
+    bool  probe2Present;
+};
+
+extern SimWorld g_sim;
+
+void     simReset(uint32_t seed);
+void     simAdvance(uint32_t ms);  // moves the clock and the world
+uint64_t simNowMs();
+
+// Counters for the run summary
+struct SimStats {
+    uint32_t echoTimeouts;
+    uint32_t probeDropouts;
+    uint32_t reservoirRefills;
+    uint32_t teaDrains;
+    uint32_t pumpOnMs;
+};
+extern SimStats g_simStats;
+
+extern bool     g_simVerbose;     // log lines on stderr (SimStubs.cpp)
+extern uint32_t g_simCycles;      // acquisition cycles published
+extern uint32_t g_simCycleMaxUs;  // longest cycle, simulated time
+
+// ===== Fake Realtime Database =====
+// The RTDB calls in Hal.h on an in-memory path -> JSON store (FakeRtdb.cpp),
+// driven through FirebaseHandler.cpp like FirebaseClient on the board.
+// Multi-path updates land as one document per child, so records uploaded
+// live and in catch-up batches read back the same way.
+struct FakeRtdbStats {
+    uint32_t writes;   // set / update requests applied
+    uint32_t failed;   // writes answered with an error
+    uint32_t streams;  // control stream (re)opened
+    uint64_t bytes;    // payload bytes of the applied writes
+};
+
+void     fakeRtdbReset();
+void     fakeRtdbSetOnline(bool online);      // offline: not ready, nothing completes
+void     fakeRtdbSetLatency(uint32_t ms);     // write -> result, simulated time
+void     fakeRtdbFailWrites(uint32_t n);      // the next n writes fail
+size_t   fakeRtdbInFlight();
+bool     fakeRtdbStreamOpen();
+void     fakeRtdbStreamPush(const char *event, const char *path, const char *json);
+void     fakeRtdbStreamFail();                // the stream errors out on the next loop
+void     fakeRtdbPut(const char *path, const char *json);  // seeds a document directly
+size_t   fakeRtdbCount(const char *prefix);   // documents under prefix
+const char *fakeRtdbGet(const char *path);    // nullptr if absent
+const FakeRtdbStats &fakeRtdbStats();
+
+#endif
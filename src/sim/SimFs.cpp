@@ -0,0 +1,136 @@
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <map>
+#include <string.h>
+
+// In-memory flash for the shims in src/sim/shim ([env:native])
+
+// ===== LittleFS =====
+SimFS LittleFS;
+
+static std::map<std::string, std::vector<uint8_t>> s_files;
+
+size_t File::write(const uint8_t *buf, size_t size) {
+    if (!data_) return 0;
+    if (pos_ + size > data_->size()) data_->resize(pos_ + size);
+    memcpy(data_->data() + pos_, buf, size);
+    pos_ += size;
+    return size;
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+    if (!data_ || pos_ >= data_->size()) return 0;
+    if (size > data_->size() - pos_) size = data_->size() - pos_;
+    memcpy(buf, data_->data() + pos_, size);
+    pos_ += size;
+    return size;
+}
+
+bool File::seek(uint32_t pos) {
+    if (!data_ || pos > data_->size()) return false;
+    pos_ = pos;
+    return true;
+}
+
+bool SimFS::begin(bool /*formatOnFail*/) {
+    return true;
+}
+
+File SimFS::open(const char *path, const char *mode) {
+    const auto it = s_files.find(path);
+    if (mode[0] == 'r') return it == s_files.end() ? File() : File(&it->second, false);
+
+    std::vector<uint8_t> &data = s_files[path];
+    if (mode[0] == 'w') data.clear();
+    return File(&data, mode[0] == 'a');
+}
+
+bool SimFS::exists(const char *path) {
+    return s_files.count(path) != 0;
+}
+
+bool SimFS::remove(const char *path) {
+    return s_files.erase(path) != 0;
+}
+
+bool SimFS::rename(const char *from, const char *to) {
+    const auto it = s_files.find(from);
+    if (it == s_files.end()) return false;
+    std::vector<uint8_t> data;
+    data.swap(it->second);
+    s_files.erase(it);
+    s_files[to].swap(data);
+    return true;
+}
+
+std::vector<uint8_t> &SimFS::data(const char *path) {
+    return s_files[path];
+}
+
+void SimFS::format() {
+    s_files.clear();
+}
+
+// ===== Preferences =====
+static std::map<std::string, double> s_prefs;  // "<namespace>/<key>"
+
+static std::string prefKey(const char *ns, const char *key) {
+    return std::string(ns) + "/" + key;
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+    strncpy(name_, name, sizeof(name_) - 1);
+    open_     = true;
+    readOnly_ = readOnly;
+    return true;
+}
+
+void Preferences::end() {
+    open_ = false;
+}
+
+bool Preferences::find(const char *key, double *out) const {
+    if (!open_) return false;
+    const auto it = s_prefs.find(prefKey(name_, key));
+    if (it == s_prefs.end()) return false;
+    *out = it->second;
+    return true;
+}
+
+void Preferences::store(const char *key, double value) {
+    if (open_ && !readOnly_) s_prefs[prefKey(name_, key)] = value;
+}
+
+int32_t Preferences::getInt(const char *key, int32_t defaultValue) {
+    double v;
+    return find(key, &v) ? (int32_t)v : defaultValue;
+}
+
+size_t Preferences::putInt(const char *key, int32_t value) {
+    store(key, value);
+    return sizeof(value);
+}
+
+float Preferences::getFloat(const char *key, float defaultValue) {
+    double v;
+    return find(key, &v) ? (float)v : defaultValue;
+}
+
+size_t Preferences::putFloat(const char *key, float value) {
+    store(key, value);
+    return sizeof(value);
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue) {
+    double v;
+    return find(key, &v) ? v != 0.0 : defaultValue;
+}
+
+size_t Preferences::putBool(const char *key, bool value) {
+    store(key, value ? 1.0 : 0.0);
+    return 1;
+}
+
+void simPreferencesClear() {
+    s_prefs.clear();
+}
@@ -0,0 +1,344 @@
+// Host simulation of the acquisition and pump-control loop ([env:native]).
+//
+//   pio run -e native && .pio/build/native/program [hours] [seed] [-v] [--fixed]
+//       [--power light|deep] [--trace FILE]
+//
+// or without PlatformIO, from the repository root (one command):
+//
+//   g++ -std=gnu++17 -O2 -Iinclude -Ilib/JsonWriter -Ilib/JsonStream
+//       -Ilib/TsLog -Isrc/sim -Isrc/sim/shim
+//       src/Acquisition.cpp src/PumpControl.cpp src/PumpHandler.cpp
+//       src/SensorFields.cpp src/ReportFilter.cpp src/SampleScheduler.cpp
+//       src/PowerPlan.cpp src/FirebaseHandler.cpp src/RecordQueue.cpp
+//       src/ControlDoc.cpp lib/JsonWriter/JsonWriter.cpp
+//       lib/JsonStream/JsonStream.cpp lib/TsLog/TsLog.cpp src/sim/*.cpp
+//       -o vermi_sim
+//
+// Runs the same code the sensor task and loop() run on the board against
+// simulated sensors (HalSim.cpp): acquisition cycles over the channels
+// SampleScheduler.h finds due, pump rules on every loop, history records
+// through report-by-exception and FirebaseHandler.cpp (live writes, the
+// RecordQueue catch-up batches, the control stream) into the fake RTDB
+// behind Hal.h, answering after SIM_RTDB_LATENCY_MS. Prints a summary and how fast
+// the simulation ran. Exits 1 if the pump was ever on while the reservoir read
+// empty or the vermi tea tank read full.
+//
+// --fixed reads every channel every SENSOR_READ_INTERVAL, for comparing the
+// reading and upload counts against adaptive sampling.
+//
+// --power light|deep runs the POWER_MODE 1 / 2 plan (PowerPlan.h): the loop
+// sleeps where the board would, records wait in RecordQueue for a radio
+// window (link up SIM_CONNECT_MS after the radio comes on), and a deep-sleep
+// wake loses the RAM state (scheduler, queue ring after its flush) but keeps
+// the held readings, their report filter state and the pump state.
+// Sleeping with the pump on counts as a rule break.
+//
+// --trace FILE also writes the control trace the device would record
+// (ControlTrace.h), as one segment, for tools/control_replay.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Config.h"
+#include "SensorHandler.h"
+#include "SensorFields.h"
+#include "ReportFilter.h"
+#include "PumpHandler.h"
+#include "PumpControl.h"
+#include "SampleScheduler.h"
+#include "PowerPlan.h"
+#include "FirebaseHandler.h"
+#include "RecordQueue.h"
+#include "BootTrace.h"
+#include "Sim.h"
+#include <TsLogControl.h>
+
+#define SIM_TICK_MS        SENSOR_POLL_MS    // one pollSensors() / loop() per tick
+#define SIM_UPLOAD_MS      UPLOAD_INTERVAL   // controlUploadIntervalMs() default
+#define SIM_EPOCH          1760000000UL      // unix time at simulated boot
+#define SIM_CONNECT_MS     3000              // radio on -> records can leave
+#define SIM_RTDB_LATENCY_MS 300              // write -> acknowledgement
+
+enum SimPower : uint8_t { SIM_ALWAYS_ON, SIM_LIGHT, SIM_DEEP };
+
+// Control trace as one segment file, same records as traceControl() in main.cpp
+static FILE             *s_trace = nullptr;
+static TsLogBlockEncoder s_traceEnc(TSLOG_CONTROL_FIELD_COUNT);
+
+static void traceFlush() {
+    uint8_t frame[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+    const size_t n = s_traceEnc.finish(frame, sizeof(frame));
+    if (n) fwrite(frame, 1, n, s_trace);
+    s_traceEnc.reset();
+}
+
+static void traceAppend(const ControlTraceEntry &e) {
+    if (!s_trace) return;
+    TsLogRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    tsLogFromControl(e, rec);
+    if (!s_traceEnc.add(rec)) {
+        traceFlush();
+        s_traceEnc.add(rec);
+    }
+}
+
+static bool traceOpen(const char *path) {
+    s_trace = fopen(path, "wb");
+    if (!s_trace) return false;
+    TsLogSegmentHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic          = TSLOG_MAGIC;
+    hdr.version        = TSLOG_VERSION;
+    hdr.fieldCount     = TSLOG_CONTROL_FIELD_COUNT;
+    hdr.sequence       = 1;
+    hdr.firstTimestamp = SIM_EPOCH;
+    fwrite(&hdr, sizeof(hdr), 1, s_trace);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t hours = 24;
+    uint32_t seed  = 1;
+    int      pos   = 0;
+    bool     fixed = false;
+    SimPower power = SIM_ALWAYS_ON;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) { g_simVerbose = true; continue; }
+        if (strcmp(argv[i], "--fixed") == 0) { fixed = true; continue; }
+        if (strcmp(argv[i], "--power") == 0 && i + 1 < argc) {
+            ++i;
+            power = strcmp(argv[i], "deep") == 0 ? SIM_DEEP
+                  : strcmp(argv[i], "light") == 0 ? SIM_LIGHT : SIM_ALWAYS_ON;
+            continue;
+        }
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            if (!traceOpen(argv[++i])) {
+                fprintf(stderr, "vermi_sim: cannot write %s\n", argv[i]);
+                return 2;
+            }
+            continue;
+        }
+        const uint32_t v = (uint32_t)strtoul(argv[i], nullptr, 10);
+        if (pos++ == 0) hours = v; else seed = v;
+    }
+
+    simReset(seed);
+    fakeRtdbReset();
+    fakeRtdbSetLatency(SIM_RTDB_LATENCY_MS);
+    initRecordQueue();
+    bootMark(BOOT_STORAGE_READY);
+    initFirebase("sim", "sim", "sim", "sim");
+    initPump();
+    halSensorsBegin();
+    scanTemperatureProbes();
+    sampleSchedulerInit();
+    if (fixed) {
+        for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+            sampleSchedulerSetBounds((SampleChannel)i, SENSOR_READ_INTERVAL, SENSOR_READ_INTERVAL);
+        }
+    }
+
+    PumpControl pump = { false, 0, 0, PUMP_REASON_NONE };
+    uint8_t  cycleChannels = 0;
+    uint32_t lastUpload = 0;
+    uint32_t lastRecord = 0;  // unix time key of the newest record handed over
+    uint32_t violations = 0;
+    uint32_t readings   = 0;
+    uint32_t polls      = 0;
+    uint32_t traced     = 0;
+    float    moistMin   = 100.0f, moistMax = 0.0f;
+
+    // Power plan state (PowerManager.cpp on the board)
+    static PowerBatch        batch;       // RTC memory
+    static ReportFilterState batchReport;  // RTC memory
+    powerBatchReset(batch);
+    bool     radioUp        = true;
+    uint32_t radioChangedMs = 0;
+    uint64_t radioMs        = 0;
+    uint64_t sleptMs        = 0;
+    uint32_t wakes          = 0;
+    uint32_t wakeMs         = 0;
+    uint32_t wakeVersion    = 0;
+    bool     added          = false;
+    bool     clockSet       = false;
+    bool     uploadWake     = powerUploadWake(batch, 0, clockSet);
+    uint32_t channelReadings[SAMPLE_CHANNEL_COUNT] = {};  // across deep-sleep reboots
+
+    const uint64_t endMs = (uint64_t)hours * 3600000ULL;
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    while (simNowMs() < endMs) {
+        const uint32_t now = halMillis();
+
+        // Sensor task
+        if (!sensorCycleBusy()) {
+            const uint8_t due = sampleSchedulerDue(now, pumpIsOn());
+            if (due) {
+                cycleChannels = due;
+                requestSensorCycle(due);
+            }
+        }
+        if (pollSensors()) {
+            sampleSchedulerObserve(cycleChannels, getSensorData(), now, pumpIsOn());
+            readings++;
+        }
+        polls++;
+
+        // loop()
+        if (sensorDataVersion() > 0) {
+            const SensorData data = getSensorData();
+
+            const uint32_t uploadMs = sampleSchedulerMoving() ? UPLOAD_INTERVAL_MOVING : SIM_UPLOAD_MS;
+            // Deep sleep uploads held readings instead (below)
+            if (power != SIM_DEEP && (lastUpload == 0 || now - lastUpload >= uploadMs)) {
+                const uint16_t fields = reportDueFields(data, now);
+                if (fields != 0) {
+                    lastUpload = now;
+                    lastRecord = SIM_EPOCH + now / 1000;
+                    uploadRecordDataToFirebase(lastRecord, data, fields);
+                    reportCommit(data, fields, now);
+                }
+            }
+
+            const bool pumpAuto = pumpControlStep(pump, data, now);
+            if (pumpAuto) setPump(pump.active);
+
+            ControlTraceEntry e = { (uint32_t)(SIM_EPOCH + now / 1000), now, CTRACE_PUMP_AUTO,
+                                    pumpIsOn(), pump.reason, data };
+            if (pumpAuto) traceAppend(e);
+            if (sensorDataVersion() != traced) {
+                traced   = sensorDataVersion();
+                e.event  = CTRACE_READING;
+                e.reason = PUMP_REASON_NONE;
+                traceAppend(e);
+            }
+            if (pumpIsOn() && (data.water_level <= 0 || data.ultra_level_percent >= 90)) {
+                violations++;
+            }
+        }
+
+        fakeRtdbSetOnline(radioUp && now - radioChangedMs >= SIM_CONNECT_MS);
+        firebaseLoop();
+
+        if (power == SIM_LIGHT) {
+            PowerState st;
+            st.nextReadingMs = sampleSchedulerWaitMs(now, pumpIsOn());
+            st.sinceRadioMs  = now - radioChangedMs;
+            st.radioEveryMs  = SIM_UPLOAD_MS;
+            st.radioUp       = radioUp;
+            st.radioPending  = firebaseUploadPending();
+            st.service       = false;
+            st.pumpOn        = pumpIsOn();
+            st.cycleBusy     = sensorCycleBusy();
+
+            const bool radio = powerRadioWanted(st);
+            if (radio != radioUp) {
+                if (!radio) firebaseRadioDown();
+                radioUp        = radio;
+                radioChangedMs = now;
+            } else if (const uint32_t ms = powerLightSleepMs(st)) {
+                if (pumpIsOn()) violations++;
+                simAdvance(ms);
+                sleptMs += ms;
+                wakes++;
+                continue;
+            }
+        } else if (power == SIM_DEEP) {
+            // One reading per wake, taken once nothing is in flight
+            if (!added && sensorDataVersion() != wakeVersion && !sensorCycleBusy() && !pumpIsOn()) {
+                powerBatchAdd(batch, now, getSensorData());
+                added = true;
+                if (uploadWake) {
+                    for (uint16_t i = 0; i < batch.count; i++) {
+                        const PowerBatchEntry &be = batch.entry[i];
+                        const uint16_t fields = reportDueFields(batchReport, be.data, be.monoMs);
+                        if (fields == 0) continue;
+                        lastRecord = powerBatchTimestamp(batch, i, SIM_EPOCH + now / 1000, now);
+                        recordQueuePush(lastRecord, be.data, fields);
+                        reportCommit(batchReport, be.data, fields, be.monoMs);
+                    }
+                    powerBatchReset(batch);
+                    clockSet = true;
+                }
+            }
+
+            const uint32_t awake = now - wakeMs;
+            const bool windowDone = !uploadWake || awake >= POWER_RADIO_MAX_MS ||
+                                    (awake >= POWER_RADIO_MIN_MS && !firebaseUploadPending());
+            if (added && windowDone && !pumpIsOn() && !sensorCycleBusy()) {
+                firebaseRadioDown();
+                recordQueueFlush();
+                const uint32_t ms = powerDeepSleepMs(awake);
+                simAdvance(ms);
+                sleptMs += ms;
+                wakes++;
+
+                // Reboot: RAM state is gone, the batch and pump state are not
+                for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+                    channelReadings[i] += sampleSchedulerReadings((SampleChannel)i);
+                }
+                sampleSchedulerInit();
+                initRecordQueue();
+                wakeMs         = halMillis();
+                wakeVersion    = sensorDataVersion();
+                added          = false;
+                uploadWake     = powerUploadWake(batch, wakeMs, clockSet);
+                radioUp        = uploadWake;
+                radioChangedMs = wakeMs;
+                continue;
+            }
+        }
+
+        if (radioUp) radioMs += SIM_TICK_MS;
+        if (g_sim.bedMoisture < moistMin) moistMin = g_sim.bedMoisture;
+        if (g_sim.bedMoisture > moistMax) moistMax = g_sim.bedMoisture;
+        simAdvance(SIM_TICK_MS);
+    }
+
+    if (s_trace) {
+        traceFlush();
+        fclose(s_trace);
+    }
+
+    const double wallS = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("simulated          %lu h (seed %lu, %u ms ticks)\n",
+           (unsigned long)hours, (unsigned long)seed, (unsigned)SIM_TICK_MS);
+    printf("readings           %lu (cycle max %lu ms)\n",
+           (unsigned long)readings, (unsigned long)(g_simCycleMaxUs / 1000));
+    printf("channel readings  ");
+    for (uint8_t i = 0; i < SAMPLE_CHANNEL_COUNT; i++) {
+        printf(" %s %lu", sampleChannelName((SampleChannel)i),
+               (unsigned long)(channelReadings[i] + sampleSchedulerReadings((SampleChannel)i)));
+    }
+    printf("%s\n", fixed ? " (fixed)" : "");
+    printf("pump               %lu starts, %lu s on\n",
+           (unsigned long)(pumpChangeCount() / 2), (unsigned long)(g_simStats.pumpOnMs / 1000));
+    printf("bed moisture       %.1f .. %.1f %%\n", moistMin, moistMax);
+    printf("tanks              %lu reservoir refills, %lu tea drains\n",
+           (unsigned long)g_simStats.reservoirRefills, (unsigned long)g_simStats.teaDrains);
+    printf("faults injected    %lu echo timeouts, %lu probe dropouts\n",
+           (unsigned long)g_simStats.echoTimeouts, (unsigned long)g_simStats.probeDropouts);
+    const FakeRtdbStats &rtdb = fakeRtdbStats();
+    printf("rtdb               %lu records in %lu writes, %llu bytes, %lu field values suppressed\n",
+           (unsigned long)fakeRtdbCount("/VermiBoxes/" DEVICE_ID), (unsigned long)rtdb.writes,
+           (unsigned long long)rtdb.bytes, (unsigned long)reportSuppressedFields());
+    printf("record queue       %lu left, %lu dropped\n",
+           (unsigned long)recordQueueSize(), (unsigned long)recordQueueDropped());
+    char lastPath[64];
+    snprintf(lastPath, sizeof(lastPath), "/VermiBoxes/%s/%lu", DEVICE_ID, (unsigned long)lastRecord);
+    if (const char *doc = fakeRtdbGet(lastPath)) printf("last record        %s %s\n", lastPath, doc);
+    static const char *const POWER_NAMES[] = { "always on", "light sleep", "deep sleep" };
+    printf("power              %s: awake %.1f %%, radio %.1f %%, %lu sleeps\n",
+           POWER_NAMES[power], 100.0 - 100.0 * sleptMs / endMs, 100.0 * radioMs / endMs,
+           (unsigned long)wakes);
+    printf("wall clock         %.3f s (%.0fx real time, %.0f ns per tick)\n",
+           wallS, wallS > 0 ? endMs / 1000.0 / wallS : 0.0,
+           polls ? wallS * 1e9 / polls : 0.0);
+    printf("pump rule breaks   %lu\n", (unsigned long)violations);
+
+    return violations ? 1 : 0;
+}
@@ -0,0 +1,61 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include "Log.h"
+#include "Metrics.h"
+#include "BootTrace.h"
+#include "Sim.h"
+
+// Host versions of the firmware services the portable sources call into.
+// Log lines go to stderr with the simulated time; metrics and boot stages
+// are kept only as far as the run summary needs them.
+
+bool g_simVerbose = false;
+
+static const char LEVEL_CHARS[] = "?EWIDV";
+
+void logWrite(uint8_t level, const char *tag, const char *fmt, ...) {
+    if (!g_simVerbose) return;
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    fprintf(stderr, "[%9llu][%c][%s] %s\n", (unsigned long long)simNowMs(),
+            LEVEL_CHARS[level < sizeof(LEVEL_CHARS) - 1 ? level : 0], tag, line);
+}
+
+uint32_t logDropped() {
+    return 0;
+}
+
+// ===== Metrics =====
+uint32_t g_simCycles     = 0;
+uint32_t g_simCycleMaxUs = 0;
+
+void metricsSensorStep(MetricSensorStep step, uint32_t us) {
+    if (step != METRIC_STEP_CYCLE) return;
+    g_simCycles++;
+    if (us > g_simCycleMaxUs) g_simCycleMaxUs = us;
+}
+
+void metricsFirebaseStart(uint8_t) {}
+void metricsFirebaseDone(uint8_t, bool) {}
+void metricsFirebaseBusySkip() {}
+
+// ===== Boot trace =====
+static uint32_t s_bootMs[BOOT_STAGE_COUNT];
+static bool     s_bootReached[BOOT_STAGE_COUNT];
+
+void bootMark(BootStage stage) {
+    if (stage >= BOOT_STAGE_COUNT || s_bootReached[stage]) return;
+    s_bootReached[stage] = true;
+    s_bootMs[stage]      = (uint32_t)simNowMs();
+}
+
+bool bootReached(BootStage stage) {
+    return stage < BOOT_STAGE_COUNT && s_bootReached[stage];
+}
+
+uint32_t bootStageMs(BootStage stage) {
+    return bootReached(stage) ? s_bootMs[stage] : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Host stand-in for the Arduino-ESP32 LittleFS ([env:native]): files live
+// in memory for the life of the process, so RecordQueue.cpp and its spool
+// run unchanged in the simulator and the unit tests. Only the calls the
+// firmware uses are provided.
+
+class File {
+public:
+    File() = default;
+    File(std::vector<uint8_t> *data, bool append) : data_(data), pos_(append ? data->size() : 0) {}
+
+    explicit operator bool() const { return data_ != nullptr; }
+
+    size_t write(const uint8_t *buf, size_t size);
+    size_t read(uint8_t *buf, size_t size);
+    bool   seek(uint32_t pos);
+    size_t size() const { return data_ ? data_->size() : 0; }
+    void   close() { data_ = nullptr; }
+
+private:
+    std::vector<uint8_t> *data_ = nullptr;
+    size_t                pos_  = 0;
+};
+
+class SimFS {
+public:
+    bool begin(bool formatOnFail = false);
+    File open(const char *path, const char *mode = "r");
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *from, const char *to);
+
+    // Test hooks: raw file contents (created empty if missing), wipe everything
+    std::vector<uint8_t> &data(const char *path);
+    void format();
+};
+
+extern SimFS LittleFS;
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the Arduino-ESP32 Preferences (NVS) class
+// ([env:native]): namespaces and keys kept in memory for the life of the
+// process, numeric types only.
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false);
+    void end();
+
+    int32_t getInt(const char *key, int32_t defaultValue = 0);
+    size_t  putInt(const char *key, int32_t value);
+    float   getFloat(const char *key, float defaultValue = 0.0f);
+    size_t  putFloat(const char *key, float value);
+    bool    getBool(const char *key, bool defaultValue = false);
+    size_t  putBool(const char *key, bool value);
+
+private:
+    bool find(const char *key, double *out) const;
+    void store(const char *key, double value);
+
+    char name_[16] = "";
+    bool open_     = false;
+    bool readOnly_ = true;
+};
+
+// Test hook: forget every stored value
+void simPreferencesClear();
+
+#endif
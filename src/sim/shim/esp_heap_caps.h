@@ -0,0 +1,16 @@
+#ifndef SIM_ESP_HEAP_CAPS_H
+#define SIM_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Host stand-in for ESP-IDF's esp_heap_caps.h ([env:native]): one heap.
+
+#define MALLOC_CAP_8BIT   0x0004
+#define MALLOC_CAP_SPIRAM 0x0400
+
+inline void *heap_caps_malloc(size_t size, uint32_t /*caps*/) {
+    return malloc(size);
+}
+
+#endif
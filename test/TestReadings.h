@@ -0,0 +1,25 @@
+#ifndef TEST_READINGS_H
+#define TEST_READINGS_H
+
+#include "SensorsData.h"
+
+// Shared by the host unit tests (test/test_*/): a complete, plausible
+// reading with both probes at tempC and moisturePct, the reservoir at 80 %
+// and the vermi tea tank half full, so no pump safety rule is triggered.
+
+inline SensorData testReading(float tempC = 25.0f, int moisturePct = 50) {
+    SensorData d = {};
+    d.temp_val_1          = tempC;
+    d.temp_val_2          = tempC;
+    d.moist_percent_1     = moisturePct;
+    d.moist_percent_2     = moisturePct;
+    d.avg_moisture        = moisturePct;
+    d.water_level         = 80.0f;
+    d.tds_val             = 800.0f;
+    d.ph_val              = 7.0f;
+    d.ultra_distance_cm   = 9.0f;
+    d.ultra_level_percent = 50;
+    return d;
+}
+
+#endif
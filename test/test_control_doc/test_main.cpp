@@ -0,0 +1,88 @@
+// ControlDoc.cpp: which leaves of a control document event are applied,
+// and which calibration reaches Preferences.
+
+#include <unity.h>
+#include <string.h>
+#include <Preferences.h>
+#include "ControlDoc.h"
+#include "SensorHandler.h"
+
+static uint8_t apply(const char *path, const char *json) {
+    return controlDocApply(path, json, strlen(json));
+}
+
+static int storedInt(const char *key) {
+    Preferences prefs;
+    prefs.begin("config", true);
+    const int v = prefs.getInt(key, -1);
+    prefs.end();
+    return v;
+}
+
+void setUp() {
+    simPreferencesClear();
+    valAir1 = valAir2 = 3018;
+    valWater1 = valWater2 = 1710;
+    ULTRA_EMPTY_CM = 14.0f;
+    ULTRA_FULL_CM  = 4.0f;
+}
+
+void tearDown() {}
+
+void test_calibration_is_applied_and_stored() {
+    TEST_ASSERT_EQUAL_UINT8(CONTROL_APPLIED_CALIBRATION,
+                            apply("/calibration", "{\"valAir1\":2900,\"valWater1\":1600}"));
+    TEST_ASSERT_EQUAL_INT(2900, valAir1);
+    TEST_ASSERT_EQUAL_INT(1600, valWater1);
+    TEST_ASSERT_EQUAL_INT(2900, storedInt("valAir1"));
+    TEST_ASSERT_EQUAL_INT(3018, storedInt("valAir2"));
+}
+
+void test_out_of_range_value_is_ignored() {
+    TEST_ASSERT_EQUAL_UINT8(0, apply("/calibration/valAir2", "5000"));
+    TEST_ASSERT_EQUAL_INT(3018, valAir2);
+    TEST_ASSERT_EQUAL_INT(-1, storedInt("valAir2"));
+}
+
+void test_patch_making_air_equal_water_is_rejected() {
+    TEST_ASSERT_EQUAL_UINT8(0, apply("/calibration/valWater1", "3018"));
+    TEST_ASSERT_EQUAL_INT(3018, valAir1);
+    TEST_ASSERT_EQUAL_INT(1710, valWater1);
+    TEST_ASSERT_EQUAL_INT(-1, storedInt("valWater1"));  // nothing saved
+}
+
+void test_inverted_pair_is_rolled_back_other_pair_kept() {
+    const uint8_t applied = apply("/calibration",
+                                  "{\"valAir1\":1500,\"valWater1\":2500,\"valAir2\":3100,\"valWater2\":1650}");
+    TEST_ASSERT_EQUAL_UINT8(CONTROL_APPLIED_CALIBRATION, applied);
+    TEST_ASSERT_EQUAL_INT(3018, valAir1);
+    TEST_ASSERT_EQUAL_INT(1710, valWater1);
+    TEST_ASSERT_EQUAL_INT(3100, valAir2);
+    TEST_ASSERT_EQUAL_INT(1650, valWater2);
+    TEST_ASSERT_EQUAL_INT(3018, storedInt("valAir1"));
+    TEST_ASSERT_EQUAL_INT(3100, storedInt("valAir2"));
+}
+
+void test_both_points_of_a_pair_may_move_in_one_patch() {
+    // Water above the old air value is fine once air moves up with it
+    apply("/calibration", "{\"valAir1\":3900,\"valWater1\":3100}");
+    TEST_ASSERT_EQUAL_INT(3900, valAir1);
+    TEST_ASSERT_EQUAL_INT(3100, valWater1);
+}
+
+void test_tank_distances_cross_checked() {
+    TEST_ASSERT_EQUAL_UINT8(0, apply("/calibration/ultraFullCm", "20"));
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, ULTRA_FULL_CM);
+    TEST_ASSERT_EQUAL_FLOAT(14.0f, ULTRA_EMPTY_CM);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_calibration_is_applied_and_stored);
+    RUN_TEST(test_out_of_range_value_is_ignored);
+    RUN_TEST(test_patch_making_air_equal_water_is_rejected);
+    RUN_TEST(test_inverted_pair_is_rolled_back_other_pair_kept);
+    RUN_TEST(test_both_points_of_a_pair_may_move_in_one_patch);
+    RUN_TEST(test_tank_distances_cross_checked);
+    return UNITY_END();
+}
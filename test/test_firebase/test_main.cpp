@@ -0,0 +1,191 @@
+// FirebaseHandler.cpp against the fake RTDB behind Hal.h (src/sim/FakeRtdb.cpp):
+// live records, store-and-forward batches, failed writes and the control
+// stream, on the simulated clock.
+
+#include <unity.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include "Config.h"
+#include "FirebaseHandler.h"
+#include "RecordQueue.h"
+#include "PumpHandler.h"
+#include "SensorHandler.h"
+#include "SensorFields.h"
+#include "BootTrace.h"
+#include "Sim.h"
+#include "../TestReadings.h"
+
+#define LATENCY_MS 300
+#define TEMP0_MOISTURE1 0x0005  // SENSOR_FIELDS bits 0 and 2
+
+// Runs loop() for ms of simulated time
+static void run(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 10) {
+        firebaseLoop();
+        simAdvance(10);
+    }
+    firebaseLoop();
+}
+
+static const char *record(uint32_t ts) {
+    char path[64];
+    snprintf(path, sizeof(path), "/VermiBoxes/%s/%lu", DEVICE_ID, (unsigned long)ts);
+    return fakeRtdbGet(path);
+}
+
+void setUp() {
+    simReset(1);
+    firebaseRadioDown();  // nothing in flight, stream closed
+    recordQueuePop(recordQueueSize());
+    LittleFS.format();
+    simPreferencesClear();
+    fakeRtdbReset();
+    fakeRtdbSetLatency(LATENCY_MS);
+    initRecordQueue();
+    bootMark(BOOT_STORAGE_READY);
+    initFirebase("key", "user", "pass", "url");
+    setPump(false);
+}
+
+void tearDown() {}
+
+void test_live_record_writes_masked_fields() {
+    run(10);
+    uploadRecordDataToFirebase(1000, testReading(23.5f, 41), TEMP0_MOISTURE1);
+    TEST_ASSERT_TRUE(firebaseUploadPending());
+    TEST_ASSERT_NULL(record(1000));
+
+    run(LATENCY_MS);
+    TEST_ASSERT_EQUAL_STRING("{\"temp0\":23.50,\"moisture1\":41}", record(1000));
+    TEST_ASSERT_FALSE(firebaseUploadPending());
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+}
+
+void test_busy_write_queues_record() {
+    run(10);
+    uploadRecordDataToFirebase(1000, testReading(23.5f, 41), SENSOR_FIELDS_ALL);
+    uploadRecordDataToFirebase(1001, testReading(24.0f, 41), SENSOR_FIELDS_ALL);
+    TEST_ASSERT_EQUAL_UINT32(1, recordQueueSize());
+
+    run(LATENCY_MS + RECORD_QUEUE_DRAIN_MS + LATENCY_MS);
+    TEST_ASSERT_NOT_NULL(record(1000));
+    TEST_ASSERT_NOT_NULL(record(1001));
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+}
+
+void test_offline_records_drain_as_one_batch() {
+    fakeRtdbSetOnline(false);
+    for (uint32_t i = 0; i < 5; i++) {
+        uploadRecordDataToFirebase(2000 + i, testReading(20.0f + i, 41), SENSOR_FIELDS_ALL);
+        run(100);
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(0, fakeRtdbStats().writes);
+
+    fakeRtdbSetOnline(true);
+    run(RECORD_QUEUE_DRAIN_MS + LATENCY_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(5, fakeRtdbCount("/VermiBoxes/" DEVICE_ID));
+    TEST_ASSERT_EQUAL_UINT32(1, fakeRtdbStats().writes);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"temp0\":24.00,\"temp1\":24.00,\"moisture1\":41,\"moisture2\":41,"
+        "\"water_level\":80.00,\"tds_val\":800.00,\"ph_val\":7.00,\"ultra_level_percent\":50}",
+        record(2004));
+}
+
+void test_failed_write_is_requeued() {
+    run(10);
+    fakeRtdbFailWrites(1);
+    uploadRecordDataToFirebase(3000, testReading(22.0f, 41), SENSOR_FIELDS_ALL);
+    run(LATENCY_MS);
+    TEST_ASSERT_NULL(record(3000));
+    TEST_ASSERT_EQUAL_UINT32(1, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(1, fakeRtdbStats().failed);
+
+    run(RECORD_QUEUE_DRAIN_MS + LATENCY_MS);
+    TEST_ASSERT_NOT_NULL(record(3000));
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+}
+
+void test_failed_batch_stays_queued() {
+    fakeRtdbSetOnline(false);
+    uploadRecordDataToFirebase(4000, testReading(22.0f, 41), SENSOR_FIELDS_ALL);
+    uploadRecordDataToFirebase(4001, testReading(22.5f, 41), SENSOR_FIELDS_ALL);
+    fakeRtdbSetOnline(true);
+    fakeRtdbFailWrites(1);
+    for (uint32_t t = 0; t < RECORD_QUEUE_DRAIN_MS + LATENCY_MS && fakeRtdbStats().failed == 0; t += 10) {
+        run(10);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, fakeRtdbStats().failed);
+    TEST_ASSERT_EQUAL_UINT32(2, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(0, fakeRtdbCount("/VermiBoxes/" DEVICE_ID));
+
+    run(RECORD_QUEUE_DRAIN_MS + LATENCY_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(2, fakeRtdbCount("/VermiBoxes/" DEVICE_ID));
+}
+
+void test_radio_down_requeues_write_in_flight() {
+    run(10);
+    uploadRecordDataToFirebase(5000, testReading(21.0f, 41), SENSOR_FIELDS_ALL);
+    TEST_ASSERT_EQUAL_UINT32(1, fakeRtdbInFlight());
+
+    firebaseRadioDown();
+    TEST_ASSERT_EQUAL_UINT32(0, fakeRtdbInFlight());
+    TEST_ASSERT_FALSE(fakeRtdbStreamOpen());
+    TEST_ASSERT_EQUAL_UINT32(1, recordQueueSize());
+
+    run(RECORD_QUEUE_DRAIN_MS + LATENCY_MS);
+    TEST_ASSERT_NOT_NULL(record(5000));
+    TEST_ASSERT_TRUE(fakeRtdbStreamOpen());
+}
+
+void test_stream_applies_control_document() {
+    fakeRtdbPut("/Control/" DEVICE_ID,
+                "{\"isPump\":true,\"calibration\":{\"valAir1\":2900,\"valWater1\":1600}}");
+    run(10);
+    TEST_ASSERT_TRUE(fakeRtdbStreamOpen());
+    TEST_ASSERT_TRUE(pumpIsOn());
+    TEST_ASSERT_TRUE(getPumpState());
+    TEST_ASSERT_EQUAL_INT(2900, valAir1);
+    TEST_ASSERT_EQUAL_INT(1600, valWater1);
+
+    Preferences prefs;
+    prefs.begin("config", true);
+    TEST_ASSERT_EQUAL_INT(2900, prefs.getInt("valAir1", 0));
+    prefs.end();
+
+    fakeRtdbStreamPush("put", "/isPump", "false");
+    run(10);
+    TEST_ASSERT_FALSE(pumpIsOn());
+}
+
+void test_stream_error_stops_pump_and_reopens() {
+    run(10);
+    fakeRtdbStreamPush("put", "/isPump", "true");
+    run(10);
+    TEST_ASSERT_TRUE(pumpIsOn());
+    const uint32_t opened = fakeRtdbStats().streams;
+
+    fakeRtdbStreamFail();
+    halRtdbLoop();
+    TEST_ASSERT_FALSE(pumpIsOn());
+    TEST_ASSERT_FALSE(fakeRtdbStreamOpen());
+
+    run(10);
+    TEST_ASSERT_TRUE(fakeRtdbStreamOpen());
+    TEST_ASSERT_EQUAL_UINT32(opened + 1, fakeRtdbStats().streams);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_live_record_writes_masked_fields);
+    RUN_TEST(test_busy_write_queues_record);
+    RUN_TEST(test_offline_records_drain_as_one_batch);
+    RUN_TEST(test_failed_write_is_requeued);
+    RUN_TEST(test_failed_batch_stays_queued);
+    RUN_TEST(test_radio_down_requeues_write_in_flight);
+    RUN_TEST(test_stream_applies_control_document);
+    RUN_TEST(test_stream_error_stops_pump_and_reopens);
+    return UNITY_END();
+}
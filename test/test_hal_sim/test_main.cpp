@@ -0,0 +1,111 @@
+// The host HAL (src/sim/HalSim.cpp): simulated clock, raw sensor values the
+// way the board reads them, and one acquisition cycle through Acquisition.cpp
+// on top of it.
+
+#include <unity.h>
+#include <math.h>
+#include "Config.h"
+#include "Hal.h"
+#include "SensorHandler.h"
+#include "SensorsData.h"
+#include "Sim.h"
+
+void setUp() {
+    simReset(7);
+}
+
+void tearDown() {}
+
+void test_clock_moves_only_with_sim_advance() {
+    TEST_ASSERT_EQUAL_UINT32(0, halMillis());
+    simAdvance(1500);
+    TEST_ASSERT_EQUAL_UINT32(1500, halMillis());
+    TEST_ASSERT_EQUAL_UINT32(1500000, halMicros());
+    TEST_ASSERT_EQUAL_UINT32(1500, (uint32_t)simNowMs());
+}
+
+void test_pump_relay_drives_the_world() {
+    halPumpInit();
+    TEST_ASSERT_FALSE(g_sim.pumpOn);
+    const float moisture = g_sim.bedMoisture;
+    const float reservoir = g_sim.reservoirPct;
+
+    halPumpWrite(true);
+    simAdvance(10000);
+    TEST_ASSERT_GREATER_THAN(moisture, g_sim.bedMoisture);
+    TEST_ASSERT_LESS_THAN(reservoir, g_sim.reservoirPct);
+    TEST_ASSERT_EQUAL_UINT32(10000, g_simStats.pumpOnMs);
+
+    halPumpHoldOff();
+    TEST_ASSERT_FALSE(g_sim.pumpOn);
+}
+
+void test_moisture_raw_falls_as_bed_gets_wetter() {
+    g_sim.bedMoisture = 10.0f;
+    const int dry = halAnalogMean(HAL_AIN_MOISTURE_1, 8);
+    g_sim.bedMoisture = 90.0f;
+    const int wet = halAnalogMean(HAL_AIN_MOISTURE_1, 8);
+    TEST_ASSERT_GREATER_THAN(wet + 1000, dry);
+    TEST_ASSERT_LESS_OR_EQUAL(4095, dry);
+}
+
+void test_moisture_with_equal_calibration_does_not_divide_by_zero() {
+    g_sim.bedMoisture = 50.0f;
+    TEST_ASSERT_EQUAL_INT(0, getMoistureVal(HAL_AIN_MOISTURE_1, 2000, 2000));
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 50.0f, getMoistureVal(HAL_AIN_MOISTURE_1, 3018, 1710));
+}
+
+void test_temp_conversion_time_follows_resolution() {
+    uint16_t convMs = 0;
+    TEST_ASSERT_EQUAL_UINT8(2, halTempScan(4, 12, &convMs));
+    TEST_ASSERT_EQUAL_UINT16(752, convMs);
+    TEST_ASSERT_EQUAL_UINT8(1, halTempScan(1, 9, &convMs));
+    TEST_ASSERT_EQUAL_UINT16(94, convMs);
+    TEST_ASSERT_FLOAT_IS_NAN(halTempRead(1));  // only one probe scanned
+}
+
+void test_ultrasonic_echo_arrives_after_its_width() {
+    g_sim.teaPct = 50.0f;  // 9 cm from the sensor
+    uint32_t width = 0;
+    halUltraTrigger();
+    TEST_ASSERT_FALSE(halUltraEcho(&width));
+
+    simAdvance(1);
+    TEST_ASSERT_TRUE(halUltraEcho(&width));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 9.0f, width / 58.0f);
+}
+
+void test_acquisition_cycle_publishes_reading() {
+    g_sim.bedMoisture = 40.0f;
+    g_sim.reservoirPct = 100.0f;
+    halSensorsBegin();
+    scanTemperatureProbes();
+    const uint32_t version = sensorDataVersion();
+
+    requestSensorCycle(SAMPLE_ALL);
+    uint32_t ms = 0;
+    while (!pollSensors() && ms < 5000) {
+        simAdvance(SENSOR_POLL_MS);
+        ms += SENSOR_POLL_MS;
+    }
+    TEST_ASSERT_LESS_THAN(5000, ms);
+    TEST_ASSERT_GREATER_OR_EQUAL(750, ms);  // waited for the 12-bit conversion
+    TEST_ASSERT_EQUAL_UINT32(version + 1, sensorDataVersion());
+
+    const SensorData d = getSensorData();
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 40.0f, d.moist_percent_1);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, g_sim.bedTempC, d.temp_val_1);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, g_sim.ph, d.ph_val);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clock_moves_only_with_sim_advance);
+    RUN_TEST(test_pump_relay_drives_the_world);
+    RUN_TEST(test_moisture_raw_falls_as_bed_gets_wetter);
+    RUN_TEST(test_moisture_with_equal_calibration_does_not_divide_by_zero);
+    RUN_TEST(test_temp_conversion_time_follows_resolution);
+    RUN_TEST(test_ultrasonic_echo_arrives_after_its_width);
+    RUN_TEST(test_acquisition_cycle_publishes_reading);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+// lib/JsonWriter: output format and the byte budget. Every document is
+// written into heap buffers of every size up to its full length, so a write
+// past cap shows up under -fsanitize=address as well as in the checks.
+
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <JsonWriter.h>
+
+typedef void (*Build)(JsonWriter &w);
+
+static void nested(JsonWriter &w) {
+    w.beginObject();
+    w.addInt("a", 1);
+    w.beginObject("b");
+    w.endObject();
+    w.endObject();
+}
+
+static void values(JsonWriter &w) {
+    w.beginObject();
+    w.addString("id", "VB-\"01\"");
+    w.addFloat("temp", 23.456f, 2);
+    w.addFloat("nan", NAN, 2);
+    w.addUInt("ts", 1760000000u);
+    w.addBool("on", true);
+    w.addNull("none");
+    w.beginObject("deep");
+    w.beginObject("er");
+    w.addInt("n", -5);
+    w.endObject();
+    w.endObject();
+    w.endObject();
+}
+
+// The catch-up batch in FirebaseHandler.cpp: records until one does not
+// fit, which is rewound so the batch still closes cleanly
+static size_t s_batchRecords;
+
+static void batch(JsonWriter &w) {
+    w.beginObject();
+    s_batchRecords = 0;
+    for (uint32_t i = 0; i < 6; i++) {
+        const JsonWriter::Mark mark = w.mark();
+        char key[12];
+        snprintf(key, sizeof(key), "%lu", (unsigned long)(1760000000u + i));
+        w.beginObject(key);
+        w.addFloat("temp0", 20.0f + i, 2);
+        w.addInt("moisture1", 40 + (int)i);
+        w.endObject();
+        if (!w.ok()) { w.rewind(mark); break; }
+        s_batchRecords++;
+    }
+    w.endObject();
+}
+
+static std::string full(Build build) {
+    char buf[512];
+    JsonWriter w(buf, sizeof(buf));
+    build(w);
+    TEST_ASSERT_TRUE(w.ok());
+    return std::string(buf, w.length());
+}
+
+static bool balanced(const char *s) {
+    int depth = 0;
+    bool inString = false;
+    for (; *s; s++) {
+        if (inString) {
+            if (*s == '\\') s++;
+            else if (*s == '"') inString = false;
+        } else if (*s == '"') {
+            inString = true;
+        } else if (*s == '{') {
+            depth++;
+        } else if (*s == '}' && --depth < 0) {
+            return false;
+        }
+    }
+    return depth == 0 && !inString;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_formats_values() {
+    const std::string a = full(nested);
+    const std::string b = full(values);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"b\":{}}", a.c_str());
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"id\":\"VB-\\\"01\\\"\",\"temp\":23.46,\"nan\":null,\"ts\":1760000000,"
+        "\"on\":true,\"none\":null,\"deep\":{\"er\":{\"n\":-5}}}",
+        b.c_str());
+}
+
+void test_every_buffer_size_stays_in_bounds() {
+    const Build builds[] = { nested, values };
+    for (Build build : builds) {
+        const std::string want = full(build);
+        for (size_t cap = 1; cap <= want.size() + 1; cap++) {
+            char *buf = new char[cap];
+            JsonWriter w(buf, cap);
+            build(w);
+            TEST_ASSERT_LESS_THAN(cap, w.length());
+            TEST_ASSERT_EQUAL_size_t(strlen(buf), w.length());
+            if (cap == want.size() + 1) {
+                TEST_ASSERT_TRUE(w.ok());  // exact fit: document plus terminator
+                TEST_ASSERT_EQUAL_STRING(want.c_str(), buf);
+            } else {
+                TEST_ASSERT_FALSE(w.ok());
+            }
+            delete[] buf;
+        }
+    }
+}
+
+void test_exact_fit_nested_object() {
+    // {"a":1,"b":{}} is 14 bytes: cap 14 leaves no room for the terminator
+    char *buf = new char[14];
+    JsonWriter w(buf, 14);
+    nested(w);
+    TEST_ASSERT_FALSE(w.ok());
+    TEST_ASSERT_LESS_THAN(14, w.length());
+    delete[] buf;
+}
+
+void test_rewound_batch_always_closes() {
+    const std::string want = full(batch);
+    for (size_t cap = 3; cap <= want.size() + 1; cap++) {
+        char *buf = new char[cap];
+        JsonWriter w(buf, cap);
+        batch(w);
+        TEST_ASSERT_TRUE(w.ok());
+        TEST_ASSERT_TRUE(balanced(buf));
+        // A prefix of the full batch, closed after the last record that fit
+        TEST_ASSERT_EQUAL_INT(0, want.compare(0, w.length() - 1, buf, w.length() - 1));
+        if (cap == want.size() + 1) TEST_ASSERT_EQUAL_size_t(6, s_batchRecords);
+        delete[] buf;
+    }
+}
+
+void test_float_formatting() {
+    char out[24];
+    TEST_ASSERT_EQUAL_size_t(4, JsonWriter::formatFloat(out, sizeof(out), -0.004f, 2));
+    TEST_ASSERT_EQUAL_STRING("0.00", out);
+    JsonWriter::formatFloat(out, sizeof(out), -1.005f, 1);
+    TEST_ASSERT_EQUAL_STRING("-1.0", out);
+    JsonWriter::formatFloat(out, sizeof(out), 7.0f, 0);
+    TEST_ASSERT_EQUAL_STRING("7", out);
+    TEST_ASSERT_EQUAL_size_t(0, JsonWriter::formatFloat(out, 4, 123.5f, 1));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_formats_values);
+    RUN_TEST(test_every_buffer_size_stays_in_bounds);
+    RUN_TEST(test_exact_fit_nested_object);
+    RUN_TEST(test_rewound_batch_always_closes);
+    RUN_TEST(test_float_formatting);
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+// MedianFilter.h against a brute-force reference: the window sorted from
+// scratch after every sample.
+
+#include <unity.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "MedianFilter.h"
+
+static uint32_t s_rng = 1;
+
+static int32_t nextInt(int32_t range) {
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (int32_t)((s_rng >> 8) % (uint32_t)range);
+}
+
+// Median, trimmed mean, min and max of the last n samples, the slow way
+template <typename T>
+struct Reference {
+    std::deque<T> window;
+    size_t        n;
+
+    explicit Reference(size_t n) : n(n) {}
+
+    void push(T v) {
+        window.push_back(v);
+        if (window.size() > n) window.pop_front();
+    }
+
+    std::vector<T> sorted() const {
+        std::vector<T> s(window.begin(), window.end());
+        std::sort(s.begin(), s.end());
+        return s;
+    }
+
+    T median() const {
+        const std::vector<T> s = sorted();
+        const size_t mid = s.size() / 2;
+        return (s.size() & 1) ? s[mid] : (T)((s[mid - 1] + s[mid]) / 2);
+    }
+
+    double trimmedMean(size_t trim) const {
+        const std::vector<T> s = sorted();
+        double sum = 0;
+        for (size_t i = trim; i < s.size() - trim; i++) sum += s[i];
+        return sum / (double)(s.size() - 2 * trim);
+    }
+};
+
+// Unity's TEST_ASSERT_EQUAL compares as integers; floats need their own check
+static void assertSame(int want, int got) { TEST_ASSERT_EQUAL_INT(want, got); }
+static void assertSame(float want, float got) { TEST_ASSERT_EQUAL_FLOAT(want, got); }
+
+template <typename T, size_t N>
+static void checkAgainstReference(int32_t range, size_t samples) {
+    MedianFilter<T, N> f;
+    Reference<T> ref(N);
+    for (size_t i = 0; i < samples; i++) {
+        // Narrow ranges give plenty of duplicates, the hard case for the shifts
+        const T v = (T)(nextInt(range) - range / 2) / (std::is_floating_point<T>::value ? (T)4 : (T)1);
+        f.push(v);
+        ref.push(v);
+
+        TEST_ASSERT_EQUAL_size_t(ref.window.size(), f.size());
+        assertSame(ref.median(), f.median());
+        const std::vector<T> s = ref.sorted();
+        assertSame(s.front(), f.minimum());
+        assertSame(s.back(), f.maximum());
+        if (s.size() > 2) {
+            const double want = ref.trimmedMean(1);
+            if (std::is_floating_point<T>::value) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-3, want, (double)f.trimmedMean(1));
+            } else {
+                TEST_ASSERT_EQUAL((long long)want, (long long)f.trimmedMean(1));
+            }
+        }
+    }
+}
+
+void setUp() {
+    s_rng = 12345;
+}
+
+void tearDown() {}
+
+void test_empty_filter_returns_default() {
+    MedianFilter<int, 5> f;
+    TEST_ASSERT_TRUE(f.empty());
+    TEST_ASSERT_EQUAL_INT(0, f.median());
+    TEST_ASSERT_EQUAL_INT(0, f.trimmedMean(1));
+    TEST_ASSERT_EQUAL_INT(0, f.minimum());
+    TEST_ASSERT_EQUAL_INT(0, f.maximum());
+}
+
+void test_odd_and_even_counts() {
+    MedianFilter<int, 4> f;
+    f.push(10);
+    TEST_ASSERT_EQUAL_INT(10, f.median());
+    f.push(20);
+    TEST_ASSERT_EQUAL_INT(15, f.median());
+    f.push(0);
+    TEST_ASSERT_EQUAL_INT(10, f.median());
+    f.push(40);
+    TEST_ASSERT_TRUE(f.full());
+    TEST_ASSERT_EQUAL_INT(15, f.median());
+
+    f.push(50);  // 10 leaves: 0 20 40 50
+    TEST_ASSERT_EQUAL_INT(30, f.median());
+    TEST_ASSERT_EQUAL_INT(0, f.minimum());
+    TEST_ASSERT_EQUAL_INT(50, f.maximum());
+}
+
+void test_median_rejects_a_spike() {
+    MedianFilter<int, 5> f;
+    const int samples[] = { 2010, 2012, 4095, 2008, 2011 };
+    for (int v : samples) f.push(v);
+    TEST_ASSERT_EQUAL_INT(2011, f.median());
+    TEST_ASSERT_EQUAL_INT(2011, f.trimmedMean(1));  // mean of 2010 2011 2012
+}
+
+void test_trimmed_mean_falls_back_to_median() {
+    MedianFilter<float, 4> f;
+    f.push(1.0f);
+    f.push(2.0f);
+    f.push(100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, f.trimmedMean(2));
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, f.trimmedMean(1));
+    TEST_ASSERT_EQUAL_FLOAT(103.0f / 3.0f, f.trimmedMean(0));
+}
+
+void test_reset_forgets_the_window() {
+    MedianFilter<int, 3> f;
+    f.push(7);
+    f.push(8);
+    f.push(9);
+    f.reset();
+    TEST_ASSERT_TRUE(f.empty());
+    f.push(1);
+    TEST_ASSERT_EQUAL_INT(1, f.median());
+    TEST_ASSERT_EQUAL_INT(1, f.maximum());
+}
+
+void test_window_of_one() {
+    checkAgainstReference<int, 1>(100, 50);
+}
+
+void test_int_windows_match_reference() {
+    checkAgainstReference<int, 2>(8, 300);
+    checkAgainstReference<int, 5>(8, 500);
+    checkAgainstReference<int, 8>(1000, 500);
+    checkAgainstReference<int, 31>(4096, 2000);
+    checkAgainstReference<int, 64>(16, 2000);
+}
+
+void test_float_windows_match_reference() {
+    checkAgainstReference<float, 3>(40, 500);
+    checkAgainstReference<float, 10>(400, 1000);
+    checkAgainstReference<float, 25>(4, 1000);
+}
+
+void test_unsigned_samples() {
+    MedianFilter<uint16_t, 7> f;
+    Reference<uint16_t> ref(7);
+    for (int i = 0; i < 500; i++) {
+        const uint16_t v = (uint16_t)nextInt(4096);
+        f.push(v);
+        ref.push(v);
+        TEST_ASSERT_EQUAL_UINT16(ref.median(), f.median());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_filter_returns_default);
+    RUN_TEST(test_odd_and_even_counts);
+    RUN_TEST(test_median_rejects_a_spike);
+    RUN_TEST(test_trimmed_mean_falls_back_to_median);
+    RUN_TEST(test_reset_forgets_the_window);
+    RUN_TEST(test_window_of_one);
+    RUN_TEST(test_int_windows_match_reference);
+    RUN_TEST(test_float_windows_match_reference);
+    RUN_TEST(test_unsigned_samples);
+    return UNITY_END();
+}
@@ -0,0 +1,216 @@
+// PowerPlan.cpp decisions (radio windows, light-sleep length, the deep-sleep
+// batch) and the report filter state deep sleep keeps next to the batch.
+
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "Config.h"
+#include "PowerPlan.h"
+#include "PumpControl.h"
+#include "ReportFilter.h"
+#include "../TestReadings.h"
+
+#define EVERY_MS 60000
+
+// Idle, radio down, next reading far away
+static PowerState idle() {
+    PowerState s;
+    s.nextReadingMs = 30000;
+    s.sinceRadioMs  = 1000;
+    s.radioEveryMs  = EVERY_MS;
+    s.radioUp       = false;
+    s.radioPending  = false;
+    s.service       = false;
+    s.pumpOn        = false;
+    s.cycleBusy     = false;
+    return s;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// ===== Light sleep =====
+void test_radio_comes_up_once_per_upload_interval() {
+    PowerState s = idle();
+    TEST_ASSERT_FALSE(powerRadioWanted(s));
+    s.sinceRadioMs = EVERY_MS;
+    TEST_ASSERT_TRUE(powerRadioWanted(s));
+}
+
+void test_radio_window_runs_min_then_extends_while_pending() {
+    PowerState s = idle();
+    s.radioUp      = true;
+    s.sinceRadioMs = POWER_RADIO_MIN_MS - 1;
+    TEST_ASSERT_TRUE(powerRadioWanted(s));
+
+    s.sinceRadioMs = POWER_RADIO_MIN_MS;
+    TEST_ASSERT_FALSE(powerRadioWanted(s));
+    s.radioPending = true;
+    TEST_ASSERT_TRUE(powerRadioWanted(s));
+    s.sinceRadioMs = POWER_RADIO_MAX_MS;
+    TEST_ASSERT_FALSE(powerRadioWanted(s));  // gives up, the rest waits
+
+    s.service = true;
+    TEST_ASSERT_TRUE(powerRadioWanted(s));
+}
+
+void test_light_sleep_wakes_before_reading_or_radio() {
+    PowerState s = idle();
+    TEST_ASSERT_EQUAL_UINT32(30000 - POWER_WARMUP_MS, powerLightSleepMs(s));
+
+    s.sinceRadioMs = EVERY_MS - 5000;  // radio window in 5 s
+    TEST_ASSERT_EQUAL_UINT32(5000, powerLightSleepMs(s));
+
+    s.sinceRadioMs = EVERY_MS - POWER_SLEEP_MIN_MS + 1;  // too short to sleep
+    TEST_ASSERT_EQUAL_UINT32(0, powerLightSleepMs(s));
+}
+
+void test_no_light_sleep_while_pump_cycle_radio_or_service() {
+    PowerState s = idle();
+    s.pumpOn = true;
+    TEST_ASSERT_EQUAL_UINT32(0, powerLightSleepMs(s));
+    s = idle();
+    s.cycleBusy = true;
+    TEST_ASSERT_EQUAL_UINT32(0, powerLightSleepMs(s));
+    s = idle();
+    s.radioUp = true;
+    TEST_ASSERT_EQUAL_UINT32(0, powerLightSleepMs(s));
+    s = idle();
+    s.service = true;
+    TEST_ASSERT_EQUAL_UINT32(0, powerLightSleepMs(s));
+}
+
+// ===== Deep sleep =====
+void test_batch_drops_oldest_when_full() {
+    PowerBatch b;
+    powerBatchReset(b);
+    for (uint32_t i = 0; i < POWER_BATCH_RECORDS + 3; i++) {
+        powerBatchAdd(b, i * POWER_DEEP_PERIOD_MS, testReading(20.0f + i, 40));
+    }
+    TEST_ASSERT_EQUAL_UINT16(POWER_BATCH_RECORDS, b.count);
+    TEST_ASSERT_EQUAL_UINT32(3 * POWER_DEEP_PERIOD_MS, b.entry[0].monoMs);
+    TEST_ASSERT_EQUAL_FLOAT(23.0f, b.entry[0].data.temp_val_1);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + POWER_BATCH_RECORDS + 2, b.entry[POWER_BATCH_RECORDS - 1].data.temp_val_1);
+}
+
+void test_upload_wake_when_batch_fills_ages_or_clock_unset() {
+    PowerBatch b;
+    powerBatchReset(b);
+    TEST_ASSERT_TRUE(powerUploadWake(b, 0, false));  // no wall clock yet
+    TEST_ASSERT_FALSE(powerUploadWake(b, 0, true));
+
+    powerBatchAdd(b, 1000, testReading(20.0f, 40));
+    TEST_ASSERT_FALSE(powerUploadWake(b, 1000 + POWER_BATCH_MAX_AGE_MS - 1, true));
+    TEST_ASSERT_TRUE(powerUploadWake(b, 1000 + POWER_BATCH_MAX_AGE_MS, true));
+
+    // The reading this wake takes fills the batch
+    powerBatchReset(b);
+    for (uint32_t i = 0; i + 2 < POWER_BATCH_RECORDS; i++) powerBatchAdd(b, i, testReading(20.0f, 40));
+    TEST_ASSERT_FALSE(powerUploadWake(b, POWER_BATCH_RECORDS, true));
+    powerBatchAdd(b, POWER_BATCH_RECORDS, testReading(20.0f, 40));
+    TEST_ASSERT_TRUE(powerUploadWake(b, POWER_BATCH_RECORDS + 1, true));
+}
+
+void test_batch_timestamps_from_monotonic_clock() {
+    PowerBatch b;
+    powerBatchReset(b);
+    powerBatchAdd(b, 10000, testReading(20.0f, 40));
+    powerBatchAdd(b, 70000, testReading(20.0f, 40));
+    powerBatchAdd(b, 130500, testReading(20.0f, 40));
+
+    const uint32_t unixNow = 1760000000;
+    TEST_ASSERT_EQUAL_UINT32(unixNow - 140, powerBatchTimestamp(b, 0, unixNow, 150000));
+    TEST_ASSERT_EQUAL_UINT32(unixNow - 80, powerBatchTimestamp(b, 1, unixNow, 150000));
+    TEST_ASSERT_EQUAL_UINT32(unixNow - 19, powerBatchTimestamp(b, 2, unixNow, 150000));
+}
+
+void test_deep_sleep_keeps_the_period() {
+    TEST_ASSERT_EQUAL_UINT32(POWER_DEEP_PERIOD_MS - 2500, powerDeepSleepMs(2500));
+    TEST_ASSERT_EQUAL_UINT32(POWER_SLEEP_MIN_MS, powerDeepSleepMs(POWER_DEEP_PERIOD_MS));
+    TEST_ASSERT_EQUAL_UINT32(POWER_SLEEP_MIN_MS, powerDeepSleepMs(POWER_DEEP_PERIOD_MS + 40000));
+}
+
+void test_pump_cooldown_survives_reboot() {
+    PumpControl pc = { false, 0, 0, PUMP_REASON_NONE };
+    const SensorData dry = testReading(25.0f, PUMP_RULES_DEFAULT.moistOnBelow - 5);
+
+    // Ran until 100 s on the old clock, which had reached 110 s at sleep
+    pc.startMs   = 90000;
+    pc.lastOffMs = 100000;
+    const uint32_t span = 110000;
+    powerRebasePump(pc, span);
+
+    // New clock: 10 s after the pump stopped
+    const uint32_t offFor = 10000;
+    TEST_ASSERT_EQUAL_UINT32(offFor, (uint32_t)(0u - pc.lastOffMs));
+    TEST_ASSERT_FALSE(pumpControlStep(pc, dry, PUMP_RULES_DEFAULT.cooldownMs - offFor - 1));
+    TEST_ASSERT_TRUE(pumpControlStep(pc, dry, PUMP_RULES_DEFAULT.cooldownMs - offFor));
+    TEST_ASSERT_TRUE(pc.active);
+}
+
+// ===== Report filter state kept across deep sleep =====
+void test_held_readings_only_upload_what_moved() {
+    ReportFilterState st;
+    memset(&st, 0, sizeof(st));  // RTC memory after power-up
+
+    const SensorData a = testReading(25.00f, 40);
+    const uint16_t first = reportDueFields(st, a, 0);
+    TEST_ASSERT_NOT_EQUAL(0, first);
+    reportCommit(st, a, first, 0);
+
+    // Inside every deadband: nothing to upload
+    TEST_ASSERT_EQUAL_UINT16(0, reportDueFields(st, a, POWER_DEEP_PERIOD_MS));
+
+    // Only the moved field is due
+    SensorData b = a;
+    b.moist_percent_1 = 40 + DEADBAND_MOISTURE + 1;
+    TEST_ASSERT_EQUAL_UINT16(1u << 2, reportDueFields(st, b, 2 * POWER_DEEP_PERIOD_MS));
+
+    // A field that lost its reading is due too
+    b = a;
+    b.temp_val_2 = NAN;
+    TEST_ASSERT_EQUAL_UINT16(1u << 1, reportDueFields(st, b, 3 * POWER_DEEP_PERIOD_MS));
+}
+
+void test_heartbeat_runs_on_the_monotonic_clock() {
+    ReportFilterState st;
+    memset(&st, 0, sizeof(st));
+    const SensorData a = testReading(25.0f, 40);
+    const uint32_t t0 = 4000000000u;  // close to the wrap of the 32-bit clock
+    reportCommit(st, a, reportDueFields(st, a, t0), t0);
+
+    TEST_ASSERT_EQUAL_UINT16(0, reportDueFields(st, a, t0 + REPORT_HEARTBEAT_MS - 1));
+    TEST_ASSERT_NOT_EQUAL(0, reportDueFields(st, a, t0 + REPORT_HEARTBEAT_MS));  // wrapped
+}
+
+void test_caller_state_is_separate_from_live_filter() {
+    ReportFilterState st;
+    memset(&st, 0, sizeof(st));
+    const SensorData a = testReading(25.0f, 40);
+    reportCommit(st, a, reportDueFields(st, a, 1000), 1000);
+
+    // The live filter has not seen anything yet
+    TEST_ASSERT_NOT_EQUAL(0, reportDueFields(a, 1000));
+
+    const uint32_t suppressed = reportSuppressedFields();
+    reportCommit(st, a, 1u << 0, 2000);  // temp0 only
+    TEST_ASSERT_GREATER_THAN(suppressed, reportSuppressedFields());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_radio_comes_up_once_per_upload_interval);
+    RUN_TEST(test_radio_window_runs_min_then_extends_while_pending);
+    RUN_TEST(test_light_sleep_wakes_before_reading_or_radio);
+    RUN_TEST(test_no_light_sleep_while_pump_cycle_radio_or_service);
+    RUN_TEST(test_batch_drops_oldest_when_full);
+    RUN_TEST(test_upload_wake_when_batch_fills_ages_or_clock_unset);
+    RUN_TEST(test_batch_timestamps_from_monotonic_clock);
+    RUN_TEST(test_deep_sleep_keeps_the_period);
+    RUN_TEST(test_pump_cooldown_survives_reboot);
+    RUN_TEST(test_held_readings_only_upload_what_moved);
+    RUN_TEST(test_heartbeat_runs_on_the_monotonic_clock);
+    RUN_TEST(test_caller_state_is_separate_from_live_filter);
+    return UNITY_END();
+}
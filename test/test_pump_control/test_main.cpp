@@ -0,0 +1,96 @@
+// PumpControl.cpp: the automatic pump rules, one pumpControlStep() per
+// loop() pass, on PUMP_RULES_DEFAULT.
+
+#include <unity.h>
+#include "PumpControl.h"
+#include "../TestReadings.h"
+
+static const PumpRules &R = PUMP_RULES_DEFAULT;
+
+static PumpControl s_pc;
+
+// Runs the rules every 2 ms from..to, like loop(); returns the transitions
+static uint32_t runLoop(const SensorData &d, uint32_t fromMs, uint32_t toMs) {
+    uint32_t changes = 0;
+    for (uint32_t t = fromMs; t <= toMs; t += 2) {
+        if (pumpControlStep(s_pc, d, t)) changes++;
+    }
+    return changes;
+}
+
+void setUp() {
+    s_pc = { false, 0, 0, PUMP_REASON_NONE };
+}
+
+void tearDown() {}
+
+void test_dry_bed_starts_after_cooldown() {
+    const SensorData dry = testReading(25.0f, R.moistOnBelow - 1);
+    TEST_ASSERT_FALSE(pumpControlStep(s_pc, dry, R.cooldownMs - 1));
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, dry, R.cooldownMs));
+    TEST_ASSERT_TRUE(s_pc.active);
+    TEST_ASSERT_EQUAL_UINT8(PUMP_REASON_MOIST_LOW, s_pc.reason);
+}
+
+void test_run_ends_after_duration() {
+    const SensorData dry = testReading(25.0f, R.moistOnBelow - 1);
+    pumpControlStep(s_pc, dry, R.cooldownMs);
+    TEST_ASSERT_FALSE(pumpControlStep(s_pc, dry, R.cooldownMs + R.durationMs - 1));
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, dry, R.cooldownMs + R.durationMs));
+    TEST_ASSERT_EQUAL_UINT8(PUMP_REASON_DURATION, s_pc.reason);
+}
+
+void test_hot_bed_starts_on_temperature() {
+    const SensorData hot = testReading(R.tempOnAbove + 1.0f, R.moistOffAbove);
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, hot, R.cooldownMs));
+    TEST_ASSERT_EQUAL_UINT8(PUMP_REASON_TEMP_HIGH, s_pc.reason);
+}
+
+void test_hot_wet_bed_never_energizes_the_relay() {
+    // Hot enough to start, wet enough to stop: no one-pass blips every cooldown
+    const SensorData hotWet = testReading(R.tempOnAbove + 1.0f, R.moistOffAbove + 1);
+    TEST_ASSERT_EQUAL_UINT32(0, runLoop(hotWet, 0, 5 * R.cooldownMs));
+    TEST_ASSERT_FALSE(s_pc.active);
+}
+
+void test_recovered_moisture_stops_the_run() {
+    pumpControlStep(s_pc, testReading(25.0f, R.moistOnBelow - 1), R.cooldownMs);
+    TEST_ASSERT_FALSE(pumpControlStep(s_pc, testReading(25.0f, R.moistOffAbove), R.cooldownMs + 100));
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, testReading(25.0f, R.moistOffAbove + 1), R.cooldownMs + 200));
+    TEST_ASSERT_EQUAL_UINT8(PUMP_REASON_MOIST_OK, s_pc.reason);
+}
+
+void test_empty_reservoir_forces_off() {
+    pumpControlStep(s_pc, testReading(25.0f, R.moistOnBelow - 1), R.cooldownMs);
+    SensorData empty = testReading(25.0f, R.moistOnBelow - 1);
+    empty.water_level = 0;
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, empty, R.cooldownMs + 10));
+    TEST_ASSERT_EQUAL_UINT8(PUMP_REASON_WATER_EMPTY, s_pc.reason);
+    TEST_ASSERT_EQUAL_UINT32(0, runLoop(empty, R.cooldownMs + 12, 3 * R.cooldownMs));
+}
+
+void test_full_tea_tank_blocks_until_resume_level() {
+    SensorData d = testReading(25.0f, R.moistOnBelow - 1);
+    pumpControlStep(s_pc, d, R.cooldownMs);
+    d.ultra_level_percent = R.teaBlockAt;
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, d, R.cooldownMs + 10));
+    TEST_ASSERT_EQUAL_UINT8(PUMP_REASON_TEA_FULL, s_pc.reason);
+
+    const uint32_t later = 3 * R.cooldownMs;
+    d.ultra_level_percent = R.teaResumeAt + 1;  // in the hysteresis band
+    TEST_ASSERT_FALSE(pumpControlStep(s_pc, d, later));
+    d.ultra_level_percent = R.teaResumeAt;
+    TEST_ASSERT_TRUE(pumpControlStep(s_pc, d, later + 2));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_dry_bed_starts_after_cooldown);
+    RUN_TEST(test_run_ends_after_duration);
+    RUN_TEST(test_hot_bed_starts_on_temperature);
+    RUN_TEST(test_hot_wet_bed_never_energizes_the_relay);
+    RUN_TEST(test_recovered_moisture_stops_the_run);
+    RUN_TEST(test_empty_reservoir_forces_off);
+    RUN_TEST(test_full_tea_tank_blocks_until_resume_level);
+    return UNITY_END();
+}
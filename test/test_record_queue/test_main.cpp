@@ -0,0 +1,149 @@
+// RecordQueue.cpp on the in-memory LittleFS (src/sim/shim): ordering across
+// the spool and the RAM ring, popping, and what survives a reboot.
+
+#include <unity.h>
+#include <string.h>
+#include <LittleFS.h>
+#include "Config.h"
+#include "RecordQueue.h"
+#include "SensorFields.h"
+
+#define SPOOL_PATH "/rq_spool.bin"  // as in RecordQueue.cpp
+#define HEAD_PATH  "/rq_head.bin"
+
+static void push(uint32_t first, uint32_t count) {
+    for (uint32_t ts = first; ts < first + count; ts++) {
+        SensorData d = {};
+        d.temp_val_1 = ts * 0.5f;
+        recordQueuePush(ts, d, (uint16_t)ts);
+    }
+}
+
+static uint32_t oldest() {
+    QueuedRecord rec;
+    return recordQueuePeek(&rec, 1) == 1 ? rec.timestamp : 0;
+}
+
+// What initRecordQueue() finds after a reset: RAM records that were never
+// flushed are gone, the spool and its head are not
+static void reboot() {
+    recordQueuePop(0);
+    initRecordQueue();
+}
+
+void setUp() {
+    recordQueuePop(recordQueueSize());
+    LittleFS.format();
+    TEST_ASSERT_TRUE(initRecordQueue());
+}
+
+void tearDown() {}
+
+void test_records_spill_to_spool_every_flush_at() {
+    push(1, RECORD_QUEUE_FLUSH_AT - 1);
+    TEST_ASSERT_FALSE(LittleFS.exists(SPOOL_PATH));
+
+    push(RECORD_QUEUE_FLUSH_AT, 1);
+    TEST_ASSERT_TRUE(LittleFS.exists(SPOOL_PATH));
+    TEST_ASSERT_EQUAL_UINT32(8 + RECORD_QUEUE_FLUSH_AT * sizeof(QueuedRecord),
+                             LittleFS.data(SPOOL_PATH).size());
+}
+
+void test_peek_is_oldest_first_across_spool_and_ram() {
+    const uint32_t n = RECORD_QUEUE_FLUSH_AT + 2;  // spool, then two in RAM
+    push(100, n);
+    TEST_ASSERT_EQUAL_UINT32(n, recordQueueSize());
+
+    QueuedRecord out[RECORD_QUEUE_FLUSH_AT + 4];
+    TEST_ASSERT_EQUAL_UINT32(n, recordQueuePeek(out, RECORD_QUEUE_FLUSH_AT + 4));
+    for (uint32_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(100 + i, out[i].timestamp);
+        TEST_ASSERT_EQUAL_UINT16(100 + i, out[i].fields);
+        TEST_ASSERT_EQUAL_FLOAT((100 + i) * 0.5f, out[i].data.temp_val_1);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(3, recordQueuePeek(out, 3));
+    TEST_ASSERT_EQUAL_UINT32(102, out[2].timestamp);
+    TEST_ASSERT_EQUAL_UINT32(n, recordQueueSize());  // peek does not remove
+}
+
+void test_pop_crosses_from_spool_into_ram() {
+    push(1, RECORD_QUEUE_FLUSH_AT + 2);
+    recordQueuePop(RECORD_QUEUE_FLUSH_AT - 1);
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT, oldest());
+
+    recordQueuePop(2);
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT + 2, oldest());
+    TEST_ASSERT_FALSE(LittleFS.exists(SPOOL_PATH));  // emptied spool is removed
+
+    recordQueuePop(5);  // more than queued
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+}
+
+void test_spool_and_head_survive_reboot() {
+    push(1, RECORD_QUEUE_FLUSH_AT * 2);
+    recordQueuePop(3);
+    TEST_ASSERT_TRUE(LittleFS.exists(HEAD_PATH));
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT * 2 - 3, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(4, oldest());
+}
+
+void test_flush_keeps_ram_records_over_reboot() {
+    push(1, 2);
+    recordQueueFlush();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(2, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(1, oldest());
+}
+
+void test_torn_tail_record_is_ignored() {
+    push(1, RECORD_QUEUE_FLUSH_AT);
+    std::vector<uint8_t> &spool = LittleFS.data(SPOOL_PATH);
+    spool.insert(spool.end(), 7, 0xAB);  // power cut mid-write
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT, recordQueueSize());
+
+    push(50, RECORD_QUEUE_FLUSH_AT);
+    QueuedRecord out[RECORD_QUEUE_FLUSH_AT * 2];
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT * 2, recordQueuePeek(out, RECORD_QUEUE_FLUSH_AT * 2));
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT, out[RECORD_QUEUE_FLUSH_AT - 1].timestamp);
+    TEST_ASSERT_EQUAL_UINT32(50, out[RECORD_QUEUE_FLUSH_AT].timestamp);
+}
+
+void test_incompatible_spool_is_discarded() {
+    push(1, RECORD_QUEUE_FLUSH_AT);
+    std::vector<uint8_t> &spool = LittleFS.data(SPOOL_PATH);
+    const uint32_t otherSize = sizeof(QueuedRecord) + 4;  // older firmware layout
+    memcpy(&spool[4], &otherSize, sizeof(otherSize));
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(0, recordQueueSize());
+    TEST_ASSERT_FALSE(LittleFS.exists(SPOOL_PATH));
+}
+
+void test_bad_head_falls_back_to_spool_start() {
+    push(1, RECORD_QUEUE_FLUSH_AT);
+    recordQueuePop(1);
+    const uint32_t bad = 8 + sizeof(QueuedRecord) / 2;  // not on a record boundary
+    memcpy(LittleFS.data(HEAD_PATH).data(), &bad, sizeof(bad));
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(RECORD_QUEUE_FLUSH_AT, recordQueueSize());
+    TEST_ASSERT_EQUAL_UINT32(1, oldest());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_records_spill_to_spool_every_flush_at);
+    RUN_TEST(test_peek_is_oldest_first_across_spool_and_ram);
+    RUN_TEST(test_pop_crosses_from_spool_into_ram);
+    RUN_TEST(test_spool_and_head_survive_reboot);
+    RUN_TEST(test_flush_keeps_ram_records_over_reboot);
+    RUN_TEST(test_torn_tail_record_is_ignored);
+    RUN_TEST(test_incompatible_spool_is_discarded);
+    RUN_TEST(test_bad_head_falls_back_to_spool_start);
+    return UNITY_END();
+}
@@ -0,0 +1,228 @@
+// lib/TsLog: block framing, the delta-of-delta record encoding and the
+// recovery scan the device and tools/tslog_decode rely on.
+
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <TsLog.h>
+#include <TsLogSensor.h>
+
+#define FIELDS 4
+
+static std::vector<TsLogRecord> s_decoded;
+
+static void collect(const TsLogRecord &rec, void *) {
+    s_decoded.push_back(rec);
+}
+
+static TsLogRecord makeRecord(uint32_t ts, int32_t a, int32_t b, int32_t c, int32_t d) {
+    TsLogRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp = ts;
+    rec.values[0] = a;
+    rec.values[1] = b;
+    rec.values[2] = c;
+    rec.values[3] = d;
+    return rec;
+}
+
+// One framed block of count records starting at ts
+static size_t encodeBlock(uint8_t *out, size_t outLen, uint32_t ts, uint8_t count) {
+    TsLogBlockEncoder enc(FIELDS);
+    for (uint8_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(enc.add(makeRecord(ts + i * 60, 2300 + i, -i, 41, TSLOG_MISSING)));
+    }
+    return enc.finish(out, outLen);
+}
+
+static void assertSameRecord(const TsLogRecord &want, const TsLogRecord &got) {
+    TEST_ASSERT_EQUAL_UINT32(want.timestamp, got.timestamp);
+    for (uint8_t f = 0; f < FIELDS; f++) TEST_ASSERT_EQUAL_INT(want.values[f], got.values[f]);
+}
+
+void setUp() {
+    s_decoded.clear();
+}
+
+void tearDown() {}
+
+void test_crc16_ccitt_check_value() {
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, tsLogCrc16((const uint8_t *)"123456789", 9));
+}
+
+void test_segment_header_validation() {
+    TsLogSegmentHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic      = TSLOG_MAGIC;
+    hdr.version    = TSLOG_VERSION;
+    hdr.fieldCount = FIELDS;
+    TEST_ASSERT_TRUE(tsLogValidHeader(hdr));
+
+    hdr.fieldCount = TSLOG_MAX_FIELDS + 1;
+    TEST_ASSERT_FALSE(tsLogValidHeader(hdr));
+    hdr.fieldCount = FIELDS;
+    hdr.version    = TSLOG_VERSION + 1;
+    TEST_ASSERT_FALSE(tsLogValidHeader(hdr));
+}
+
+void test_block_round_trip() {
+    // Irregular timestamps, sign changes, large jumps and missing values
+    const TsLogRecord in[] = {
+        makeRecord(1760000000, 2350, 0, 41, TSLOG_MISSING),
+        makeRecord(1760000060, 2350, 0, 41, TSLOG_MISSING),
+        makeRecord(1760000120, 2351, -5, 41, 700),
+        makeRecord(1760000125, -2000, INT32_MAX, 0, 700),
+        makeRecord(1760003725, 2349, INT32_MIN + 1, 100, TSLOG_MISSING),
+        makeRecord(1760003725, 2349, 7, 100, 0),
+    };
+    const size_t n = sizeof(in) / sizeof(in[0]);
+
+    TsLogBlockEncoder enc(FIELDS);
+    for (size_t i = 0; i < n; i++) TEST_ASSERT_TRUE(enc.add(in[i]));
+    TEST_ASSERT_EQUAL_UINT8(n, enc.count());
+
+    uint8_t buf[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+    const size_t len = enc.finish(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_size_t(enc.framedSize(), len);
+    TEST_ASSERT_EQUAL_UINT8(TSLOG_BLOCK_MARKER, buf[0]);
+
+    size_t consumed = 0;
+    TEST_ASSERT_EQUAL(TSLOG_OK, tsLogDecodeBlock(buf, len, FIELDS, &consumed, collect, nullptr));
+    TEST_ASSERT_EQUAL_size_t(len, consumed);
+    TEST_ASSERT_EQUAL_size_t(n, s_decoded.size());
+    for (size_t i = 0; i < n; i++) assertSameRecord(in[i], s_decoded[i]);
+}
+
+void test_steady_records_cost_few_bytes() {
+    uint8_t buf[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+    const size_t one = encodeBlock(buf, sizeof(buf), 1760000000, 1);
+    TsLogBlockEncoder enc(FIELDS);
+    for (uint8_t i = 0; i < 50; i++) TEST_ASSERT_TRUE(enc.add(makeRecord(1760000000 + i * 60, 2300, 0, 41, 0)));
+    // After the first two records: delta-of-delta 0 and an empty change mask
+    TEST_ASSERT_LESS_OR_EQUAL(one + 2 * 48 + 8, enc.framedSize());
+}
+
+void test_full_block_refuses_record_unchanged() {
+    TsLogBlockEncoder enc(FIELDS);
+    uint32_t i = 0;
+    // Every field changes by a lot on every record
+    while (enc.add(makeRecord(1760000000 + i * 7919, (int32_t)(i * 1000003), -(int32_t)(i * 999983),
+                              (int32_t)(i * 77777), (int32_t)(i * 55555)))) {
+        i++;
+        TEST_ASSERT_LESS_THAN(255, i);
+    }
+    TEST_ASSERT_EQUAL_UINT8(i, enc.count());
+    TEST_ASSERT_LESS_OR_EQUAL(TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES, enc.framedSize());
+
+    uint8_t buf[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+    TEST_ASSERT_EQUAL_size_t(0, enc.finish(buf, enc.framedSize() - 1));
+    const size_t len = enc.finish(buf, sizeof(buf));
+    size_t consumed = 0;
+    TEST_ASSERT_EQUAL(TSLOG_OK, tsLogDecodeBlock(buf, len, FIELDS, &consumed, collect, nullptr));
+    TEST_ASSERT_EQUAL_size_t(i, s_decoded.size());
+}
+
+void test_corrupt_and_truncated_blocks_are_rejected() {
+    uint8_t buf[TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES];
+    const size_t len = encodeBlock(buf, sizeof(buf), 1760000000, 10);
+    size_t consumed = 0;
+
+    TEST_ASSERT_EQUAL(TSLOG_TRUNCATED, tsLogDecodeBlock(buf, len - 1, FIELDS, &consumed, collect, nullptr));
+
+    buf[len / 2] ^= 0x10;
+    TEST_ASSERT_EQUAL(TSLOG_CORRUPT, tsLogDecodeBlock(buf, len, FIELDS, &consumed, collect, nullptr));
+    buf[len / 2] ^= 0x10;
+
+    buf[0] = 0;
+    TEST_ASSERT_EQUAL(TSLOG_CORRUPT, tsLogDecodeBlock(buf, len, FIELDS, &consumed, collect, nullptr));
+    TEST_ASSERT_EQUAL_size_t(0, s_decoded.size());
+}
+
+void test_scan_skips_corrupt_block_and_keeps_the_rest() {
+    std::vector<uint8_t> log(3 * (TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES));
+    size_t len = encodeBlock(&log[0], log.size(), 1760000000, 5);
+    const size_t second = len;
+    len += encodeBlock(&log[len], log.size() - len, 1760001000, 6);
+    const size_t third = len;
+    len += encodeBlock(&log[len], log.size() - len, 1760002000, 7);
+    log[second + 8] ^= 0xFF;  // inside the second block's payload
+
+    TsLogScanStats stats;
+    memset(&stats, 0, sizeof(stats));
+    TEST_ASSERT_EQUAL_size_t(len, tsLogScanBuffer(log.data(), len, FIELDS, true, collect, nullptr, &stats));
+    TEST_ASSERT_EQUAL_UINT32(2, stats.blocks);
+    TEST_ASSERT_EQUAL_UINT32(12, stats.records);
+    TEST_ASSERT_GREATER_OR_EQUAL(1, stats.corruptBlocks);
+    TEST_ASSERT_EQUAL_UINT32(third - second, stats.skippedBytes);
+
+    TEST_ASSERT_EQUAL_size_t(12, s_decoded.size());
+    TEST_ASSERT_EQUAL_UINT32(1760000000 + 4 * 60, s_decoded[4].timestamp);
+    TEST_ASSERT_EQUAL_UINT32(1760002000, s_decoded[5].timestamp);
+}
+
+void test_scan_leaves_incomplete_tail_until_at_end() {
+    uint8_t log[2 * (TSLOG_BLOCK_MAX + TSLOG_FRAME_BYTES)];
+    const size_t first = encodeBlock(log, sizeof(log), 1760000000, 5);
+    const size_t second = encodeBlock(log + first, sizeof(log) - first, 1760001000, 5);
+    const size_t partial = first + second / 2;  // second block still being written
+
+    TsLogScanStats stats;
+    memset(&stats, 0, sizeof(stats));
+    TEST_ASSERT_EQUAL_size_t(first, tsLogScanBuffer(log, partial, FIELDS, false, collect, nullptr, &stats));
+    TEST_ASSERT_EQUAL_UINT32(5, stats.records);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.corruptBlocks);
+
+    // Resumed once the rest has been appended
+    TEST_ASSERT_EQUAL_size_t(second, tsLogScanBuffer(log + first, second, FIELDS, false, collect, nullptr, &stats));
+    TEST_ASSERT_EQUAL_size_t(10, s_decoded.size());
+
+    // Nothing more coming: the torn block is dropped
+    memset(&stats, 0, sizeof(stats));
+    TEST_ASSERT_EQUAL_size_t(partial, tsLogScanBuffer(log, partial, FIELDS, true, collect, nullptr, &stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.blocks);
+}
+
+void test_sensor_data_mapping_round_trip() {
+    SensorData d = {};
+    d.temp_val_1          = 23.456f;
+    d.temp_val_2          = NAN;
+    d.moist_percent_1     = 41;
+    d.moist_percent_2     = 44;
+    d.avg_moisture        = 42;
+    d.water_level         = 80.25f;
+    d.tds_val             = 812.3f;
+    d.ph_val              = 7.21f;
+    d.ultra_distance_cm   = 9.5f;
+    d.ultra_level_percent = 45;
+
+    TsLogRecord rec;
+    tsLogFromSensorData(1760000000, d, rec);
+    TEST_ASSERT_EQUAL_INT(2346, rec.values[0]);
+    TEST_ASSERT_EQUAL_INT(TSLOG_MISSING, rec.values[1]);
+    TEST_ASSERT_EQUAL_INT(TSLOG_MISSING, tsLogQuantize(1e12f, 100.0f));
+
+    SensorData out = {};
+    tsLogToSensorData(rec, out);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 23.46f, out.temp_val_1);
+    TEST_ASSERT_FLOAT_IS_NAN(out.temp_val_2);
+    TEST_ASSERT_EQUAL_INT(41, out.moist_percent_1);
+    TEST_ASSERT_EQUAL_INT(42, out.avg_moisture);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 80.3f, out.water_level);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 7.21f, out.ph_val);
+    TEST_ASSERT_EQUAL_INT(45, out.ultra_level_percent);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc16_ccitt_check_value);
+    RUN_TEST(test_segment_header_validation);
+    RUN_TEST(test_block_round_trip);
+    RUN_TEST(test_steady_records_cost_few_bytes);
+    RUN_TEST(test_full_block_refuses_record_unchanged);
+    RUN_TEST(test_corrupt_and_truncated_blocks_are_rejected);
+    RUN_TEST(test_scan_skips_corrupt_block_and_keeps_the_rest);
+    RUN_TEST(test_scan_leaves_incomplete_tail_until_at_end);
+    RUN_TEST(test_sensor_data_mapping_round_trip);
+    return UNITY_END();
+}
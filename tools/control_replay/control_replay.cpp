@@ -0,0 +1,350 @@
+// Host-side replay of recorded control traces through the pump rules.
+//
+// Fetch the trace from the device (segments back to back) and run:
+//
+//   curl -o trace.bin http://vermi<DEVICE_ID>.local/trace
+//
+//   g++ -std=gnu++17 -O2 -I../../include -I../../lib/TsLog
+//       control_replay.cpp ../../src/PumpControl.cpp ../../lib/TsLog/TsLog.cpp -o control_replay
+//
+//   ./control_replay [options] <dump|dir|segment.tsl>...
+//
+// Every reading in the trace is fed to pumpControlStep() (src/PumpControl.cpp,
+// the code loop() runs) in device uptime, stepping the clock by --tick
+// between readings the way loop() polls it. Relay changes made from the RTDB
+// are applied to the replayed relay as they were on the device. Prints
+// recorded vs replayed starts, on time, duty cycle and run lengths, overall
+// and per day; --timeline also lists every relay change as CSV.
+//
+// Thresholds default to PUMP_RULES_DEFAULT and can be overridden:
+//   --moist-on N  --moist-off N  --temp-on C  --tea-block N  --tea-resume N
+//   --duration MS  --cooldown MS
+// Replay options:
+//   --tick MS      controller step between readings (default 100)
+//   --max-gap MS   longer silences are treated as missing data (default 60000)
+//   --timeline     print relay changes: unix,uptime_ms,source,state,reason
+//
+// Several dumps may overlap (e.g. one pulled every day); segments are merged
+// by sequence number and the most complete copy of each is used.
+
+#include <TsLog.h>
+#include <TsLogControl.h>
+#include "PumpControl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+struct Options {
+  PumpRules rules    = PUMP_RULES_DEFAULT;
+  uint32_t  tickMs   = 100;
+  uint32_t  maxGapMs = 60000;
+  bool      timeline = false;
+};
+
+static Options g_opt;
+
+static void usage() {
+  fprintf(stderr,
+          "usage: control_replay [--moist-on N] [--moist-off N] [--temp-on C] [--tea-block N]\n"
+          "                      [--tea-resume N] [--duration MS] [--cooldown MS] [--tick MS]\n"
+          "                      [--max-gap MS] [--timeline] <dump|dir|file>...\n");
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static void addPath(const std::string &path, std::vector<std::string> &files) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    fprintf(stderr, "control_replay: cannot open %s\n", path.c_str());
+    return;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    files.push_back(path);
+    return;
+  }
+  DIR *dir = opendir(path.c_str());
+  if (!dir) return;
+  while (struct dirent *e = readdir(dir)) {
+    const size_t len = strlen(e->d_name);
+    if (len > 4 && strcmp(e->d_name + len - 4, ".tsl") == 0) files.push_back(path + "/" + e->d_name);
+  }
+  closedir(dir);
+}
+
+// ===== Loading =====
+typedef std::vector<ControlTraceEntry> Entries;
+
+static std::map<uint32_t, Entries> g_segments;  // by segment sequence
+static uint32_t g_corrupt = 0;
+
+static void onRecord(const TsLogRecord &rec, void *ctx) {
+  ControlTraceEntry e;
+  tsLogToControl(rec, e);
+  ((Entries *)ctx)->push_back(e);
+}
+
+static bool headerAt(const std::vector<uint8_t> &buf, size_t pos, TsLogSegmentHeader &hdr) {
+  if (buf.size() - pos < sizeof(hdr)) return false;
+  memcpy(&hdr, buf.data() + pos, sizeof(hdr));
+  return tsLogValidHeader(hdr);
+}
+
+static void keepSegment(uint32_t seq, Entries &entries) {
+  Entries &kept = g_segments[seq];
+  if (entries.size() > kept.size()) kept.swap(entries);
+}
+
+// A file is either one segment or a /trace dump: segment headers followed by
+// their blocks, back to back
+static void loadFile(const std::string &path) {
+  std::vector<uint8_t> buf;
+  TsLogSegmentHeader hdr;
+  if (!readFile(path, buf) || !headerAt(buf, 0, hdr)) {
+    fprintf(stderr, "control_replay: %s: not a control trace\n", path.c_str());
+    return;
+  }
+
+  size_t  pos  = 0;
+  bool    open = false;
+  uint32_t seq = 0;
+  Entries entries;
+  while (pos < buf.size()) {
+    if (headerAt(buf, pos, hdr)) {
+      if (open) keepSegment(seq, entries);
+      entries.clear();
+      open = hdr.fieldCount == TSLOG_CONTROL_FIELD_COUNT;
+      if (!open) fprintf(stderr, "control_replay: %s: segment %u is not a control trace\n",
+                         path.c_str(), hdr.sequence);
+      seq  = hdr.sequence;
+      pos += sizeof(hdr);
+      continue;
+    }
+
+    size_t used = 0;
+    const TsLogStatus st = tsLogDecodeBlock(buf.data() + pos, buf.size() - pos,
+                                            TSLOG_CONTROL_FIELD_COUNT, &used,
+                                            open ? onRecord : nullptr, &entries);
+    if (st == TSLOG_OK) {
+      pos += used;
+    } else {
+      if (buf[pos] == TSLOG_BLOCK_MARKER) g_corrupt++;
+      pos++;  // resync on the next marker or header
+    }
+  }
+  if (open) keepSegment(seq, entries);
+}
+
+// ===== Relay timelines =====
+struct DayStats {
+  uint64_t observedMs = 0;
+  uint64_t onMs       = 0;
+  uint32_t starts     = 0;
+};
+
+struct Relay {
+  const char *name;
+  bool        on      = false;
+  uint32_t    sinceMs = 0;   // uptime of the last change
+  uint32_t    starts  = 0;
+  uint64_t    onMs    = 0;
+  uint32_t    longestMs = 0;
+  uint32_t    reasons[PUMP_REASON_COUNT] = {};
+  std::map<uint32_t, DayStats> days;  // by unix day
+
+  explicit Relay(const char *n) : name(n) {}
+
+  void set(bool state, uint32_t uptimeMs, uint32_t unixTime, uint8_t reason) {
+    if (state == on) return;
+    if (on) longestMs = std::max(longestMs, uptimeMs - sinceMs);
+    on      = state;
+    sinceMs = uptimeMs;
+    if (reason < PUMP_REASON_COUNT) reasons[reason]++;
+    if (on) {
+      starts++;
+      if (unixTime) days[unixTime / 86400].starts++;
+    }
+    if (g_opt.timeline) {
+      printf("%u,%u,%s,%s,%s\n", unixTime, uptimeMs, name, on ? "on" : "off", pumpReasonName(reason));
+    }
+  }
+
+  // Time in [from, to) of uptime, all on the same day
+  void account(uint32_t from, uint32_t to, uint32_t unixTime) {
+    const uint32_t span = to - from;
+    if (on) onMs += span;
+    if (!unixTime) return;
+    DayStats &d = days[unixTime / 86400];
+    d.observedMs += span;
+    if (on) d.onMs += span;
+  }
+
+  // Reboot or missing data: a run in progress ends here
+  void cut(uint32_t uptimeMs) {
+    if (on) longestMs = std::max(longestMs, uptimeMs - sinceMs);
+    on = false;
+  }
+};
+
+int main(int argc, char **argv) {
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    const char *a    = argv[i];
+    const bool  more = i + 1 < argc;
+    if (!strcmp(a, "--timeline")) g_opt.timeline = true;
+    else if (!strcmp(a, "--moist-on") && more)   g_opt.rules.moistOnBelow  = atoi(argv[++i]);
+    else if (!strcmp(a, "--moist-off") && more)  g_opt.rules.moistOffAbove = atoi(argv[++i]);
+    else if (!strcmp(a, "--temp-on") && more)    g_opt.rules.tempOnAbove   = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--tea-block") && more)  g_opt.rules.teaBlockAt    = atoi(argv[++i]);
+    else if (!strcmp(a, "--tea-resume") && more) g_opt.rules.teaResumeAt   = atoi(argv[++i]);
+    else if (!strcmp(a, "--duration") && more)  g_opt.rules.durationMs    = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(a, "--cooldown") && more)  g_opt.rules.cooldownMs    = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(a, "--tick") && more)      g_opt.tickMs   = std::max(1UL, strtoul(argv[++i], nullptr, 10));
+    else if (!strcmp(a, "--max-gap") && more)   g_opt.maxGapMs = strtoul(argv[++i], nullptr, 10);
+    else if (a[0] == '-') { usage(); return 2; }
+    else addPath(a, files);
+  }
+  if (files.empty()) {
+    usage();
+    return 2;
+  }
+
+  const auto wallStart = std::chrono::steady_clock::now();
+  for (const std::string &path : files) loadFile(path);
+
+  Entries trace;
+  for (auto &seg : g_segments) trace.insert(trace.end(), seg.second.begin(), seg.second.end());
+  if (trace.empty()) {
+    fprintf(stderr, "control_replay: no records\n");
+    return 1;
+  }
+
+  if (g_opt.timeline) puts("unix,uptime_ms,source,state,reason");
+
+  Relay recorded("recorded"), replayed("replayed");
+  PumpControl pc = { false, 0, 0, PUMP_REASON_NONE };
+  SensorData  cur;
+  bool        haveData = false;
+  uint32_t    t = 0, unixTime = 0;
+  uint64_t    observedMs = 0, disagreeMs = 0, steps = 0;
+  uint32_t    readings = 0, autoEvents = 0, externalEvents = 0, reboots = 0, gaps = 0;
+
+  for (size_t i = 0; i < trace.size(); i++) {
+    const ControlTraceEntry &e = trace[i];
+    if (haveData && e.uptimeMs < t) {
+      // Device restarted: relay forced OFF, controller state lost
+      recorded.cut(t);
+      replayed.cut(t);
+      pc = PumpControl{ false, 0, 0, PUMP_REASON_NONE };
+      haveData = false;
+      reboots++;
+    } else if (haveData && e.uptimeMs - t > g_opt.maxGapMs) {
+      gaps++;  // not replayed, not counted
+    } else if (haveData) {
+      // loop() between two trace entries: same inputs, only the clock moves
+      uint32_t now = t;
+      while (now < e.uptimeMs) {
+        const uint32_t next = std::min(e.uptimeMs, now + g_opt.tickMs);
+        recorded.account(now, next, unixTime);
+        replayed.account(now, next, unixTime);
+        observedMs += next - now;
+        if (recorded.on != replayed.on) disagreeMs += next - now;
+        now = next;
+        if (now < e.uptimeMs && pumpControlStep(pc, cur, now, g_opt.rules)) {
+          replayed.set(pc.active, now, unixTime, pc.reason);
+        }
+        steps++;
+      }
+    }
+    t = e.uptimeMs;
+    if (e.timestamp) unixTime = e.timestamp;
+
+    switch (e.event) {
+      case CTRACE_READING:
+        readings++;
+        cur      = e.data;
+        haveData = true;
+        break;
+      case CTRACE_PUMP_AUTO:
+        autoEvents++;
+        break;
+      case CTRACE_PUMP_EXTERNAL:
+        externalEvents++;
+        replayed.set(e.pumpOn, t, unixTime, PUMP_REASON_NONE);  // the device obeyed it too
+        break;
+    }
+    recorded.set(e.pumpOn, t, unixTime, e.event == CTRACE_PUMP_AUTO ? e.reason : (uint8_t)PUMP_REASON_NONE);
+
+    // One loop() pass per uptime, after every entry it produced
+    const bool lastAtT = i + 1 == trace.size() || trace[i + 1].uptimeMs != t;
+    if (haveData && lastAtT && pumpControlStep(pc, cur, t, g_opt.rules)) {
+      replayed.set(pc.active, t, unixTime, pc.reason);
+    }
+  }
+  recorded.cut(t);
+  replayed.cut(t);
+
+  const double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  if (g_opt.timeline) putchar('\n');
+
+  const PumpRules &r = g_opt.rules;
+  printf("trace        %zu segment(s), %zu record(s): %u readings, %u auto, %u external, %u corrupt block(s)\n",
+         g_segments.size(), trace.size(), readings, autoEvents, externalEvents, g_corrupt);
+  printf("observed     %.1f h (%u reboot(s), %u gap(s) over %u ms skipped)\n",
+         observedMs / 3.6e6, reboots, gaps, g_opt.maxGapMs);
+  printf("rules        moist_on<%d moist_off>%d temp_on>%.1f tea_block>=%d tea_resume<=%d"
+         " duration %u ms cooldown %u ms\n",
+         r.moistOnBelow, r.moistOffAbove, r.tempOnAbove, r.teaBlockAt, r.teaResumeAt,
+         r.durationMs, r.cooldownMs);
+
+  printf("\n%-14s %12s %12s\n", "", recorded.name, replayed.name);
+  const Relay *relays[2] = { &recorded, &replayed };
+  printf("%-14s %12u %12u\n", "starts", recorded.starts, replayed.starts);
+  printf("%-14s %12.0f %12.0f\n", "on time (s)", recorded.onMs / 1000.0, replayed.onMs / 1000.0);
+  printf("%-14s", "duty cycle %");
+  for (const Relay *rl : relays) printf(" %12.3f", observedMs ? rl->onMs * 100.0 / observedMs : 0.0);
+  printf("\n%-14s", "mean run (s)");
+  for (const Relay *rl : relays) printf(" %12.1f", rl->starts ? rl->onMs / 1000.0 / rl->starts : 0.0);
+  printf("\n%-14s %12.1f %12.1f\n", "longest (s)", recorded.longestMs / 1000.0, replayed.longestMs / 1000.0);
+  for (uint8_t i = PUMP_REASON_NONE + 1; i < PUMP_REASON_COUNT; i++) {
+    printf("%-14s %12u %12u\n", pumpReasonName(i), recorded.reasons[i], replayed.reasons[i]);
+  }
+  printf("%-14s %12.0f s (%.2f %% of observed time)\n", "disagreement",
+         disagreeMs / 1000.0, observedMs ? disagreeMs * 100.0 / observedMs : 0.0);
+
+  if (!recorded.days.empty()) {
+    printf("\n%-10s %10s %10s %10s %10s\n", "day (UTC)", "rec duty%", "rep duty%", "rec starts", "rep starts");
+    for (const auto &d : recorded.days) {
+      const DayStats &rep = replayed.days[d.first];
+      const time_t    day = (time_t)d.first * 86400;
+      char date[16];
+      strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&day));
+      printf("%-10s %10.3f %10.3f %10u %10u\n", date,
+             d.second.observedMs ? d.second.onMs * 100.0 / d.second.observedMs : 0.0,
+             rep.observedMs ? rep.onMs * 100.0 / rep.observedMs : 0.0,
+             d.second.starts, rep.starts);
+    }
+  }
+
+  printf("\nreplayed %.1f h in %.3f s (%.0fx real time, %llu controller steps)\n",
+         observedMs / 3.6e6, wallS, wallS > 0 ? observedMs / 1000.0 / wallS : 0.0,
+         (unsigned long long)steps);
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Host-side microbenchmark: MedianFilter against the old per-call bubble sort.
+//
+//   g++ -std=c++17 -O2 -I../../include median_bench.cpp -o median_bench
+//
+//   ./median_bench [iterations]
+//
+// Feeds the same stream of 12-bit ADC-like samples (random walk plus spikes)
+// through both, reading the median after every sample the way getTDSValue()
+// does, checks that every result matches and prints ns per sample.
+
+#include <MedianFilter.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define WINDOW 30  // ADC_MEDIAN_WINDOW in Config.h
+
+// The previous implementation, kept verbatim for comparison (the VLA is a
+// GNU extension, as it was on the device)
+static int getMedianNum(int bArray[], int len) {
+  int sorted[len];
+  memcpy(sorted, bArray, len * sizeof(int));
+  for (int i = 0; i < len - 1; i++) {
+    for (int j = 0; j < len - i - 1; j++) {
+      if (sorted[j] > sorted[j + 1]) {
+        int temp = sorted[j];
+        sorted[j] = sorted[j + 1];
+        sorted[j + 1] = temp;
+      }
+    }
+  }
+  return len % 2 ? sorted[len / 2] : (sorted[len / 2 - 1] + sorted[len / 2]) / 2;
+}
+
+static std::vector<int> makeSamples(size_t n) {
+  std::vector<int> out(n);
+  int v = 2048;
+  srand(12345);
+  for (size_t i = 0; i < n; i++) {
+    v += rand() % 41 - 20;
+    if (v < 0) v = 0;
+    if (v > 4095) v = 4095;
+    out[i] = (rand() % 50 == 0) ? rand() % 4096 : v;  // occasional spike
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  const size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::vector<int> samples = makeSamples(iterations);
+  std::vector<int> oldOut(iterations), newOut(iterations);
+
+  using Clock = std::chrono::steady_clock;
+
+  // Old: rolling buffer, full copy + sort on every read
+  int buffer[WINDOW] = {0};
+  int index = 0, filled = 0;
+  const auto t0 = Clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    buffer[index] = samples[i];
+    index = (index + 1) % WINDOW;
+    if (filled < WINDOW) filled++;
+    oldOut[i] = getMedianNum(buffer, filled);
+  }
+  const auto t1 = Clock::now();
+
+  // New: incremental window
+  MedianFilter<int, WINDOW> filter;
+  const auto t2 = Clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    filter.push(samples[i]);
+    newOut[i] = filter.median();
+  }
+  const auto t3 = Clock::now();
+
+  size_t mismatches = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    if (oldOut[i] != newOut[i]) mismatches++;
+  }
+
+  const double oldNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+  const double newNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / iterations;
+  printf("window %d, %zu samples\n", WINDOW, iterations);
+  printf("  getMedianNum  %8.1f ns/sample\n", oldNs);
+  printf("  MedianFilter  %8.1f ns/sample  (%.1fx)\n", newNs, oldNs / newNs);
+  printf("  mismatches    %zu\n", mismatches);
+  return mismatches ? 1 : 0;
+}
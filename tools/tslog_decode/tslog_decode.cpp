@@ -0,0 +1,165 @@
+// Host-side decoder for the on-flash history log (lib/TsLog format).
+//
+// Copy the /tslog directory off the device (e.g. with a LittleFS image
+// dump) and run:
+//
+//   g++ -std=c++17 -O2 -I../../lib/TsLog -I../../include
+//       tslog_decode.cpp ../../lib/TsLog/TsLog.cpp -o tslog_decode
+//
+//   ./tslog_decode [--json] [--from UNIX] [--to UNIX] [--verify] <dir|file>...
+//
+// Output is CSV (default) or JSON lines, oldest record first. --verify only
+// scans the files and reports block, record and corruption counts.
+
+#include <TsLog.h>
+#include <TsLogSensor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+struct Segment {
+  std::string        path;
+  TsLogSegmentHeader header;
+};
+
+struct Options {
+  bool     json   = false;
+  bool     verify = false;
+  uint32_t from   = 0;
+  uint32_t to     = UINT32_MAX;
+};
+
+static Options g_opt;
+
+static void usage() {
+  fprintf(stderr, "usage: tslog_decode [--json] [--from UNIX] [--to UNIX] [--verify] <dir|file>...\n");
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static void addPath(const std::string &path, std::vector<std::string> &files) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    fprintf(stderr, "tslog_decode: cannot open %s\n", path.c_str());
+    return;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    files.push_back(path);
+    return;
+  }
+  DIR *dir = opendir(path.c_str());
+  if (!dir) return;
+  while (struct dirent *e = readdir(dir)) {
+    const size_t len = strlen(e->d_name);
+    if (len > 4 && strcmp(e->d_name + len - 4, ".tsl") == 0) files.push_back(path + "/" + e->d_name);
+  }
+  closedir(dir);
+}
+
+static void printValue(float v, float scale, bool json) {
+  if (std::isnan(v)) {
+    fputs(json ? "null" : "", stdout);
+    return;
+  }
+  const int decimals = scale >= 100.0f ? 2 : scale >= 10.0f ? 1 : 0;
+  printf("%.*f", decimals, v);
+}
+
+static void onRecord(const TsLogRecord &rec, void *) {
+  if (g_opt.verify || rec.timestamp < g_opt.from || rec.timestamp > g_opt.to) return;
+
+  if (g_opt.json) printf("{\"timestamp\":%u", rec.timestamp);
+  else printf("%u", rec.timestamp);
+
+  for (uint8_t i = 0; i < TSLOG_SENSOR_FIELD_COUNT; i++) {
+    const float v = tsLogDequantize(rec.values[i], TSLOG_SENSOR_FIELDS[i].scale);
+    if (g_opt.json) printf(",\"%s\":", TSLOG_SENSOR_FIELDS[i].name);
+    else putchar(',');
+    printValue(v, TSLOG_SENSOR_FIELDS[i].scale, g_opt.json);
+  }
+  puts(g_opt.json ? "}" : "");
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json")) g_opt.json = true;
+    else if (!strcmp(argv[i], "--verify")) g_opt.verify = true;
+    else if (!strcmp(argv[i], "--from") && i + 1 < argc) g_opt.from = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--to") && i + 1 < argc) g_opt.to = strtoul(argv[++i], nullptr, 10);
+    else if (argv[i][0] == '-') { usage(); return 2; }
+    else addPath(argv[i], files);
+  }
+  if (files.empty()) {
+    usage();
+    return 2;
+  }
+
+  std::vector<Segment> segments;
+  for (const std::string &path : files) {
+    std::vector<uint8_t> head;
+    Segment seg;
+    seg.path = path;
+    if (!readFile(path, head) || head.size() < sizeof(TsLogSegmentHeader)) {
+      fprintf(stderr, "tslog_decode: %s: too short\n", path.c_str());
+      continue;
+    }
+    memcpy(&seg.header, head.data(), sizeof(seg.header));
+    if (!tsLogValidHeader(seg.header)) {
+      fprintf(stderr, "tslog_decode: %s: bad segment header\n", path.c_str());
+      continue;
+    }
+    segments.push_back(seg);
+  }
+  std::sort(segments.begin(), segments.end(), [](const Segment &a, const Segment &b) {
+    return a.header.sequence < b.header.sequence;
+  });
+
+  if (!g_opt.verify && !g_opt.json) {
+    printf("timestamp");
+    for (uint8_t i = 0; i < TSLOG_SENSOR_FIELD_COUNT; i++) printf(",%s", TSLOG_SENSOR_FIELDS[i].name);
+    putchar('\n');
+  }
+
+  TsLogScanStats total = {0, 0, 0, 0};
+  for (const Segment &seg : segments) {
+    std::vector<uint8_t> data;
+    readFile(seg.path, data);
+
+    TsLogScanStats stats = {0, 0, 0, 0};
+    const size_t body = sizeof(TsLogSegmentHeader);
+    tsLogScanBuffer(data.data() + body, data.size() - body, seg.header.fieldCount, true,
+                    onRecord, nullptr, &stats);
+
+    if (g_opt.verify) {
+      printf("%s: seq %u, first %u, %u block(s), %u record(s), %u corrupt, %u byte(s) skipped\n",
+             seg.path.c_str(), seg.header.sequence, seg.header.firstTimestamp,
+             stats.blocks, stats.records, stats.corruptBlocks, stats.skippedBytes);
+    }
+    total.blocks        += stats.blocks;
+    total.records       += stats.records;
+    total.corruptBlocks += stats.corruptBlocks;
+    total.skippedBytes  += stats.skippedBytes;
+  }
+
+  if (g_opt.verify) {
+    printf("total: %zu segment(s), %u block(s), %u record(s), %u corrupt\n",
+           segments.size(), total.blocks, total.records, total.corruptBlocks);
+  }
+  return total.corruptBlocks ? 1 : 0;
+}